@@ -2,4 +2,6 @@
 
 option(KADEMLIA_BUILD_TEST "Build ${PROJECT_NAME} unittest" ${PROJECT_IS_TOP_LEVEL})
 option(KADEMLIA_INSTALL "Install ${PROJECT_NAME}" ${PROJECT_IS_TOP_LEVEL})
+option(KADEMLIA_BUILD_BENCHMARK "Build ${PROJECT_NAME} benchmarks" OFF)
+option(KADEMLIA_ENABLE_BATCHED_IO "Use recvmmsg/sendmmsg batched UDP I/O (Linux only)" OFF)
 option(KADEMLIA_ENABLE_DOCUMENTATION "Enable documentation" OFF)
\ No newline at end of file
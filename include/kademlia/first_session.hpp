@@ -30,12 +30,14 @@
 #   pragma once
 #endif
 
+#include <cstddef>
 #include <memory>
 #include <system_error>
 
 #include <kademlia/detail/symbol_visibility.hpp>
 #include <kademlia/endpoint.hpp>
 #include <kademlia/session_base.hpp>
+#include <kademlia/session_configuration.hpp>
 
 namespace kademlia {
 
@@ -48,6 +50,12 @@ public:
         ( endpoint const& listen_on_ipv4 = endpoint{ "0.0.0.0", DEFAULT_PORT }
         , endpoint const& listen_on_ipv6 = endpoint{ "::", DEFAULT_PORT } );
 
+    KADEMLIA_EXPORT
+    first_session
+        ( session_configuration const& configuration
+        , endpoint const& listen_on_ipv4 = endpoint{ "0.0.0.0", DEFAULT_PORT }
+        , endpoint const& listen_on_ipv6 = endpoint{ "::", DEFAULT_PORT } );
+
     KADEMLIA_EXPORT
     ~first_session
         ( void );
@@ -66,6 +74,16 @@ public:
     run
         ( void );
 
+    KADEMLIA_EXPORT
+    std::error_code
+    run_concurrently
+        ( std::size_t threads_count );
+
+    KADEMLIA_EXPORT
+    std::size_t
+    poll
+        ( std::size_t max_handlers_count );
+
     KADEMLIA_EXPORT
     void
     abort
@@ -0,0 +1,279 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_SESSION_CONFIGURATION_HPP
+#define KADEMLIA_SESSION_CONFIGURATION_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace kademlia {
+
+/**
+ *  @brief Protocol parameters of a session.
+ *
+ *  The defaults suit the Internet, a LAN can use
+ *  shorter timeouts while a slower network
+ *  needs longer ones.
+ */
+class session_configuration final
+{
+public:
+    using duration_type = std::chrono::milliseconds;
+
+public:
+    session_configuration
+        ( void )
+            : bucket_size_( 20 )
+            , concurrent_requests_count_( 3 )
+            , redundant_saves_count_( 3 )
+            , initial_contact_timeout_( 1000 )
+            , peer_lookup_timeout_( 200 )
+            , hedged_requests_percentile_( 0. )
+            , disjoint_paths_count_( 1 )
+            , lookup_candidates_count_( 40 )
+            , bucket_refresh_interval_( 60 * 60 * 1000 )
+            , max_stored_bytes_count_( 64 * 1024 * 1024 )
+            , value_lifetime_( 24 * 60 * 60 * 1000 )
+            , value_republication_interval_( 60 * 60 * 1000 )
+    { }
+
+    /// Peers count per routing table bucket (k).
+    std::size_t
+    bucket_size
+        ( void )
+        const
+    { return bucket_size_; }
+
+    void
+    bucket_size
+        ( std::size_t size )
+    { bucket_size_ = require_positive( size, "bucket size" ); }
+
+    /// Requests sent concurrently by a lookup (alpha).
+    std::size_t
+    concurrent_requests_count
+        ( void )
+        const
+    { return concurrent_requests_count_; }
+
+    void
+    concurrent_requests_count
+        ( std::size_t count )
+    {
+        concurrent_requests_count_
+                = require_positive( count, "concurrent requests count" );
+    }
+
+    /// Peers a value is saved to (c).
+    std::size_t
+    redundant_saves_count
+        ( void )
+        const
+    { return redundant_saves_count_; }
+
+    void
+    redundant_saves_count
+        ( std::size_t count )
+    {
+        redundant_saves_count_
+                = require_positive( count, "redundant saves count" );
+    }
+
+    /// Time to wait for the initial peer response.
+    duration_type
+    initial_contact_timeout
+        ( void )
+        const
+    { return initial_contact_timeout_; }
+
+    void
+    initial_contact_timeout
+        ( duration_type const& timeout )
+    {
+        initial_contact_timeout_
+                = require_positive( timeout, "initial contact timeout" );
+    }
+
+    /// Time to wait for a peer response during a lookup.
+    duration_type
+    peer_lookup_timeout
+        ( void )
+        const
+    { return peer_lookup_timeout_; }
+
+    void
+    peer_lookup_timeout
+        ( duration_type const& timeout )
+    {
+        peer_lookup_timeout_
+                = require_positive( timeout, "peer lookup timeout" );
+    }
+
+    /// Percentile of the round trip times past which a value lookup
+    /// also queries another peer if the peer round trip time is
+    /// unknown, 0 disables it.
+    double
+    hedged_requests_percentile
+        ( void )
+        const
+    { return hedged_requests_percentile_; }
+
+    void
+    hedged_requests_percentile
+        ( double percentile )
+    {
+        if ( percentile < 0. || percentile > 1. )
+            throw std::invalid_argument{ "hedged requests percentile "
+                                         "must be in [0, 1]" };
+
+        hedged_requests_percentile_ = percentile;
+    }
+
+    /// Disjoint paths a value lookup follows in parallel (d).
+    std::size_t
+    disjoint_paths_count
+        ( void )
+        const
+    { return disjoint_paths_count_; }
+
+    void
+    disjoint_paths_count
+        ( std::size_t count )
+    {
+        disjoint_paths_count_
+                = require_positive( count, "disjoint paths count" );
+    }
+
+    /// Candidates a lookup keeps at most, at least the bucket size.
+    std::size_t
+    lookup_candidates_count
+        ( void )
+        const
+    { return lookup_candidates_count_; }
+
+    void
+    lookup_candidates_count
+        ( std::size_t count )
+    {
+        lookup_candidates_count_
+                = require_positive( count, "lookup candidates count" );
+    }
+
+    /// Time without lookup past which a bucket is refreshed.
+    duration_type
+    bucket_refresh_interval
+        ( void )
+        const
+    { return bucket_refresh_interval_; }
+
+    void
+    bucket_refresh_interval
+        ( duration_type const& interval )
+    {
+        bucket_refresh_interval_
+                = require_positive( interval, "bucket refresh interval" );
+    }
+
+    /// Bytes the values stored on behalf of other peers may hold.
+    std::size_t
+    max_stored_bytes_count
+        ( void )
+        const
+    { return max_stored_bytes_count_; }
+
+    void
+    max_stored_bytes_count
+        ( std::size_t count )
+    { max_stored_bytes_count_ = count; }
+
+    /// Time a saved value is stored by peers.
+    duration_type
+    value_lifetime
+        ( void )
+        const
+    { return value_lifetime_; }
+
+    void
+    value_lifetime
+        ( duration_type const& lifetime )
+    { value_lifetime_ = require_positive( lifetime, "value lifetime" ); }
+
+    /// Time past which a stored value is republished.
+    duration_type
+    value_republication_interval
+        ( void )
+        const
+    { return value_republication_interval_; }
+
+    void
+    value_republication_interval
+        ( duration_type const& interval )
+    {
+        value_republication_interval_
+                = require_positive( interval, "value republication interval" );
+    }
+
+private:
+    /**
+     *  @throw std::invalid_argument if value isn't positive.
+     */
+    template< typename ValueType >
+    static ValueType const&
+    require_positive
+        ( ValueType const& value
+        , char const* name )
+    {
+        if ( value <= ValueType{} )
+            throw std::invalid_argument{ std::string{ name }
+                                       + " must be positive" };
+
+        return value;
+    }
+
+private:
+    std::size_t bucket_size_;
+    std::size_t concurrent_requests_count_;
+    std::size_t redundant_saves_count_;
+    duration_type initial_contact_timeout_;
+    duration_type peer_lookup_timeout_;
+    double hedged_requests_percentile_;
+    std::size_t disjoint_paths_count_;
+    std::size_t lookup_candidates_count_;
+    duration_type bucket_refresh_interval_;
+    std::size_t max_stored_bytes_count_;
+    duration_type value_lifetime_;
+    duration_type value_republication_interval_;
+};
+
+} // namespace kademlia
+
+#endif
@@ -0,0 +1,542 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef KADEMLIA_BASIC_ROUTING_TABLE_HPP
+#define KADEMLIA_BASIC_ROUTING_TABLE_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "constants.hpp"
+#include "id.hpp"
+#include "k_bucket.hpp"
+#include "log.hpp"
+#include "rtt_estimator.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  This class implements the k_buckets operations
+ *  shared by the routing tables.
+ *  @note RoutingTableType tells how the k_buckets are
+ *        indexed and split through the following methods:
+ *        - find_k_bucket_index( id ) returns the index of
+ *          the k_bucket covering id.
+ *        - is_k_bucket_full( index ) tells if a new peer can't
+ *          be pushed into a k_bucket, even by splitting it.
+ *        - split_k_bucket( index ) tries to make room
+ *          into a full k_bucket, returning true on success.
+ *        - refreshable_k_buckets_count() returns the count
+ *          of leading k_buckets to refresh.
+ */
+template< typename RoutingTableType, typename PeerType >
+class basic_routing_table
+{
+public:
+    ///
+    enum { DEFAULT_K_BUCKET_SIZE = 20 };
+
+    ///
+    using peer_type = PeerType;
+
+    ///
+    using value_type = std::pair< id, peer_type >;
+
+    /// Entries are stored as separate id & peer arrays,
+    /// hence they can only be accessed through a proxy.
+    using reference = std::pair< id const&, peer_type & >;
+
+    ///
+    using duration = rtt_estimator::duration;
+
+    ///
+    using clock = std::chrono::steady_clock;
+
+public:
+    /**
+     *  Disabled copy constructor.
+     */
+    basic_routing_table
+        ( basic_routing_table const& )
+        = delete;
+
+    /**
+     *  Disabled assignement operator.
+     */
+    basic_routing_table&
+    operator=
+        ( basic_routing_table const& )
+        = delete;
+
+    /**
+     *  Count the number of peer in the routing table.
+     *  @note Complexity: O(1).
+     */
+    std::size_t
+    peer_count
+        ( void )
+        const
+    { return peer_count_; }
+
+    /**
+     *  Register a peer into the routing table.
+     *  @return true if the peer has been inserted.
+     *  @note This method takes ownership of the peer.
+     *  @note Our own id is never pushed.
+     *  @note An already known peer becomes the most recently
+     *        seen peer of its bucket.
+     *  @note The target bucket is split until the peer fits or
+     *        it can't be split anymore, the peer is then kept
+     *        in the bucket replacement cache if it is full.
+     *  @note Complexity: O(k)
+     */
+    bool
+    push
+        ( id const& peer_id
+        , peer_type const& new_peer )
+    {
+        LOG_DEBUG( routing_table, this ) << "pushing peer '"
+                << new_peer << "' as '"
+                << peer_id << "'." << std::endl;
+
+        // Peers may list ourselves among their neighbors.
+        if ( peer_id == my_id_ )
+            return false;
+
+        auto k_bucket_index = table().find_k_bucket_index( peer_id );
+
+        // Check if the peer is not already known.
+        auto const i = k_buckets_[ k_bucket_index ].find( peer_id );
+        if ( i != k_buckets_[ k_bucket_index ].size() )
+        {
+            k_buckets_[ k_bucket_index ].move_to_back( i );
+            return false;
+        }
+
+        while ( table().split_k_bucket( k_bucket_index ) )
+            k_bucket_index = table().find_k_bucket_index( peer_id );
+
+        auto & bucket = k_buckets_[ k_bucket_index ];
+
+        if ( table().is_k_bucket_full( k_bucket_index ) )
+        {
+            bucket.push_replacement( peer_id, new_peer, k_bucket_size_ );
+            return false;
+        }
+
+        bucket.remove_replacement( peer_id );
+        bucket.push_back( peer_id, new_peer );
+        ++ peer_count_;
+
+        return true;
+    }
+
+    /**
+     *  Find the peer to ping before new_peer_id can be pushed.
+     *  @return true if the bucket of new_peer_id is full and
+     *          isn't already pinging its least recently seen
+     *          peer, which is then copied into oldest_peer.
+     *  @note The bucket is pinging until evict()
+     *        or cancel_eviction() is called.
+     *  @note Complexity: O(k)
+     */
+    bool
+    find_eviction_candidate
+        ( id const& new_peer_id
+        , value_type & oldest_peer )
+    {
+        auto k_bucket_index = table().find_k_bucket_index( new_peer_id );
+        auto & bucket = k_buckets_[ k_bucket_index ];
+
+        if ( bucket.is_pinging()
+           || bucket.find( new_peer_id ) != bucket.size()
+           || ! table().is_k_bucket_full( k_bucket_index ) )
+            return false;
+
+        bucket.is_pinging( true );
+
+        auto const oldest = bucket[ 0 ];
+        oldest_peer = value_type{ oldest.first, oldest.second };
+
+        return true;
+    }
+
+    /**
+     *  Replace the least recently seen peer of a bucket
+     *  as it didn't answer the eviction ping.
+     *  @return true if the stale peer has been evicted.
+     *  @note The stale peer is kept if it has been seen since.
+     *  @note The most recently seen peer of the bucket
+     *        replacement cache takes its place.
+     *  @note Complexity: O(k)
+     */
+    bool
+    evict
+        ( id const& stale_peer_id )
+    {
+        auto & bucket = find_k_bucket( stale_peer_id );
+        bucket.is_pinging( false );
+
+        if ( bucket.empty() || bucket[ 0 ].first != stale_peer_id )
+            return false;
+
+        LOG_DEBUG( routing_table, this ) << "evicting peer '"
+                << stale_peer_id << "'." << std::endl;
+
+        erase( bucket, 0 );
+
+        return true;
+    }
+
+    /**
+     *  Keep the least recently seen peer of a bucket
+     *  as it answered the eviction ping.
+     *  @note Complexity: O(1)
+     */
+    void
+    cancel_eviction
+        ( id const& oldest_peer_id )
+    { find_k_bucket( oldest_peer_id ).is_pinging( false ); }
+
+    /**
+     *  Remove a peer from the routing table.
+     *  @return true if the peer has been removed.
+     *  @note The most recently seen peer of the bucket
+     *        replacement cache takes its place.
+     *  @note k_buckets are never merged back.
+     *  @note Complexity: O(k)
+     */
+    bool
+    remove
+        ( id const& peer_id )
+    {
+        LOG_DEBUG( routing_table, this ) << "removing peer '"
+                << peer_id << "'." << std::endl;
+
+        auto & bucket = find_k_bucket( peer_id );
+
+        auto const i = bucket.find( peer_id );
+        if ( i == bucket.size() )
+            return false;
+
+        erase( bucket, i );
+
+        return true;
+    }
+
+    /**
+     *  Update the round trip time estimates of a peer.
+     *  @return true if the peer is known.
+     *  @note Complexity: O(k)
+     */
+    bool
+    record_round_trip_time
+        ( id const& peer_id
+        , duration const& rtt )
+    {
+        auto & bucket = find_k_bucket( peer_id );
+
+        auto const i = bucket.find( peer_id );
+        if ( i == bucket.size() )
+            return false;
+
+        bucket.rtt_estimator_at( i ).record( rtt );
+
+        return true;
+    }
+
+    /**
+     *  Back off the timeout of the next requests sent to a peer
+     *  after the request sent at sent_at timed out.
+     *  @return true if the peer is known.
+     *  @note A peer timed out MAX_CONSECUTIVE_TIMEOUTS_COUNT times
+     *        in a row is removed, the most recently seen peer of
+     *        the bucket replacement cache taking its place.
+     *  @note Complexity: O(k)
+     */
+    bool
+    record_request_timeout
+        ( id const& peer_id
+        , clock::time_point const& sent_at )
+    {
+        auto & bucket = find_k_bucket( peer_id );
+
+        auto const i = bucket.find( peer_id );
+        if ( i == bucket.size() )
+            return false;
+
+        auto & estimator = bucket.rtt_estimator_at( i );
+        estimator.record_timeout( sent_at, clock::now() );
+
+        if ( estimator.consecutive_timeouts_count()
+             >= MAX_CONSECUTIVE_TIMEOUTS_COUNT )
+        {
+            LOG_DEBUG( routing_table, this ) << "removing unresponsive peer '"
+                    << peer_id << "'." << std::endl;
+
+            erase( bucket, i );
+        }
+
+        return true;
+    }
+
+    /**
+     *  Compute the timeout of a request sent to a peer.
+     *  @return The timeout derived from the peer round trip time
+     *          or default_timeout if it is unknown.
+     *  @note Complexity: O(k)
+     */
+    duration
+    request_timeout
+        ( id const& peer_id
+        , duration const& default_timeout )
+        const
+    {
+        auto const& bucket = find_k_bucket( peer_id );
+
+        auto const i = bucket.find( peer_id );
+        if ( i == bucket.size() )
+            return default_timeout;
+
+        return bucket.rtt_estimator_at( i ).timeout( default_timeout );
+    }
+
+    /**
+     *  Compute the time past which the response of a peer is late.
+     *  @return The time derived from the peer round trip time
+     *          or zero if it is unknown.
+     *  @note Complexity: O(k)
+     */
+    duration
+    request_soft_timeout
+        ( id const& peer_id )
+        const
+    {
+        auto const& bucket = find_k_bucket( peer_id );
+
+        auto const i = bucket.find( peer_id );
+        if ( i == bucket.size() )
+            return duration::zero();
+
+        return bucket.rtt_estimator_at( i ).soft_timeout();
+    }
+
+    /**
+     *  Record a lookup of key, hence the k_bucket
+     *  covering it doesn't need to be refreshed.
+     *  @note Complexity: O(1)
+     */
+    void
+    record_lookup
+        ( id const& key
+        , clock::time_point const& now )
+    { find_k_bucket( key ).last_lookup( now ); }
+
+    /**
+     *  Find the refreshable k_buckets without lookup since idle_since.
+     *  @return The index of at most max_count of them,
+     *          the longest idle first.
+     *  @note Complexity: O(id::BIT_SIZE)
+     */
+    template< typename OutputIterator >
+    OutputIterator
+    find_idle_k_buckets
+        ( clock::time_point const& idle_since
+        , std::size_t max_count
+        , OutputIterator out )
+        const
+    {
+        std::vector< std::size_t > idle;
+        for ( std::size_t i = 0, e = table().refreshable_k_buckets_count()
+            ; i != e
+            ; ++ i )
+            if ( k_buckets_[ i ].last_lookup() < idle_since )
+                idle.push_back( i );
+
+        auto const count = std::min( max_count, idle.size() );
+        std::partial_sort( idle.begin(), idle.begin() + count, idle.end()
+                         , [ this ]( std::size_t a, std::size_t b )
+                           { return k_buckets_[ a ].last_lookup()
+                                  < k_buckets_[ b ].last_lookup(); } );
+
+        return std::copy( idle.begin(), idle.begin() + count, out );
+    }
+
+    /**
+     *  Find the count peers closest to an id.
+     *  @param output A buffer of at least count entries.
+     *  @return The end of the peers written into output,
+     *          sorted from the closest to the far.
+     *  @note It doesn't allocate.
+     *  @note Complexity: O(m log count), m being the peer
+     *        count of the k_buckets up to the farthest selected one.
+     */
+    template< typename RandomAccessIterator >
+    RandomAccessIterator
+    closest
+        ( id const& id_to_find
+        , std::size_t count
+        , RandomAccessIterator output )
+        const
+    {
+        return find_closest_peers( k_buckets_
+                                 , table().find_k_bucket_index( id_to_find )
+                                 , id_to_find, count, output );
+    }
+
+    /**
+     *  Print the routing table content.
+     *  @param out The output stream.
+     *  @param table The routing table to print.
+     *  @return A reference to the output stream.
+     */
+    friend std::ostream &
+    operator<<
+        ( std::ostream & out
+        , basic_routing_table const& table )
+    {
+        out << "{" << std::endl
+            << "\t\"id\": " << table.my_id_ << "," << std::endl
+            << "\t\"peer_count\": " << table.peer_count_ << ',' << std::endl
+            << "\t\"k_bucket_size\": " << table.k_bucket_size_<< ',' << std::endl
+            << "\t\"k_buckets\": " << std::endl;
+
+        for ( std::size_t i = 0, e = table.k_buckets_.size(); i != e; ++i )
+        {
+            out << "\t{" << std::endl
+                << "\t\t\"index\": " << i << "," << std::endl
+                << "\t\t\"bit_value\": " << bool(table.my_id_[i]) << "," << std::endl
+                << "\t\t\"peer_count\": " << table.k_buckets_[i].size() << std::endl
+                << "\t}" << std::endl;
+        }
+
+        return out << "}" << std::endl;
+    }
+
+protected:
+    ///
+    using k_buckets = std::vector< k_bucket< peer_type > >;
+
+protected:
+    /**
+     *  Construct the routing table without k_bucket.
+     */
+    basic_routing_table
+        ( id const& my_id
+        , std::size_t k_bucket_size )
+            : k_buckets_(), my_id_( my_id )
+            , peer_count_( 0 ), k_bucket_size_( k_bucket_size )
+    {
+        assert( k_bucket_size_ > 0 && "k_bucket size must be > 0" );
+
+        LOG_DEBUG( routing_table, this ) << "created with id '"
+                << my_id_ << "'." << std::endl;
+    }
+
+    /**
+     *
+     */
+    ~basic_routing_table
+        ( void )
+        = default;
+
+private:
+    /**
+     *
+     */
+    RoutingTableType &
+    table
+        ( void )
+    { return static_cast< RoutingTableType & >( *this ); }
+
+    /**
+     *
+     */
+    RoutingTableType const&
+    table
+        ( void )
+        const
+    { return static_cast< RoutingTableType const& >( *this ); }
+
+    /**
+     *
+     */
+    k_bucket< peer_type > &
+    find_k_bucket
+        ( id const& id_to_find )
+    { return k_buckets_[ table().find_k_bucket_index( id_to_find ) ]; }
+
+    /**
+     *
+     */
+    k_bucket< peer_type > const&
+    find_k_bucket
+        ( id const& id_to_find )
+        const
+    { return k_buckets_[ table().find_k_bucket_index( id_to_find ) ]; }
+
+    /**
+     *  @brief Erase a k_bucket entry, promoting its most
+     *         recently seen replacement if any.
+     */
+    void
+    erase
+        ( k_bucket< peer_type > & bucket
+        , std::size_t index )
+    {
+        bucket.erase( index );
+        -- peer_count_;
+
+        if ( bucket.promote_replacement() )
+            ++ peer_count_;
+    }
+
+protected:
+    /// Contains all the k_bucket.
+    /// @note Algorithms expect a vector here, do not change this.
+    k_buckets k_buckets_;
+    /// Own id.
+    id const my_id_;
+    /// Keep a track of peer count to make size() complexity O(1).
+    std::size_t peer_count_;
+    /// This is max number of peers stored per k_bucket.
+    std::size_t k_bucket_size_;
+};
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
+
@@ -0,0 +1,495 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_BATCHED_UDP_SOCKET_HPP
+#define KADEMLIA_BATCHED_UDP_SOCKET_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#ifndef __linux__
+#   error "batched_udp_socket relies on Linux recvmmsg() and sendmmsg()"
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief UDP socket reading and writing datagrams by batches.
+ *
+ *  Once the socket is readable, a single recvmmsg() call reads up to
+ *  BATCH_SIZE datagrams directly into the pending receive buffers,
+ *  i.e. one datagram per pending async_receive_from(), and the
+ *  completed reads are reported by a single handler. Hence up
+ *  to BATCH_SIZE reads should be kept pending to benefit from it.
+ *  Datagrams sent from the same handler are queued and written
+ *  by sendmmsg() from a single posted handler.
+ *
+ *  It provides the subset of boost::asio::ip::udp::socket
+ *  used by message_socket, hence can be used as its
+ *  UnderlyingSocketType.
+ */
+class batched_udp_socket final
+{
+public:
+    ///
+    using protocol_type = boost::asio::ip::udp;
+
+    ///
+    using endpoint_type = protocol_type::endpoint;
+
+    /// Maximum count of datagrams read or written per system call.
+    static constexpr std::size_t BATCH_SIZE = 16;
+
+public:
+    /**
+     *
+     */
+    batched_udp_socket
+        ( boost::asio::io_service & io_service
+        , protocol_type const& protocol )
+            : state_{ std::make_shared< state >( io_service, protocol ) }
+    { }
+
+    /**
+     *
+     */
+    template< typename Option >
+    void
+    set_option
+        ( Option const& option )
+    {
+        std::lock_guard< std::mutex > const lock{ state_->mutex_ };
+        state_->socket_.set_option( option );
+    }
+
+    /**
+     *
+     */
+    void
+    bind
+        ( endpoint_type const& e )
+    {
+        std::lock_guard< std::mutex > const lock{ state_->mutex_ };
+        state_->socket_.bind( e );
+    }
+
+    /**
+     *
+     */
+    boost::system::error_code
+    close
+        ( boost::system::error_code & failure )
+    {
+        // As asio sockets, a moved-from socket can be closed.
+        if ( ! state_ )
+        {
+            failure.clear();
+            return failure;
+        }
+
+        std::lock_guard< std::mutex > const lock{ state_->mutex_ };
+        return state_->socket_.close( failure );
+    }
+
+    /**
+     *
+     */
+    endpoint_type
+    local_endpoint
+        ( void )
+        const
+    {
+        std::lock_guard< std::mutex > const lock{ state_->mutex_ };
+        return state_->socket_.local_endpoint();
+    }
+
+    /**
+     *
+     */
+    template< typename Callback >
+    void
+    async_receive_from
+        ( boost::asio::mutable_buffer const& buffer
+        , endpoint_type & from
+        , Callback && callback )
+    {
+        state_->async_receive_from( buffer, from
+                                  , std::forward< Callback >( callback ) );
+    }
+
+    /**
+     *
+     */
+    template< typename Callback >
+    void
+    async_send_to
+        ( boost::asio::const_buffer const& buffer
+        , endpoint_type const& to
+        , Callback && callback )
+    {
+        state_->async_send_to( buffer, to
+                             , std::forward< Callback >( callback ) );
+    }
+
+private:
+    ///
+    using callback_type = std::function
+            < void ( boost::system::error_code const&, std::size_t ) >;
+
+    ///
+    struct pending_read final
+    {
+        boost::asio::mutable_buffer buffer_;
+        endpoint_type * from_;
+        callback_type callback_;
+    };
+
+    ///
+    struct pending_write final
+    {
+        boost::asio::const_buffer buffer_;
+        endpoint_type to_;
+        callback_type callback_;
+    };
+
+    /**
+     *  The pending handlers only refer weakly to the state, hence
+     *  destroying the socket releases it and its pending operations,
+     *  even if the io_service isn't run anymore.
+     */
+    struct state final
+            : std::enable_shared_from_this< state >
+    {
+        ///
+        state
+            ( boost::asio::io_service & io_service
+            , protocol_type const& protocol )
+                : io_service_( io_service )
+                , socket_{ io_service, protocol }
+                , mutex_{}
+                , pending_reads_{}
+                , waiting_readable_{ false }
+                , pending_writes_{}
+                , flushing_{ false }
+        { socket_.non_blocking( true ); }
+
+        ///
+        template< typename Callback >
+        void
+        async_receive_from
+            ( boost::asio::mutable_buffer const& buffer
+            , endpoint_type & from
+            , Callback && callback )
+        {
+            std::lock_guard< std::mutex > const lock{ mutex_ };
+
+            pending_reads_.push_back( { buffer, &from
+                                      , std::forward< Callback >( callback ) } );
+            wait_readable();
+        }
+
+        ///
+        template< typename Callback >
+        void
+        async_send_to
+            ( boost::asio::const_buffer const& buffer
+            , endpoint_type const& to
+            , Callback && callback )
+        {
+            std::lock_guard< std::mutex > const lock{ mutex_ };
+
+            pending_writes_.push_back( { buffer, to
+                                       , std::forward< Callback >( callback ) } );
+
+            // Writes queued until the flush is executed share its batch.
+            if ( flushing_ )
+                return;
+
+            flushing_ = true;
+            std::weak_ptr< state > self = shared_from_this();
+            io_service_.post( [ self ] ( void )
+            {
+                if ( auto s = self.lock() )
+                    s->flush();
+            } );
+        }
+
+        /// @pre mutex_ is locked.
+        void
+        wait_readable
+            ( void )
+        {
+            if ( waiting_readable_ )
+                return;
+
+            waiting_readable_ = true;
+            std::weak_ptr< state > self = shared_from_this();
+            socket_.async_wait( protocol_type::socket::wait_read
+                              , [ self ] ( boost::system::error_code const& failure )
+            {
+                if ( auto s = self.lock() )
+                    s->on_readable( failure );
+            } );
+        }
+
+        ///
+        void
+        on_readable
+            ( boost::system::error_code const& failure )
+        {
+            std::array< pending_read, BATCH_SIZE > completed_reads;
+            std::array< std::size_t, BATCH_SIZE > sizes;
+            std::size_t completed_reads_count = 0;
+            auto error = failure;
+
+            {
+                std::lock_guard< std::mutex > const lock{ mutex_ };
+                waiting_readable_ = false;
+
+                if ( ! error )
+                    completed_reads_count = read_batch( completed_reads
+                                                      , sizes
+                                                      , error );
+
+                // On failure, the pending reads are reported one by one
+                // as a failed read is a fatal error for message_socket.
+                if ( error && ! pending_reads_.empty() )
+                {
+                    completed_reads[ 0 ] = std::move( pending_reads_.front() );
+                    pending_reads_.pop_front();
+                    sizes[ 0 ] = 0;
+                    completed_reads_count = 1;
+                }
+
+                if ( ! pending_reads_.empty() )
+                    wait_readable();
+            }
+
+            for ( std::size_t i = 0; i != completed_reads_count; ++ i )
+                completed_reads[ i ].callback_( error, sizes[ i ] );
+        }
+
+        /**
+         *  @pre mutex_ is locked.
+         *  @return The count of pending reads completed.
+         */
+        std::size_t
+        read_batch
+            ( std::array< pending_read, BATCH_SIZE > & completed_reads
+            , std::array< std::size_t, BATCH_SIZE > & sizes
+            , boost::system::error_code & failure )
+        {
+            std::array< ::mmsghdr, BATCH_SIZE > headers{};
+            std::array< ::iovec, BATCH_SIZE > vectors;
+
+            // Datagrams are read directly into the pending reads buffers.
+            auto const count = std::min( pending_reads_.size(), BATCH_SIZE );
+            for ( std::size_t i = 0; i != count; ++ i )
+            {
+                auto & r = pending_reads_[ i ];
+                vectors[ i ] = { r.buffer_.data(), r.buffer_.size() };
+                headers[ i ].msg_hdr.msg_name = r.from_->data();
+                headers[ i ].msg_hdr.msg_namelen = r.from_->capacity();
+                headers[ i ].msg_hdr.msg_iov = &vectors[ i ];
+                headers[ i ].msg_hdr.msg_iovlen = 1;
+            }
+
+            auto const result = ::recvmmsg( socket_.native_handle()
+                                          , headers.data(), count
+                                          , MSG_DONTWAIT, nullptr );
+            if ( result < 0 )
+            {
+                // Spurious wake up, wait again.
+                if ( errno != EAGAIN && errno != EWOULDBLOCK )
+                    failure.assign( errno, boost::system::system_category() );
+                return 0;
+            }
+
+            std::size_t const completed_count( result );
+            for ( std::size_t i = 0; i != completed_count; ++ i )
+            {
+                auto & r = pending_reads_.front();
+                r.from_->resize( headers[ i ].msg_hdr.msg_namelen );
+                sizes[ i ] = headers[ i ].msg_len;
+                completed_reads[ i ] = std::move( r );
+                pending_reads_.pop_front();
+            }
+
+            return completed_count;
+        }
+
+        ///
+        void
+        flush
+            ( void )
+        {
+            std::array< pending_write, BATCH_SIZE > completed_writes;
+            std::array< boost::system::error_code, BATCH_SIZE > failures;
+            std::array< std::size_t, BATCH_SIZE > sizes;
+
+            for (;;)
+            {
+                std::size_t completed_writes_count = 0;
+                {
+                    std::lock_guard< std::mutex > const lock{ mutex_ };
+
+                    if ( pending_writes_.empty() )
+                    {
+                        flushing_ = false;
+                        return;
+                    }
+
+                    bool const would_block = ! write_batch( completed_writes
+                                                          , failures
+                                                          , sizes
+                                                          , completed_writes_count );
+                    if ( would_block )
+                    {
+                        // Resume flushing once the socket is writable.
+                        std::weak_ptr< state > self = shared_from_this();
+                        socket_.async_wait( protocol_type::socket::wait_write
+                                          , [ self ] ( boost::system::error_code const& )
+                        {
+                            if ( auto s = self.lock() )
+                                s->flush();
+                        } );
+                        return;
+                    }
+                }
+
+                for ( std::size_t i = 0; i != completed_writes_count; ++ i )
+                {
+                    completed_writes[ i ].callback_( failures[ i ], sizes[ i ] );
+                    completed_writes[ i ].callback_ = nullptr;
+                }
+            }
+        }
+
+        /**
+         *  @pre mutex_ is locked and pending_writes_ isn't empty.
+         *  @return false if the socket would block.
+         */
+        bool
+        write_batch
+            ( std::array< pending_write, BATCH_SIZE > & completed_writes
+            , std::array< boost::system::error_code, BATCH_SIZE > & failures
+            , std::array< std::size_t, BATCH_SIZE > & sizes
+            , std::size_t & completed_writes_count )
+        {
+            std::array< ::mmsghdr, BATCH_SIZE > headers{};
+            std::array< ::iovec, BATCH_SIZE > vectors;
+
+            auto const count = std::min( pending_writes_.size(), BATCH_SIZE );
+            for ( std::size_t i = 0; i != count; ++ i )
+            {
+                auto & w = pending_writes_[ i ];
+                // sendmmsg() doesn't modify the buffers.
+                vectors[ i ] = { const_cast< void * >( w.buffer_.data() )
+                               , w.buffer_.size() };
+                headers[ i ].msg_hdr.msg_name = w.to_.data();
+                headers[ i ].msg_hdr.msg_namelen = w.to_.size();
+                headers[ i ].msg_hdr.msg_iov = &vectors[ i ];
+                headers[ i ].msg_hdr.msg_iovlen = 1;
+            }
+
+            auto const result = ::sendmmsg( socket_.native_handle()
+                                          , headers.data(), count
+                                          , MSG_DONTWAIT );
+            if ( result < 0 )
+            {
+                if ( errno == EAGAIN || errno == EWOULDBLOCK )
+                    return false;
+
+                // The first datagram failed, report it
+                // and let the next flush iteration go on.
+                failures[ 0 ].assign( errno, boost::system::system_category() );
+                sizes[ 0 ] = 0;
+                completed_writes_count = 1;
+            }
+            else
+            {
+                completed_writes_count = std::size_t( result );
+                for ( std::size_t i = 0; i != completed_writes_count; ++ i )
+                {
+                    failures[ i ].clear();
+                    sizes[ i ] = headers[ i ].msg_len;
+                }
+            }
+
+            for ( std::size_t i = 0; i != completed_writes_count; ++ i )
+            {
+                completed_writes[ i ] = std::move( pending_writes_.front() );
+                pending_writes_.pop_front();
+            }
+
+            return true;
+        }
+
+        ///
+        boost::asio::io_service & io_service_;
+        ///
+        protocol_type::socket socket_;
+        /// Protects the members below as well as socket_.
+        mutable std::mutex mutex_;
+        ///
+        std::deque< pending_read > pending_reads_;
+        ///
+        bool waiting_readable_;
+        ///
+        std::deque< pending_write > pending_writes_;
+        ///
+        bool flushing_;
+    };
+
+private:
+    ///
+    std::shared_ptr< state > state_;
+};
+
+constexpr std::size_t batched_udp_socket::BATCH_SIZE;
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
@@ -0,0 +1,507 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_BUFFER_POOL_HPP
+#define KADEMLIA_BUFFER_POOL_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace kademlia {
+namespace detail {
+
+class buffer_pool;
+
+/**
+ *  @brief Reference counted handle on a buffer.
+ *
+ *  Copying the handle doesn't copy the buffer. Once the last handle
+ *  is released, the buffer is either given back to the pool it has
+ *  been acquired from or deleted.
+ */
+class shared_buffer final
+{
+public:
+    /**
+     *  @brief Allocate a buffer of size bytes not related to any pool.
+     */
+    static shared_buffer
+    allocate
+        ( std::size_t size );
+
+    /**
+     *
+     */
+    shared_buffer
+        ( void ) noexcept
+            : block_{ nullptr }
+    { }
+
+    /**
+     *
+     */
+    shared_buffer
+        ( shared_buffer const& o ) noexcept
+            : block_{ o.block_ }
+    { acquire(); }
+
+    /**
+     *
+     */
+    shared_buffer
+        ( shared_buffer && o ) noexcept
+            : block_{ o.block_ }
+    { o.block_ = nullptr; }
+
+    /**
+     *
+     */
+    shared_buffer &
+    operator=
+        ( shared_buffer o ) noexcept
+    {
+        std::swap( block_, o.block_ );
+        return *this;
+    }
+
+    /**
+     *
+     */
+    ~shared_buffer
+        ( void )
+    { release(); }
+
+    /**
+     *
+     */
+    buffer &
+    operator*
+        ( void )
+        const
+    {
+        assert( block_ && "dereferencing an empty shared_buffer" );
+        return block_->data_;
+    }
+
+    /**
+     *
+     */
+    buffer *
+    operator->
+        ( void )
+        const
+    { return &**this; }
+
+    /**
+     *
+     */
+    explicit
+    operator bool
+        ( void )
+        const
+    { return block_ != nullptr; }
+
+    /**
+     *  @return The number of handles sharing the buffer.
+     */
+    std::size_t
+    use_count
+        ( void )
+        const
+    { return block_ ? block_->references_count_.load() : 0; }
+
+private:
+    friend class buffer_pool;
+
+    ///
+    struct block final
+    {
+        ///
+        explicit
+        block
+            ( std::size_t size )
+                : references_count_{ 0 }
+                , pool_{}
+                , data_( size )
+        { }
+
+        ///
+        std::atomic< std::size_t > references_count_;
+        /// Set while the block is in use, if it belongs to a pool.
+        std::shared_ptr< buffer_pool > pool_;
+        ///
+        buffer data_;
+    };
+
+private:
+    /**
+     *
+     */
+    explicit
+    shared_buffer
+        ( block * b ) noexcept
+            : block_{ b }
+    { acquire(); }
+
+    /**
+     *
+     */
+    void
+    acquire
+        ( void ) noexcept
+    {
+        if ( block_ )
+            block_->references_count_.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    /**
+     *
+     */
+    void
+    release
+        ( void ) noexcept;
+
+private:
+    ///
+    block * block_;
+};
+
+/**
+ *  @brief Read-only view on a part of a shared_buffer,
+ *         keeping the whole buffer alive.
+ */
+class buffer_view final
+{
+public:
+    ///
+    using const_iterator = buffer::const_iterator;
+
+public:
+    /**
+     *
+     */
+    buffer_view
+        ( void )
+            : owner_{}
+            , begin_{}
+            , end_{}
+    { }
+
+    /**
+     *  @pre [begin, end) belongs to the buffer owned by owner.
+     */
+    buffer_view
+        ( shared_buffer owner
+        , const_iterator begin
+        , const_iterator end )
+            : owner_{ std::move( owner ) }
+            , begin_{ begin }
+            , end_{ end }
+    { }
+
+    /**
+     *  @brief Copy [begin, end) into a buffer of the exact size.
+     */
+    template< typename InputIterator >
+    static buffer_view
+    copy
+        ( InputIterator begin
+        , InputIterator end )
+    {
+        auto owner = shared_buffer::allocate( std::distance( begin, end ) );
+        std::copy( begin, end, owner->begin() );
+
+        const_iterator b = owner->begin(), e = owner->end();
+        return buffer_view{ std::move( owner ), b, e };
+    }
+
+    /**
+     *
+     */
+    const_iterator
+    begin
+        ( void )
+        const
+    { return begin_; }
+
+    /**
+     *
+     */
+    const_iterator
+    end
+        ( void )
+        const
+    { return end_; }
+
+    /**
+     *
+     */
+    std::size_t
+    size
+        ( void )
+        const
+    { return std::size_t( end_ - begin_ ); }
+
+    /**
+     *
+     */
+    bool
+    empty
+        ( void )
+        const
+    { return begin_ == end_; }
+
+    /**
+     *  @return The size of the buffer kept alive by this view.
+     */
+    std::size_t
+    capacity
+        ( void )
+        const
+    { return owner_ ? owner_->size() : 0; }
+
+    /**
+     *  @brief Release the unused part of the buffer.
+     *  @return This view if it uses at least a quarter of its
+     *          buffer, a view on a copy of the data otherwise.
+     */
+    buffer_view
+    compact
+        ( void )
+        const
+    {
+        if ( size() * 4 >= capacity() )
+            return *this;
+
+        return copy( begin_, end_ );
+    }
+
+private:
+    ///
+    shared_buffer owner_;
+    ///
+    const_iterator begin_;
+    ///
+    const_iterator end_;
+};
+
+/**
+ *  @return The size of the whole buffer kept alive by the view.
+ */
+inline std::size_t
+held_bytes_count
+    ( buffer_view const& view )
+{ return view.capacity(); }
+
+/**
+ *  @brief Provides buffers of a fixed size.
+ *
+ *  Buffers are recycled once all the handles on them
+ *  have been released, from any thread. A recycled buffer
+ *  keeps its capacity, hence a buffer grown past its
+ *  initial size (e.g. by serialization) doesn't have
+ *  to be reallocated once acquired again.
+ */
+class buffer_pool final
+        : public std::enable_shared_from_this< buffer_pool >
+{
+public:
+    /// Released buffers beyond this count are deleted.
+    static constexpr std::size_t DEFAULT_MAX_CACHED_BUFFERS_COUNT = 64;
+
+public:
+    /**
+     *
+     */
+    static std::shared_ptr< buffer_pool >
+    create
+        ( std::size_t buffer_size
+        , std::size_t max_cached_buffers_count = DEFAULT_MAX_CACHED_BUFFERS_COUNT )
+    {
+        return std::shared_ptr< buffer_pool >
+                { new buffer_pool{ buffer_size
+                                 , max_cached_buffers_count } };
+    }
+
+    /**
+     *
+     */
+    buffer_pool
+        ( buffer_pool const& )
+        = delete;
+
+    /**
+     *
+     */
+    buffer_pool &
+    operator=
+        ( buffer_pool const& )
+        = delete;
+
+    /**
+     *
+     */
+    ~buffer_pool
+        ( void )
+    {
+        for ( auto b : cached_blocks_ )
+            delete b;
+    }
+
+    /**
+     *  @return A buffer of buffer_size bytes.
+     *  @note This method can be called concurrently.
+     */
+    shared_buffer
+    acquire
+        ( void )
+    {
+        shared_buffer::block * b = nullptr;
+        {
+            std::lock_guard< std::mutex > const lock{ mutex_ };
+            if ( ! cached_blocks_.empty() )
+            {
+                b = cached_blocks_.back();
+                cached_blocks_.pop_back();
+            }
+        }
+
+        if ( ! b )
+            b = new shared_buffer::block{ buffer_size_ };
+        else
+            // Restore the size the previous user may have changed,
+            // within the buffer capacity.
+            b->data_.resize( buffer_size_ );
+
+        // The pool is kept alive as long as one of its buffers is in use.
+        b->pool_ = shared_from_this();
+
+        return shared_buffer{ b };
+    }
+
+    /**
+     *
+     */
+    std::size_t
+    cached_buffers_count
+        ( void )
+        const
+    {
+        std::lock_guard< std::mutex > const lock{ mutex_ };
+        return cached_blocks_.size();
+    }
+
+private:
+    friend class shared_buffer;
+
+private:
+    /**
+     *
+     */
+    buffer_pool
+        ( std::size_t buffer_size
+        , std::size_t max_cached_buffers_count )
+            : buffer_size_{ buffer_size }
+            , max_cached_buffers_count_{ max_cached_buffers_count }
+            , mutex_{}
+            , cached_blocks_{}
+    {
+        // Recycling a block must not allocate.
+        cached_blocks_.reserve( max_cached_buffers_count_ );
+    }
+
+    /**
+     *
+     */
+    void
+    recycle
+        ( shared_buffer::block * b )
+    {
+        {
+            std::lock_guard< std::mutex > const lock{ mutex_ };
+            if ( cached_blocks_.size() < max_cached_buffers_count_ )
+            {
+                cached_blocks_.push_back( b );
+                return;
+            }
+        }
+
+        delete b;
+    }
+
+private:
+    ///
+    std::size_t buffer_size_;
+    ///
+    std::size_t max_cached_buffers_count_;
+    ///
+    mutable std::mutex mutex_;
+    ///
+    std::vector< shared_buffer::block * > cached_blocks_;
+};
+
+constexpr std::size_t buffer_pool::DEFAULT_MAX_CACHED_BUFFERS_COUNT;
+
+inline shared_buffer
+shared_buffer::allocate
+    ( std::size_t size )
+{ return shared_buffer{ new block{ size } }; }
+
+inline void
+shared_buffer::release
+    ( void ) noexcept
+{
+    if ( ! block_
+       || block_->references_count_.fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+        return;
+
+    // Keep the pool alive while the block is given back.
+    auto pool = std::move( block_->pool_ );
+    if ( pool )
+        pool->recycle( block_ );
+    else
+        delete block_;
+
+    block_ = nullptr;
+}
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
@@ -28,12 +28,20 @@
 namespace kademlia {
 namespace detail {
 
-std::size_t const ROUTING_TABLE_BUCKET_SIZE{ 20 };
-std::size_t const CONCURRENT_FIND_PEER_REQUESTS_COUNT{ 3 };
-std::size_t const REDUNDANT_SAVE_COUNT{ 3 };
+std::chrono::seconds const EXPIRED_VALUES_REMOVAL_PERIOD{ 60 };
 
-std::chrono::milliseconds const INITIAL_CONTACT_RECEIVE_TIMEOUT{ 1000 };
-std::chrono::milliseconds const PEER_LOOKUP_TIMEOUT{ 200 };
+std::chrono::seconds const REPUBLICATION_ROUND_PERIOD{ 10 };
+std::size_t const REPUBLICATION_ROUND_MAX_VALUES_COUNT{ 64 };
+std::size_t const CONCURRENT_REPUBLICATIONS_COUNT{ 4 };
+
+std::chrono::seconds const BUCKETS_REFRESH_ROUND_PERIOD{ 60 };
+std::size_t const BUCKETS_REFRESH_ROUND_MAX_COUNT{ 2 };
+
+std::chrono::milliseconds const MIN_REQUEST_TIMEOUT{ 10 };
+std::chrono::milliseconds const MAX_REQUEST_TIMEOUT{ 5000 };
+
+std::size_t const MAX_CONSECUTIVE_TIMEOUTS_COUNT{ 5 };
+std::size_t const EVICTION_PINGS_COUNT{ 2 };
 
 } // namespace detail
 } // namespace kademlia
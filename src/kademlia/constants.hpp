@@ -31,21 +31,36 @@
 #endif
 
 #include <chrono>
+#include <cstddef>
 
 namespace kademlia {
 namespace detail {
 
-// k
-extern std::size_t const ROUTING_TABLE_BUCKET_SIZE;
-// a
-extern std::size_t const CONCURRENT_FIND_PEER_REQUESTS_COUNT;
-// c
-extern std::size_t const REDUNDANT_SAVE_COUNT;
+// Period of the expired values removal.
+extern std::chrono::seconds const EXPIRED_VALUES_REMOVAL_PERIOD;
 
-//
-extern std::chrono::milliseconds const INITIAL_CONTACT_RECEIVE_TIMEOUT;
-//
-extern std::chrono::milliseconds const PEER_LOOKUP_TIMEOUT;
+// Period of the republication rounds, shortened to the
+// republication interval if shorter.
+extern std::chrono::seconds const REPUBLICATION_ROUND_PERIOD;
+// Values republished per round at most.
+extern std::size_t const REPUBLICATION_ROUND_MAX_VALUES_COUNT;
+// Values republished concurrently at most.
+extern std::size_t const CONCURRENT_REPUBLICATIONS_COUNT;
+
+// Period of the idle buckets refresh rounds, delayed by up to a half.
+extern std::chrono::seconds const BUCKETS_REFRESH_ROUND_PERIOD;
+// Buckets refreshed per round at most.
+extern std::size_t const BUCKETS_REFRESH_ROUND_MAX_COUNT;
+
+// Bounds of the request timeouts computed from the peers round trip time.
+extern std::chrono::milliseconds const MIN_REQUEST_TIMEOUT;
+extern std::chrono::milliseconds const MAX_REQUEST_TIMEOUT;
+
+// Requests timed out in a row past which a peer is removed.
+extern std::size_t const MAX_CONSECUTIVE_TIMEOUTS_COUNT;
+// Pings the least recently seen peer of a bucket fails
+// to answer before being evicted.
+extern std::size_t const EVICTION_PINGS_COUNT;
 
 } // namespace detail
 } // namespace kademlia
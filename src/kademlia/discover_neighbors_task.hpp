@@ -33,8 +33,10 @@
 #include <system_error>
 #include <memory>
 #include <type_traits>
+#include <utility>
 
 #include <kademlia/error.hpp>
+#include <kademlia/session_configuration.hpp>
 
 #include "log.hpp"
 #include "constants.hpp"
@@ -70,14 +72,16 @@ public:
         , tracker_type & tracker
         , routing_table_type & routing_table
         , endpoints_type const& endpoints_to_query
-        , on_complete_type const& on_complete )
+        , on_complete_type const& on_complete
+        , session_configuration const& configuration )
     {
         std::shared_ptr< discover_neighbors_task > d;
         d.reset( new discover_neighbors_task( my_id
                                             , tracker
                                             , routing_table
                                             , endpoints_to_query
-                                            , on_complete ) );
+                                            , on_complete
+                                            , configuration ) );
 
         search_ourselves( d );
     }
@@ -91,9 +95,11 @@ private:
         , tracker_type & tracker
         , routing_table_type & routing_table
         , endpoints_type const& endpoints_to_query
-        , on_complete_type const& on_complete )
+        , on_complete_type const& on_complete
+        , session_configuration const& configuration )
             : my_id_( my_id )
             , tracker_( tracker )
+            , configuration_( configuration )
             , routing_table_( routing_table )
             , endpoints_to_query_( endpoints_to_query )
             , on_complete_( on_complete )
@@ -139,9 +145,9 @@ private:
 
         task->tracker_.send_request( find_peer_request_body{ task->my_id_ }
                                    , endpoint_to_query
-                                   , INITIAL_CONTACT_RECEIVE_TIMEOUT
-                                   , on_message_received
-                                   , on_error );
+                                   , task->configuration_.initial_contact_timeout()
+                                   , std::move( on_message_received )
+                                   , std::move( on_error ) );
     }
 
     /**
@@ -198,6 +204,8 @@ private:
     ///
     tracker_type & tracker_;
     ///
+    session_configuration const configuration_;
+    ///
     routing_table_type & routing_table_;
     ///
     endpoints_type endpoints_to_query_;
@@ -218,7 +226,8 @@ start_discover_neighbors_task
     , TrackerType & tracker
     , RoutingTableType & routing_table
     , EndpointsType const& endpoints_to_query
-    , OnCompleteType const& on_complete )
+    , OnCompleteType const& on_complete
+    , session_configuration const& configuration = session_configuration{} )
 {
     using task = discover_neighbors_task< TrackerType
                                         , RoutingTableType
@@ -226,7 +235,8 @@ start_discover_neighbors_task
                                         , OnCompleteType >;
 
     task::start( my_id, tracker, routing_table
-               , endpoints_to_query, on_complete );
+               , endpoints_to_query, on_complete
+               , configuration );
 }
 
 } // namespace detail
@@ -31,18 +31,23 @@
 #endif
 
 #include <algorithm>
+#include <iterator>
 #include <stdexcept>
 #include <queue>
 #include <chrono>
 #include <random>
 #include <memory>
 #include <utility>
+#include <vector>
+#include <tuple>
 #include <type_traits>
 #include <functional>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
 
 #include <kademlia/endpoint.hpp>
 #include <kademlia/error.hpp>
+#include <kademlia/session_configuration.hpp>
 
 #include "log.hpp"
 #include "ip_endpoint.hpp"
@@ -56,15 +61,18 @@
 #include "store_value_task.hpp"
 #include "discover_neighbors_task.hpp"
 #include "notify_peer_task.hpp"
+#include "evict_peer_task.hpp"
 #include "tracker.hpp"
 
 namespace kademlia {
 namespace detail {
 
 /**
- *
+ *  @note RoutingTableType is either routing_table or
+ *        tree_routing_table of ip_endpoint.
  */
-template< typename UnderlyingSocketType >
+template< typename UnderlyingSocketType
+        , typename RoutingTableType = routing_table< ip_endpoint > >
 class engine final
 {
 public:
@@ -78,10 +86,10 @@ public:
     using endpoint_type = ip_endpoint;
 
     ///
-    using routing_table_type = routing_table< endpoint_type >;
+    using routing_table_type = RoutingTableType;
 
     ///
-    using value_store_type = value_store< id, data_type >;
+    using value_store_type = sharded_value_store< id, buffer_view >;
 
 public:
     /**
@@ -91,9 +99,12 @@ public:
         ( boost::asio::io_service & io_service
         , endpoint const& ipv4
         , endpoint const& ipv6
-        , id const& new_id = id{} )
-            : random_engine_( std::random_device{}() )
+        , id const& new_id = id{}
+        , session_configuration const& configuration = session_configuration{} )
+            : configuration_( configuration )
+            , random_engine_( std::random_device{}() )
             , my_id_( new_id == id{} ? id{ random_engine_ } : new_id )
+            , strand_( io_service )
             , network_( io_service
                       , message_socket_type::ipv4( io_service, ipv4 )
                       , message_socket_type::ipv6( io_service, ipv6 )
@@ -101,15 +112,26 @@ public:
                                  , this
                                  , std::placeholders::_1
                                  , std::placeholders::_2
-                                 , std::placeholders::_3 ) )
-            , tracker_( io_service
+                                 , std::placeholders::_3
+                                 , std::placeholders::_4 ) )
+            , routing_table_( my_id_, configuration_.bucket_size() )
+            , closest_peers_( configuration_.bucket_size() )
+            , tracker_( strand_
                       , my_id_
                       , network_
-                      , random_engine_ )
-            , routing_table_( my_id_ )
-            , value_store_()
+                      , random_engine_
+                      , routing_table_ )
+            , value_store_( configuration_.max_stored_bytes_count() )
+            , timer_( strand_ )
+            , values_to_republish_()
+            , pending_republications_count_()
             , pending_notifications_count_()
-    { }
+    {
+        // The sooner first, hence the timer isn't rescheduled.
+        schedule_values_republication();
+        schedule_expired_values_removal();
+        schedule_idle_k_buckets_refresh();
+    }
 
     /**
      *
@@ -119,8 +141,9 @@ public:
         , endpoint const& initial_peer
         , endpoint const& ipv4
         , endpoint const& ipv6
-        , id const& new_id = id{} )
-            : engine( io_service, ipv4, ipv6, new_id )
+        , id const& new_id = id{}
+        , session_configuration const& configuration = session_configuration{} )
+            : engine( io_service, ipv4, ipv6, new_id, configuration )
     {
         LOG_DEBUG( engine, this ) << "bootstrapping using peer '"
                 << initial_peer << "'." << std::endl;
@@ -162,11 +185,25 @@ public:
         LOG_DEBUG( engine, this ) << "executing async save of key '"
                 << to_string( key ) << "'." << std::endl;
 
-        start_store_value_task( id( key )
-                              , data
-                              , tracker_
-                              , routing_table_
-                              , std::forward< HandlerType >( handler ) );
+        using handler_type = typename std::decay< HandlerType >::type;
+        auto start_task = [ this, key, data
+                          , handler = handler_type( std::forward< HandlerType >( handler ) ) ]
+            ( void ) mutable
+        {
+            id const key_id( key );
+            routing_table_.record_lookup( key_id
+                                        , routing_table_type::clock::now() );
+
+            start_store_value_task( key_id
+                                  , data
+                                  , configuration_.value_lifetime()
+                                  , tracker_
+                                  , routing_table_
+                                  , std::move( handler )
+                                  , configuration_ );
+        };
+
+        strand_.dispatch( std::move( start_task ) );
     }
 
     /**
@@ -181,12 +218,44 @@ public:
         LOG_DEBUG( engine, this ) << "executing async load of key '"
                 << to_string( key ) << "'." << std::endl;
 
-        start_find_value_task< data_type >( id( key )
-                                          , tracker_
-                                          , routing_table_
-                                          , std::forward< HandlerType >( handler ) );
+        using handler_type = typename std::decay< HandlerType >::type;
+        auto start_task = [ this, key
+                          , handler = handler_type( std::forward< HandlerType >( handler ) ) ]
+            ( void ) mutable
+        {
+            id const key_id( key );
+            routing_table_.record_lookup( key_id
+                                        , routing_table_type::clock::now() );
+
+            start_find_value_task< data_type >( key_id
+                                              , tracker_
+                                              , routing_table_
+                                              , std::move( handler )
+                                              , configuration_ );
+        };
+
+        strand_.dispatch( std::move( start_task ) );
     }
 
+    /**
+     *  @brief Execute handler from the strand serializing
+     *         access to the engine state.
+     */
+    template< typename HandlerType >
+    void
+    post
+        ( HandlerType && handler )
+    { strand_.post( std::forward< HandlerType >( handler ) ); }
+
+    /**
+     *  @note This method can be called concurrently.
+     */
+    value_store_statistics
+    stored_values_statistics
+        ( void )
+        const
+    { return value_store_.statistics(); }
+
 private:
     ///
     using pending_task_type = std::function< void ( void ) >;
@@ -201,15 +270,180 @@ private:
     using random_engine_type = std::default_random_engine;
 
     ///
-    using tracker_type = tracker< random_engine_type, network_type >;
+    using tracker_type = tracker< random_engine_type
+                                , network_type
+                                , routing_table_type >;
 
 private:
+    /**
+     *  Expired values are never returned, this periodic
+     *  removal releases the memory they hold.
+     */
+    void
+    schedule_expired_values_removal
+        ( void )
+    {
+        auto on_fire = [ this ]
+        {
+            auto const count = value_store_.remove_expired
+                    ( value_store_type::clock::now() );
+
+            LOG_DEBUG( engine, this ) << "removed " << count
+                    << " expired value(s)." << std::endl;
+
+            schedule_expired_values_removal();
+        };
+
+        timer_.expires_from_now( EXPIRED_VALUES_REMOVAL_PERIOD, on_fire );
+    }
+
+    /**
+     *  Values received from peers are republished to the peers
+     *  currently the closest to their key, as they may have changed
+     *  since the value has been stored. A value received again
+     *  within the interval has just been republished by another peer,
+     *  hence isn't republished. Republished values keep their
+     *  expiration time, only their publisher can extend it.
+     */
+    void
+    schedule_values_republication
+        ( void )
+    {
+        auto on_fire = [ this ]
+        {
+            // A round starts once the previous one is over, and runs
+            // a bounded count of tasks concurrently, hence republication
+            // doesn't starve lookups.
+            if ( values_to_republish_.empty() && ! pending_republications_count_ )
+            {
+                auto const now = value_store_type::clock::now();
+                value_store_.collect_values_to_republish
+                        ( now
+                        , now + configuration_.value_republication_interval()
+                        , REPUBLICATION_ROUND_MAX_VALUES_COUNT
+                        , std::back_inserter( values_to_republish_ ) );
+
+                LOG_DEBUG( engine, this ) << "republishing "
+                        << values_to_republish_.size()
+                        << " value(s)." << std::endl;
+
+                while ( ! values_to_republish_.empty()
+                      && pending_republications_count_ < CONCURRENT_REPUBLICATIONS_COUNT )
+                    republish_next_value();
+            }
+
+            schedule_values_republication();
+        };
+
+        using duration = session_configuration::duration_type;
+        timer_.expires_from_now
+                ( std::min< duration >( REPUBLICATION_ROUND_PERIOD
+                                      , configuration_.value_republication_interval() )
+                , on_fire );
+    }
+
+    /**
+     *  Buckets without lookup for bucket_refresh_interval
+     *  are refreshed by looking up a random id they cover.
+     *  Rounds run at least once per interval, are delayed by
+     *  a random jitter, hence peers started together don't
+     *  refresh in sync, and refresh a bounded count of buckets.
+     */
+    void
+    schedule_idle_k_buckets_refresh
+        ( void )
+    {
+        auto on_fire = [ this ]
+        {
+            auto const now = routing_table_type::clock::now();
+
+            std::vector< std::size_t > indexes;
+            routing_table_.find_idle_k_buckets
+                    ( now - configuration_.bucket_refresh_interval()
+                    , BUCKETS_REFRESH_ROUND_MAX_COUNT
+                    , std::back_inserter( indexes ) );
+
+            for ( auto const index : indexes )
+            {
+                auto const refresh_id = routing_table_.random_id_in_k_bucket
+                        ( index, random_engine_ );
+
+                LOG_DEBUG( engine, this ) << "refreshing bucket "
+                        << index << " with '" << refresh_id << "'."
+                        << std::endl;
+
+                routing_table_.record_lookup( refresh_id, now );
+                start_notify_peer_task( refresh_id
+                                      , tracker_, routing_table_
+                                      , [] {}
+                                      , configuration_ );
+            }
+
+            schedule_idle_k_buckets_refresh();
+        };
+
+        using duration = session_configuration::duration_type;
+        auto const period = std::min< duration >
+                ( BUCKETS_REFRESH_ROUND_PERIOD
+                , configuration_.bucket_refresh_interval() );
+
+        std::uniform_int_distribution< duration::rep > jitter
+                { 0, period.count() / 2 };
+
+        timer_.expires_from_now( period + duration{ jitter( random_engine_ ) }
+                               , on_fire );
+    }
+
     /**
      *
      */
     void
+    republish_next_value
+        ( void )
+    {
+        auto value = std::move( values_to_republish_.back() );
+        values_to_republish_.pop_back();
+
+        // The value may have expired while waiting for its turn.
+        auto const lifetime = std::chrono::duration_cast< std::chrono::milliseconds >
+                ( std::get< 2 >( value ) - value_store_type::clock::now() );
+        if ( lifetime <= std::chrono::milliseconds::zero() )
+        {
+            if ( ! values_to_republish_.empty() )
+                republish_next_value();
+            return;
+        }
+
+        ++ pending_republications_count_;
+
+        auto on_republished = [ this ] ( std::error_code const& failure )
+        {
+            if ( failure )
+                LOG_DEBUG( engine, this ) << "failed to republish value ("
+                        << failure.message() << ")." << std::endl;
+
+            -- pending_republications_count_;
+            if ( ! values_to_republish_.empty() )
+                republish_next_value();
+        };
+
+        start_store_value_task( std::get< 0 >( value )
+                              , data_type( std::get< 1 >( value ).begin()
+                                         , std::get< 1 >( value ).end() )
+                              , lifetime
+                              , tracker_
+                              , routing_table_
+                              , on_republished
+                              , configuration_ );
+    }
+
+    /**
+     *  @note This method can be called concurrently.
+     */
+    void
     process_new_message
         ( ip_endpoint const& sender
+        , shared_buffer const& message
         , header const& h
         , buffer::const_iterator i
         , buffer::const_iterator e )
@@ -220,7 +454,7 @@ private:
                 handle_ping_request( sender, h );
                 break;
             case header::STORE_REQUEST:
-                handle_store_request( sender, h, i, e );
+                handle_store_request( sender, message, h, i, e );
                 break;
             case header::FIND_PEER_REQUEST:
                 handle_find_peer_request( sender, h, i, e );
@@ -229,7 +463,7 @@ private:
                 handle_find_value_request( sender, h, i, e );
                 break;
             default:
-                tracker_.handle_new_response( sender, h, i, e );
+                handle_new_response( sender, message, h, i, e );
                 break;
         }
     }
@@ -247,6 +481,8 @@ private:
         tracker_.send_response( h.random_token_
                               , header::PING_RESPONSE
                               , sender );
+
+        update_routing_table( sender, h );
     }
 
     /**
@@ -255,6 +491,7 @@ private:
     void
     handle_store_request
         ( ip_endpoint const& sender
+        , shared_buffer const& message
         , header const& h
         , buffer::const_iterator i
         , buffer::const_iterator e )
@@ -262,8 +499,10 @@ private:
         LOG_DEBUG( engine, this ) << "handling store request."
                 << std::endl;
 
-        store_value_request_body request;
-        if ( auto failure = deserialize( i, e, request ) )
+        // The value refers to the received message rather than
+        // being copied out of it.
+        store_value_request_view request;
+        if ( auto failure = deserialize( message, i, e, request ) )
         {
             LOG_DEBUG( engine, this )
                     << "failed to deserialize store value request ("
@@ -272,8 +511,28 @@ private:
             return;
         }
 
-        value_store_[ request.data_key_hash_ ]
-                = std::move( request.data_value_ );
+        // The value keeps the expiration time its publisher
+        // requested, within the lifetime this peer accepts,
+        // which is used if the request doesn't provide one.
+        auto const lifetime = std::min( request.data_lifetime_
+                                      , configuration_.value_lifetime() );
+        if ( lifetime <= std::chrono::milliseconds::zero() )
+        {
+            LOG_DEBUG( engine, this ) << "value already expired."
+                    << std::endl;
+
+            return;
+        }
+
+        auto const now = value_store_type::clock::now();
+        if ( ! value_store_.insert_or_assign( request.data_key_hash_
+                                            , request.data_value_.compact()
+                                            , now + lifetime
+                                            , now + configuration_.value_republication_interval() ) )
+            LOG_DEBUG( engine, this ) << "value too large to be stored."
+                    << std::endl;
+
+        update_routing_table( sender, h );
     }
 
     /**
@@ -300,9 +559,30 @@ private:
             return;
         }
 
-        send_find_peer_response( sender
-                               , h.random_token_
-                               , request.peer_to_find_id_ );
+        async_send_find_peer_response( sender, h, request.peer_to_find_id_ );
+    }
+
+    /**
+     *
+     */
+    void
+    async_send_find_peer_response
+        ( ip_endpoint const& sender
+        , header const& h
+        , id const& peer_to_find_id )
+    {
+        // The routing table is only accessed from the strand.
+        auto send_response = [ this, sender, h, peer_to_find_id ]
+            ( void )
+        {
+            add_to_routing_table( h.source_id_, sender );
+
+            send_find_peer_response( sender
+                                   , h.random_token_
+                                   , peer_to_find_id );
+        };
+
+        strand_.dispatch( std::move( send_response ) );
     }
 
     /**
@@ -318,11 +598,12 @@ private:
         // their location into the response..
         find_peer_response_body response;
 
-        auto remaining_peer = ROUTING_TABLE_BUCKET_SIZE;
-        for ( auto i = routing_table_.find( peer_to_find_id )
-                 , e = routing_table_.end()
-            ; i != e && remaining_peer > 0
-            ; ++i, -- remaining_peer )
+        auto const e = routing_table_.closest( peer_to_find_id
+                                             , closest_peers_.size()
+                                             , closest_peers_.begin() );
+
+        response.peers_.reserve( std::distance( closest_peers_.begin(), e ) );
+        for ( auto i = closest_peers_.begin(); i != e; ++ i )
             response.peers_.push_back( { i->first, i->second } );
 
         // Now send the response.
@@ -352,20 +633,80 @@ private:
             return;
         }
 
-        auto found = value_store_.find( request.value_to_find_ );
-        if ( found == value_store_.end() )
-            send_find_peer_response( sender
-                                   , h.random_token_
-                                   , request.value_to_find_ );
+        buffer_view value;
+        if ( ! value_store_.find( request.value_to_find_
+                                , value
+                                , value_store_type::clock::now() ) )
+            async_send_find_peer_response( sender
+                                         , h
+                                         , request.value_to_find_ );
         else
         {
-            find_value_response_body const response{ found->second };
+            find_value_response_body const response
+                    { data_type( value.begin(), value.end() ) };
             tracker_.send_response( h.random_token_
                                   , response
                                   , sender );
+
+            update_routing_table( sender, h );
         }
     }
 
+    /**
+     *
+     */
+    void
+    handle_new_response
+        ( ip_endpoint const& sender
+        , shared_buffer const& message
+        , header const& h
+        , buffer::const_iterator i
+        , buffer::const_iterator e )
+    {
+        // The message buffer is kept alive until
+        // the response is handled from the strand.
+        auto forward_response = [ this, sender, message, h, i, e ]
+            ( void )
+        {
+            add_to_routing_table( h.source_id_, sender );
+
+            tracker_.handle_new_response( sender, h, i, e );
+        };
+
+        strand_.dispatch( std::move( forward_response ) );
+    }
+
+    /**
+     *
+     */
+    void
+    update_routing_table
+        ( ip_endpoint const& sender
+        , header const& h )
+    {
+        auto push = [ this, sender, h ] ( void )
+        { add_to_routing_table( h.source_id_, sender ); };
+
+        strand_.dispatch( std::move( push ) );
+    }
+
+    /**
+     *  @brief Push a peer which has been seen, the least
+     *         recently seen peer of its bucket being pinged
+     *         and replaced on failure if the bucket is full.
+     *  @note This method must be called from the strand.
+     */
+    void
+    add_to_routing_table
+        ( id const& peer_id
+        , ip_endpoint const& sender )
+    {
+        if ( ! routing_table_.push( peer_id, sender ) )
+            start_evict_peer_task( peer{ peer_id, sender }
+                                 , tracker_, routing_table_
+                                 , configuration_ );
+    }
+
     /**
      *
      */
@@ -390,7 +731,8 @@ private:
 
         start_discover_neighbors_task( my_id_, tracker_, routing_table_
                                      , std::move( endoints_to_query )
-                                     , on_discovery );
+                                     , on_discovery
+                                     , configuration_ );
     }
 
     /**
@@ -442,7 +784,8 @@ private:
             refresh_id[ i ] = ! refresh_id[ i ];
             start_notify_peer_task( refresh_id
                                   , tracker_, routing_table_
-                                  , on_notification_complete );
+                                  , on_notification_complete
+                                  , configuration_ );
             -- i;
         }
     }
@@ -453,6 +796,7 @@ private:
     void
     handle_new_message
         ( ip_endpoint const& sender
+        , shared_buffer const& message
         , buffer::const_iterator i
         , buffer::const_iterator e  )
     {
@@ -469,24 +813,35 @@ private:
             return;
         }
 
-        routing_table_.push( h.source_id_, sender );
-
-        process_new_message( sender, h, i, e );
+        process_new_message( sender, message, h, i, e );
     }
 
 private:
+    ///
+    session_configuration const configuration_;
     ///
     random_engine_type random_engine_;
     ///
     id my_id_;
+    /// Serializes access to the routing table, the tracker and the tasks.
+    boost::asio::io_service::strand strand_;
     ///
     network_type network_;
+    /// Also holds the peers round trip time estimates.
+    routing_table_type routing_table_;
+    /// Reused by the find peer responses.
+    std::vector< typename routing_table_type::value_type > closest_peers_;
     ///
     tracker_type tracker_;
     ///
-    routing_table_type routing_table_;
-    ///
     value_store_type value_store_;
+    /// Schedules the value store maintenance.
+    timer timer_;
+    /// Values of the current republication round not republished yet.
+    std::vector< std::tuple< id, buffer_view, value_store_type::time_point > >
+            values_to_republish_;
+    ///
+    std::size_t pending_republications_count_;
     ///
     std::size_t pending_notifications_count_;
 };
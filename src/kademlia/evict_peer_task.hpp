@@ -0,0 +1,165 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_EVICT_PEER_TASK_HPP
+#define KADEMLIA_EVICT_PEER_TASK_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <cstddef>
+#include <system_error>
+#include <utility>
+
+#include <kademlia/session_configuration.hpp>
+
+#include "constants.hpp"
+#include "log.hpp"
+#include "message.hpp"
+#include "peer.hpp"
+#include "timer.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief This class represents an eviction task.
+ *  @details
+ *  Its purpose is to ping the least recently seen peer
+ *  of the full bucket a new peer belongs to, the most
+ *  recently seen peer of the bucket replacement cache
+ *  replacing it only if it fails to answer, hence long
+ *  lived peers are preferred to newcomers.
+ */
+template< typename TrackerType, typename RoutingTableType >
+class evict_peer_task final
+{
+public:
+    ///
+    using tracker_type = TrackerType;
+
+    ///
+    using routing_table_type = RoutingTableType;
+
+    ///
+    using endpoint_type = typename tracker_type::endpoint_type;
+
+public:
+    /**
+     *
+     */
+    static void
+    start
+        ( peer const& new_peer
+        , tracker_type & tracker
+        , routing_table_type & routing_table
+        , session_configuration const& configuration )
+    {
+        // Either the bucket has room, the peer is already known
+        // or the oldest peer is already being pinged.
+        typename routing_table_type::value_type oldest;
+        if ( ! routing_table.find_eviction_candidate( new_peer.id_, oldest ) )
+            return;
+
+        peer const oldest_peer{ oldest.first, oldest.second };
+
+        LOG_DEBUG( evict_peer_task, &routing_table )
+                << "pinging '" << oldest_peer << "' as '"
+                << new_peer << "' has been seen." << std::endl;
+
+        ping( oldest_peer, EVICTION_PINGS_COUNT
+            , tracker, routing_table
+            , configuration.peer_lookup_timeout() );
+    }
+
+private:
+    /**
+     *  @brief Ping the oldest peer, evicting it once
+     *         pings_count pings have failed.
+     *  @details
+     *  A single lost datagram or a round trip time above
+     *  the timeout learnt from the peer must not evict it,
+     *  hence the ping is retried, the tracker having backed
+     *  off the timeout of the peer meanwhile.
+     */
+    static void
+    ping
+        ( peer const& oldest_peer
+        , std::size_t pings_count
+        , tracker_type & tracker
+        , routing_table_type & routing_table
+        , timer::duration const& default_timeout )
+    {
+        auto on_message_received = [ &routing_table, oldest_peer ]
+            ( endpoint_type const&
+            , header const&
+            , buffer::const_iterator
+            , buffer::const_iterator )
+        { routing_table.cancel_eviction( oldest_peer.id_ ); };
+
+        auto on_error = [ &tracker, &routing_table, oldest_peer
+                        , pings_count, default_timeout ]
+            ( std::error_code const& )
+        {
+            LOG_DEBUG( evict_peer_task, &routing_table )
+                    << "'" << oldest_peer << "' failed to answer ping."
+                    << std::endl;
+
+            if ( pings_count > 1 )
+                ping( oldest_peer, pings_count - 1
+                    , tracker, routing_table, default_timeout );
+            else
+                routing_table.evict( oldest_peer.id_ );
+        };
+
+        tracker.send_request( header::PING_REQUEST
+                            , oldest_peer
+                            , default_timeout
+                            , std::move( on_message_received )
+                            , std::move( on_error ) );
+    }
+};
+
+/**
+ *
+ */
+template< typename TrackerType, typename RoutingTableType >
+void
+start_evict_peer_task
+    ( peer const& new_peer
+    , TrackerType & tracker
+    , RoutingTableType & routing_table
+    , session_configuration const& configuration = session_configuration{} )
+{
+    using task = evict_peer_task< TrackerType, RoutingTableType >;
+
+    task::start( new_peer, tracker, routing_table, configuration );
+}
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
@@ -30,16 +30,23 @@
 #   pragma once
 #endif
 
+#include <algorithm>
 #include <system_error>
 #include <memory>
+#include <set>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <kademlia/error.hpp>
+#include <kademlia/session_configuration.hpp>
 
 #include "lookup_task.hpp"
 #include "log.hpp"
 #include "constants.hpp"
+#include "ip_endpoint.hpp"
 #include "message.hpp"
+#include "timer.hpp"
 
 namespace kademlia {
 namespace detail {
@@ -50,6 +57,12 @@ namespace detail {
  *  Its purpose is to perform network request
  *  to find the peer response of storing a value.
  *
+ *  The closest known peers are dealt to disjoint_paths_count
+ *  lookups run in parallel, a peer being queried by at most
+ *  one of them. The first path finding the value completes
+ *  the task, hence a slow or malicious region of the network
+ *  can only stall the paths going through it.
+ *
  *  @dot
  *  digraph algorithm {
  *      fontsize=12
@@ -84,7 +97,6 @@ namespace detail {
  */
 template< typename LoadHandlerType, typename TrackerType, typename DataType >
 class find_value_task final
-    : public lookup_task
 {
 public:
     ///
@@ -106,17 +118,39 @@ public:
         ( detail::id const & key
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , load_handler_type handler )
+        , load_handler_type handler
+        , session_configuration const& configuration )
     {
         std::shared_ptr< find_value_task > t;
         t.reset( new find_value_task( key
                                     , tracker
                                     , routing_table
-                                    , std::move( handler ) ) );
+                                    , std::move( handler )
+                                    , configuration ) );
 
-        try_candidates( t );
+        for ( std::size_t i = 0, e = t->paths_.size(); i != e; ++ i )
+            try_candidates( t, i );
     }
 
+private:
+    ///
+    struct path final
+        : lookup_task
+    {
+        template< typename Iterator >
+        path
+            ( id const & key
+            , Iterator i, Iterator e
+            , std::size_t closest_count
+            , std::size_t max_candidates_count )
+                : lookup_task( key, i, e, closest_count
+                             , max_candidates_count )
+        { }
+    };
+
+    ///
+    using paths_type = std::vector< path >;
+
 private:
     /**
      *
@@ -126,17 +160,74 @@ private:
         ( id const & searched_key
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , load_handler_type load_handler )
-            : lookup_task( searched_key
-                         , routing_table.find( searched_key )
-                         , routing_table.end() )
+        , load_handler_type load_handler
+        , session_configuration const& configuration )
+            : key_( searched_key )
             , tracker_( tracker )
+            , configuration_( configuration )
             , load_handler_( std::move( load_handler ) )
+            , paths_()
+            , claimed_peers_()
             , is_finished_()
     {
         LOG_DEBUG( find_value_task, this )
                 << "create find value task for '"
                 << searched_key << "' value." << std::endl;
+
+        create_paths( routing_table.find( searched_key )
+                    , routing_table.end() );
+    }
+
+    /**
+     *  @brief Deal the known peers, closest first,
+     *         to the disjoint paths.
+     */
+    template< typename Iterator >
+    void
+    create_paths
+        ( Iterator i, Iterator e )
+    {
+        auto const closest_count = configuration_.bucket_size();
+        auto const max_candidates_count = std::max
+                ( configuration_.lookup_candidates_count(), closest_count );
+        auto const paths_count = std::max< std::size_t >
+                ( 1, configuration_.disjoint_paths_count() );
+
+        paths_.reserve( paths_count );
+
+        if ( paths_count == 1 )
+        {
+            paths_.emplace_back( key_, i, e
+                               , closest_count, max_candidates_count );
+            return;
+        }
+
+        // Each path keeps at most max_candidates_count candidates.
+        std::vector< std::pair< id, ip_endpoint > > peers;
+        for ( ; i != e; ++ i )
+            peers.emplace_back( i->first, i->second );
+
+        auto const kept_count = std::min( peers.size()
+                                        , paths_count * max_candidates_count );
+        std::partial_sort( peers.begin(), peers.begin() + kept_count
+                         , peers.end()
+                         , [ this ]( std::pair< id, ip_endpoint > const& a
+                                   , std::pair< id, ip_endpoint > const& b )
+                           { return distance( a.first, key_ )
+                                  < distance( b.first, key_ ); } );
+        peers.resize( kept_count );
+
+        std::vector< std::pair< id, ip_endpoint > > path_peers;
+        for ( std::size_t p = 0; p != paths_count; ++ p )
+        {
+            path_peers.clear();
+            for ( std::size_t j = p; j < peers.size(); j += paths_count )
+                path_peers.push_back( peers[ j ] );
+
+            paths_.emplace_back( key_
+                               , path_peers.begin(), path_peers.end()
+                               , closest_count, max_candidates_count );
+        }
     }
 
     /**
@@ -172,22 +263,70 @@ private:
         const
     { return is_finished_; }
 
+    /**
+     *  @return true once every path has converged.
+     */
+    bool
+    is_converged
+        ( void )
+        const
+    {
+        return std::all_of( paths_.begin(), paths_.end()
+                          , []( path const& p ) { return p.is_converged(); } );
+    }
+
+    /**
+     *  @brief Select the next candidates of the path_index path,
+     *         skipping the peers already claimed by another path.
+     */
+    std::vector< peer >
+    select_new_closest_candidates
+        ( std::size_t path_index )
+    {
+        auto & p = paths_[ path_index ];
+        auto const max_count = configuration_.concurrent_requests_count();
+
+        if ( paths_.size() == 1 )
+            return p.select_new_closest_candidates( max_count );
+
+        std::vector< peer > selected;
+        for ( auto candidates = p.select_new_closest_candidates( max_count )
+            ; ! candidates.empty()
+            ; candidates = p.select_new_closest_candidates( max_count ) )
+        {
+            for ( auto const& c : candidates )
+            {
+                if ( claimed_peers_.insert( c.id_ ).second )
+                    selected.push_back( c );
+                else
+                    // Another path queried it, try the next one.
+                    p.flag_candidate_as_invalid( c.id_ );
+            }
+        }
+
+        return selected;
+    }
+
     /**
      *
      */
     static void
     try_candidates
         ( std::shared_ptr< find_value_task > task
-        , std::size_t concurrent_requests_count = CONCURRENT_FIND_PEER_REQUESTS_COUNT )
+        , std::size_t path_index )
     {
-        auto const closest_candidates = task->select_new_closest_candidates
-                ( concurrent_requests_count );
+        if ( task->is_caller_notified() )
+            return;
 
-        find_value_request_body const request{ task->get_key() };
+        auto const closest_candidates
+                = task->select_new_closest_candidates( path_index );
+
+        find_value_request_body const request{ task->key_ };
         for ( auto const& c : closest_candidates )
-            send_find_value_request( request, c, task );
+            send_find_value_request( request, c, path_index, task );
 
-        if ( task->have_all_requests_completed() )
+        // The closest peers of each path responded without the value.
+        if ( task->is_converged() )
             task->notify_caller( make_error_code( VALUE_NOT_FOUND ) );
     }
 
@@ -198,43 +337,104 @@ private:
     send_find_value_request
         ( find_value_request_body const& request
         , peer const& current_candidate
+        , std::size_t path_index
         , std::shared_ptr< find_value_task > task )
     {
-        LOG_DEBUG( find_value_task, task.get() ) << "sending find '" << task->get_key()
+        LOG_DEBUG( find_value_task, task.get() ) << "sending find '" << task->key_
                 << "' value request to '"
                 << current_candidate << "'." << std::endl;
 
+        // The soft deadline is cancelled once the candidate
+        // responded or failed.
+        auto const soft_deadline = schedule_soft_deadline( current_candidate
+                                                         , path_index
+                                                         , task );
+
         // On message received, process it.
-        auto on_message_received = [ task, current_candidate ]
+        auto on_message_received = [ task, candidate_id = current_candidate.id_
+                                   , path_index, soft_deadline ]
             ( ip_endpoint const& s
             , header const& h
             , buffer::const_iterator i
             , buffer::const_iterator e )
         {
+            task->tracker_.cancel( soft_deadline );
+
             if ( task->is_caller_notified() )
                 return;
 
-            task->flag_candidate_as_valid( current_candidate.id_ );
-            handle_find_value_response( s, h, i, e, task );
+            task->paths_[ path_index ].flag_candidate_as_valid( candidate_id );
+            handle_find_value_response( s, h, i, e, path_index, task );
         };
 
         // On error, retry with another endpoint.
-        auto on_error = [ task, current_candidate ]
+        auto on_error = [ task, candidate_id = current_candidate.id_
+                        , path_index, soft_deadline ]
             ( std::error_code const& )
         {
+            task->tracker_.cancel( soft_deadline );
+
             if ( task->is_caller_notified() )
                 return;
 
-            // XXX: Current current_candidate must be flagged as stale.
-            task->flag_candidate_as_invalid( current_candidate.id_ );
-            try_candidates( task );
+            // The tracker has already reported a timeout to the
+            // routing table, which drops peers timing out repeatedly.
+            task->paths_[ path_index ].flag_candidate_as_invalid( candidate_id );
+            try_candidates( task, path_index );
         };
 
         task->tracker_.send_request( request
-                                   , current_candidate.endpoint_
-                                   , PEER_LOOKUP_TIMEOUT
-                                   , on_message_received
-                                   , on_error );
+                                   , current_candidate
+                                   , task->configuration_.peer_lookup_timeout()
+                                   , std::move( on_message_received )
+                                   , std::move( on_error ) );
+    }
+
+    /**
+     *  @brief If hedging is enabled, query the next closest
+     *         candidate when current_candidate is slower than
+     *         usual, i.e. than its round trip time estimates or
+     *         if unknown, than the configured percentile of the
+     *         round trip times.
+     *  @return The handle of the soft deadline, if any.
+     */
+    static timer::handle
+    schedule_soft_deadline
+        ( peer const& current_candidate
+        , std::size_t path_index
+        , std::shared_ptr< find_value_task > task )
+    {
+        auto const percentile = task->configuration_.hedged_requests_percentile();
+        if ( percentile <= 0. )
+            return timer::handle{};
+
+        // Until a round trip time is known, only the timeout applies.
+        timer::duration const soft_deadline
+                = task->tracker_.request_soft_timeout( current_candidate.id_
+                                                     , percentile );
+        if ( soft_deadline == timer::duration::zero() )
+            return timer::handle{};
+
+        auto on_soft_deadline = [ task, candidate_id = current_candidate.id_
+                                , path_index ]
+            ( void )
+        {
+            if ( task->is_caller_notified() )
+                return;
+
+            // The candidate has responded or failed meanwhile.
+            if ( ! task->paths_[ path_index ]
+                        .flag_candidate_as_slow( candidate_id ) )
+                return;
+
+            LOG_DEBUG( find_value_task, task.get() ) << "hedging slow '"
+                    << candidate_id << "' request." << std::endl;
+
+            try_candidates( task, path_index );
+        };
+
+        return task->tracker_.expires_from_now( soft_deadline
+                                              , std::move( on_soft_deadline ) );
     }
 
     /**
@@ -247,17 +447,18 @@ private:
         , header const& h
         , buffer::const_iterator i
         , buffer::const_iterator e
+        , std::size_t path_index
         , std::shared_ptr< find_value_task > task )
     {
         LOG_DEBUG( find_value_task, task.get() )
                 << "handling response type '"
                 << int( h.type_ ) << "' to find '"
-                << task->get_key() << "' value." << std::endl;
+                << task->key_ << "' value." << std::endl;
 
         if ( h.type_ == header::FIND_PEER_RESPONSE )
             // The current peer didn't know the value
             // but provided closest peers.
-            send_find_value_requests_on_closer_peers( i, e, task );
+            send_find_value_requests_on_closer_peers( i, e, path_index, task );
         else if ( h.type_ == header::FIND_VALUE_RESPONSE )
             // The current peer knows the value.
             process_found_value( i, e, task );
@@ -274,10 +475,11 @@ private:
     send_find_value_requests_on_closer_peers
         ( buffer::const_iterator i
         , buffer::const_iterator e
+        , std::size_t path_index
         , std::shared_ptr< find_value_task > task )
     {
         LOG_DEBUG( find_value_task, task.get() ) << "checking if found closest peers to '"
-                << task->get_key() << "' value from closer peers."
+                << task->key_ << "' value from closer peers."
                 << std::endl;
 
         find_peer_response_body response;
@@ -285,14 +487,14 @@ private:
         {
             LOG_DEBUG( find_value_task, task.get() )
                     << "failed to deserialize find peer response '"
-                    << task->get_key() << "' because ("
+                    << task->key_ << "' because ("
                     << failure.message() << ")." << std::endl;
 
             return;
         }
 
-        task->add_candidates( response.peers_ );
-        try_candidates( task );
+        task->paths_[ path_index ].add_candidates( response.peers_ );
+        try_candidates( task, path_index );
     }
 
     /**
@@ -307,7 +509,7 @@ private:
         , std::shared_ptr< find_value_task > task )
     {
         LOG_DEBUG( find_value_task, task.get() )
-                << "found '" << task->get_key()
+                << "found '" << task->key_
                 << "' value." << std::endl;
 
         find_value_response_body response;
@@ -323,11 +525,19 @@ private:
     }
 
 private:
+    ///
+    id const key_;
     ///
     tracker_type & tracker_;
     ///
+    session_configuration const configuration_;
+    ///
     load_handler_type load_handler_;
     ///
+    paths_type paths_;
+    /// Peers queried by a path when several are followed.
+    std::set< id > claimed_peers_;
+    ///
     bool is_finished_;
 };
 
@@ -343,13 +553,15 @@ start_find_value_task
     ( id const& key
     , TrackerType & tracker
     , RoutingTableType & routing_table
-    , HandlerType && handler )
+    , HandlerType && handler
+    , session_configuration const& configuration = session_configuration{} )
 {
     using handler_type = typename std::decay< HandlerType >::type;
     using task = find_value_task< handler_type, TrackerType, DataType >;
 
     task::start( key, tracker, routing_table
-               , std::forward< HandlerType >( handler ) );
+               , std::forward< HandlerType >( handler )
+               , configuration );
 }
 
 } // namespace detail
@@ -40,16 +40,27 @@ struct first_session::impl final
      */
     impl
         ( endpoint const& listen_on_ipv4
-        , endpoint const& listen_on_ipv6 )
+        , endpoint const& listen_on_ipv6
+        , session_configuration const& configuration )
             : session_impl{ listen_on_ipv4
-                          , listen_on_ipv6 }
+                          , listen_on_ipv6
+                          , configuration }
     { }
 };
 
 first_session::first_session
     ( endpoint const& listen_on_ipv4
     , endpoint const& listen_on_ipv6 )
-        : impl_{ new impl{ listen_on_ipv4, listen_on_ipv6 } }
+        : first_session{ session_configuration{}
+                       , listen_on_ipv4
+                       , listen_on_ipv6 }
+{ }
+
+first_session::first_session
+    ( session_configuration const& configuration
+    , endpoint const& listen_on_ipv4
+    , endpoint const& listen_on_ipv6 )
+        : impl_{ new impl{ listen_on_ipv4, listen_on_ipv6, configuration } }
 { }
 
 first_session::~first_session
@@ -61,6 +72,16 @@ first_session::run
     ( void )
 { return impl_->run(); }
 
+std::error_code
+first_session::run_concurrently
+    ( std::size_t threads_count )
+{ return impl_->run( threads_count ); }
+
+std::size_t
+first_session::poll
+    ( std::size_t max_handlers_count )
+{ return impl_->poll( max_handlers_count ); }
+
 void
 first_session::abort
         ( void )
@@ -38,10 +38,37 @@
 #include <vector>
 #include <functional>
 #include <algorithm>
+#include <boost/endian/conversion.hpp>
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
 
 namespace kademlia {
 namespace detail {
 
+/**
+ *  @brief Count the number of leading zero bits of value.
+ *  @note value must not be 0.
+ */
+inline std::size_t
+count_leading_zeros
+    ( std::uint64_t value )
+{
+#if defined( __GNUC__ )
+    return std::size_t( __builtin_clzll( value ) );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+    unsigned long index;
+    _BitScanReverse64( &index, value );
+    return 63 - index;
+#else
+    std::size_t count = 0;
+    for ( ; ! ( value & 0x8000000000000000ULL ); value <<= 1 )
+        ++ count;
+    return count;
+#endif
+}
+
 ///
 class id final
 {
@@ -62,7 +89,23 @@ public:
     static constexpr std::size_t BLOCKS_COUNT = BIT_SIZE / BIT_PER_BLOCK;
 
     ///
-    using blocks_type = std::array< block_type, BLOCKS_COUNT >;
+    using iterator = block_type *;
+
+    ///
+    using const_iterator = block_type const*;
+
+    /// Blocks are packed into words in network (big-endian) order.
+    using word_type = std::uint64_t;
+
+    ///
+    static constexpr std::size_t BIT_PER_WORD = sizeof( word_type ) * 8;
+
+    ///
+    static constexpr std::size_t WORDS_COUNT
+            = ( BIT_SIZE + BIT_PER_WORD - 1 ) / BIT_PER_WORD;
+
+    ///
+    using words_type = std::array< word_type, WORDS_COUNT >;
 
     ///
     using value_to_hash_type = std::vector< std::uint8_t >;
@@ -123,7 +166,7 @@ public:
      */
     id
         ( void )
-            : blocks_{ }
+            : words_{ }
     { }
 
     /**
@@ -150,36 +193,36 @@ public:
     /**
      *  @note From msb to lsb.
      */
-    blocks_type::iterator
+    iterator
     begin
         ( void )
-    { return blocks_.begin(); }
+    { return reinterpret_cast< iterator >( words_.data() ); }
 
     /**
      *  @note From msb to lsb.
      */
-    blocks_type::iterator
+    iterator
     end
         ( void )
-    { return blocks_.end(); }
+    { return begin() + BLOCKS_COUNT; }
 
     /**
      *  @note From msb to lsb.
      */
-    blocks_type::const_iterator
+    const_iterator
     begin
         ( void )
         const
-    { return blocks_.begin(); }
+    { return reinterpret_cast< const_iterator >( words_.data() ); }
 
     /**
      *  @note From msb to lsb.
      */
-    blocks_type::const_iterator
+    const_iterator
     end
         ( void )
         const
-    { return blocks_.end(); }
+    { return begin() + BLOCKS_COUNT; }
 
     /**
      *
@@ -188,7 +231,7 @@ public:
     operator==
         ( id const& o )
         const
-    { return o.blocks_ == blocks_; }
+    { return o.words_ == words_; }
 
     /**
      *
@@ -227,7 +270,7 @@ private:
     block_type &
     get_block
         ( std::size_t index )
-    { return blocks_[ index / BIT_PER_BLOCK ]; }
+    { return begin()[ index / BIT_PER_BLOCK ]; }
 
     /**
      *
@@ -236,7 +279,17 @@ private:
     get_block
         ( std::size_t index )
         const
-    { return blocks_[ index / BIT_PER_BLOCK ]; }
+    { return begin()[ index / BIT_PER_BLOCK ]; }
+
+    /**
+     *  @brief Return the word at index as an integer
+     *         whose msb is the word first bit.
+     */
+    word_type
+    get_word
+        ( std::size_t index )
+        const
+    { return boost::endian::big_to_native( words_[ index ] ); }
 
     /**
      *
@@ -246,9 +299,24 @@ private:
         ( std::size_t index )
     { return 0x80 >> index % BIT_PER_BLOCK; }
 
+    friend bool
+    operator<
+        ( id const& a
+        , id const& b );
+
+    friend id
+    distance
+        ( id const& a
+        , id const& b );
+
+    friend std::size_t
+    common_prefix_length
+        ( id const& a
+        , id const& b );
+
 private:
-    ///
-    blocks_type blocks_;
+    /// Trailing bits past BIT_SIZE are always 0.
+    words_type words_;
 };
 
 /**
@@ -259,8 +327,13 @@ operator<
     ( id const& a
     , id const& b )
 {
-    return std::lexicographical_compare( a.begin(), a.end()
-                                       , b.begin(), b.end() );
+    for ( std::size_t i = 0; i != id::WORDS_COUNT; ++ i )
+    {
+        if ( a.words_[ i ] != b.words_[ i ] )
+            return a.get_word( i ) < b.get_word( i );
+    }
+
+    return false;
 }
 
 /**
@@ -281,13 +354,33 @@ distance
 {
     id result;
 
-    std::transform( a.begin(), a.end(), b.begin()
-                  , result.begin()
-                  , std::bit_xor< id::block_type >{} );
+    // Xor doesn't care about endianness.
+    for ( std::size_t i = 0; i != id::WORDS_COUNT; ++ i )
+        result.words_[ i ] = a.words_[ i ] ^ b.words_[ i ];
 
     return result;
 }
 
+/**
+ *  @brief Count the number of leading bits shared by a and b.
+ *  @return A value between 0 and id::BIT_SIZE (a == b).
+ */
+inline std::size_t
+common_prefix_length
+    ( id const& a
+    , id const& b )
+{
+    for ( std::size_t i = 0; i != id::WORDS_COUNT; ++ i )
+    {
+        auto const difference = a.words_[ i ] ^ b.words_[ i ];
+        if ( difference )
+            return i * id::BIT_PER_WORD + count_leading_zeros
+                    ( boost::endian::big_to_native( difference ) );
+    }
+
+    return id::BIT_SIZE;
+}
+
 } // namespace detail
 } // namespace kademlia
 
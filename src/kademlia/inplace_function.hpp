@@ -0,0 +1,344 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_INPLACE_FUNCTION_HPP
+#define KADEMLIA_INPLACE_FUNCTION_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace kademlia {
+namespace detail {
+
+/// Fits a task shared pointer along with a peer captured by value,
+/// once wrapped by the tracker along with the peer id.
+constexpr std::size_t INPLACE_FUNCTION_DEFAULT_CAPACITY = 128;
+
+///
+template< typename Signature
+        , std::size_t Capacity = INPLACE_FUNCTION_DEFAULT_CAPACITY >
+class inplace_function;
+
+/**
+ *  @brief Move only callable wrapper.
+ *
+ *  Callables up to Capacity bytes are stored inside the wrapper
+ *  hence don't allocate, bigger ones are moved to the heap.
+ */
+template< typename Result, typename... Arguments, std::size_t Capacity >
+class inplace_function< Result ( Arguments... ), Capacity > final
+{
+public:
+    /**
+     *
+     */
+    inplace_function
+        ( void )
+        noexcept
+            : storage_()
+            , operations_{ nullptr }
+    { }
+
+    /**
+     *
+     */
+    inplace_function
+        ( std::nullptr_t )
+        noexcept
+            : inplace_function{}
+    { }
+
+    /**
+     *
+     */
+    template< typename Callable
+            , typename = typename std::enable_if
+                    < ! std::is_same< typename std::decay< Callable >::type
+                                    , inplace_function >::value >::type >
+    inplace_function
+        ( Callable && callable )
+            : storage_()
+            , operations_{ nullptr }
+    {
+        using callable_type = typename std::decay< Callable >::type;
+        using storage_policy = typename std::conditional
+                < is_stored_inplace< callable_type >()
+                , inplace_storage< callable_type >
+                , heap_storage< callable_type > >::type;
+
+        storage_policy::construct( &storage_, std::forward< Callable >( callable ) );
+        operations_ = &storage_policy::OPERATIONS;
+    }
+
+    /**
+     *
+     */
+    inplace_function
+        ( inplace_function && other )
+        noexcept
+            : storage_()
+            , operations_{ other.operations_ }
+    {
+        if ( operations_ )
+            operations_->move( &other.storage_, &storage_ );
+
+        other.operations_ = nullptr;
+    }
+
+    /**
+     *
+     */
+    inplace_function &
+    operator=
+        ( inplace_function && other )
+        noexcept
+    {
+        if ( this != &other )
+        {
+            reset();
+
+            if ( other.operations_ )
+                other.operations_->move( &other.storage_, &storage_ );
+
+            operations_ = other.operations_;
+            other.operations_ = nullptr;
+        }
+
+        return *this;
+    }
+
+    /**
+     *
+     */
+    inplace_function &
+    operator=
+        ( std::nullptr_t )
+        noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    /**
+     *
+     */
+    inplace_function
+        ( inplace_function const& )
+        = delete;
+
+    /**
+     *
+     */
+    inplace_function &
+    operator=
+        ( inplace_function const& )
+        = delete;
+
+    /**
+     *
+     */
+    ~inplace_function
+        ( void )
+    { reset(); }
+
+    /**
+     *
+     */
+    explicit
+    operator bool
+        ( void )
+        const
+        noexcept
+    { return operations_ != nullptr; }
+
+    /**
+     *  @pre The function isn't empty.
+     */
+    Result
+    operator()
+        ( Arguments... arguments )
+        const
+    {
+        return operations_->invoke( const_cast< storage_type * >( &storage_ )
+                                  , std::forward< Arguments >( arguments )... );
+    }
+
+    /**
+     *  @return true if a Callable is stored without allocation.
+     */
+    template< typename Callable >
+    static constexpr bool
+    is_stored_inplace
+        ( void )
+    {
+        return sizeof( Callable ) <= Capacity
+            && alignof( Callable ) <= alignof( storage_type )
+            && std::is_nothrow_move_constructible< Callable >::value;
+    }
+
+private:
+    ///
+    using storage_type = typename std::aligned_storage< Capacity >::type;
+
+    ///
+    struct operations final
+    {
+        ///
+        Result ( * invoke )( storage_type *, Arguments &&... );
+        ///
+        void ( * move )( storage_type * from, storage_type * to );
+        ///
+        void ( * destroy )( storage_type * );
+    };
+
+    ///
+    template< typename Callable >
+    struct inplace_storage final
+    {
+        ///
+        template< typename Argument >
+        static void
+        construct
+            ( storage_type * s
+            , Argument && callable )
+        { new ( s ) Callable( std::forward< Argument >( callable ) ); }
+
+        ///
+        static Callable &
+        get
+            ( storage_type * s )
+        { return *reinterpret_cast< Callable * >( s ); }
+
+        ///
+        static Result
+        invoke
+            ( storage_type * s
+            , Arguments &&... arguments )
+        { return get( s )( std::forward< Arguments >( arguments )... ); }
+
+        ///
+        static void
+        move
+            ( storage_type * from
+            , storage_type * to )
+        {
+            new ( to ) Callable( std::move( get( from ) ) );
+            get( from ).~Callable();
+        }
+
+        ///
+        static void
+        destroy
+            ( storage_type * s )
+        { get( s ).~Callable(); }
+
+        ///
+        static constexpr operations OPERATIONS{ &invoke, &move, &destroy };
+    };
+
+    ///
+    template< typename Callable >
+    struct heap_storage final
+    {
+        ///
+        template< typename Argument >
+        static void
+        construct
+            ( storage_type * s
+            , Argument && callable )
+        { new ( s ) Callable *( new Callable( std::forward< Argument >( callable ) ) ); }
+
+        ///
+        static Callable * &
+        get
+            ( storage_type * s )
+        { return *reinterpret_cast< Callable ** >( s ); }
+
+        ///
+        static Result
+        invoke
+            ( storage_type * s
+            , Arguments &&... arguments )
+        { return ( *get( s ) )( std::forward< Arguments >( arguments )... ); }
+
+        ///
+        static void
+        move
+            ( storage_type * from
+            , storage_type * to )
+        { new ( to ) Callable *( get( from ) ); }
+
+        ///
+        static void
+        destroy
+            ( storage_type * s )
+        { delete get( s ); }
+
+        ///
+        static constexpr operations OPERATIONS{ &invoke, &move, &destroy };
+    };
+
+private:
+    /**
+     *
+     */
+    void
+    reset
+        ( void )
+        noexcept
+    {
+        if ( operations_ )
+            operations_->destroy( &storage_ );
+
+        operations_ = nullptr;
+    }
+
+private:
+    ///
+    storage_type storage_;
+    ///
+    operations const* operations_;
+};
+
+template< typename Result, typename... Arguments, std::size_t Capacity >
+template< typename Callable >
+constexpr typename inplace_function< Result ( Arguments... ), Capacity >::operations
+inplace_function< Result ( Arguments... ), Capacity >::inplace_storage< Callable >::OPERATIONS;
+
+template< typename Result, typename... Arguments, std::size_t Capacity >
+template< typename Callable >
+constexpr typename inplace_function< Result ( Arguments... ), Capacity >::operations
+inplace_function< Result ( Arguments... ), Capacity >::heap_storage< Callable >::OPERATIONS;
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
@@ -0,0 +1,472 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_K_BUCKET_HPP
+#define KADEMLIA_K_BUCKET_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "id.hpp"
+#include "rtt_estimator.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  Peers of a k_bucket are stored in parallel arrays
+ *  ordered from the oldest to the newest, ids being kept
+ *  apart so a lookup only scans a few contiguous cache lines.
+ *  @note Storage is reserved up to k_bucket_size, hence
+ *        only the largest k_bucket may allocate on push.
+ *
+ *  The peers seen while the k_bucket is full are kept in a
+ *  bounded replacement cache, also ordered from the oldest
+ *  to the newest, in order to replace the evicted entries.
+ */
+template< typename PeerType >
+class k_bucket final
+{
+public:
+    ///
+    using peer_type = PeerType;
+
+    ///
+    using value_type = std::pair< id, peer_type >;
+
+    ///
+    using reference = std::pair< id const&, peer_type & >;
+
+    ///
+    using clock = std::chrono::steady_clock;
+
+public:
+    /**
+     *
+     */
+    k_bucket
+        ( std::size_t k_bucket_size
+        , clock::time_point const& last_lookup )
+            : ids_(), peers_(), rtt_estimators_(), is_pinging_()
+            , replacements_(), last_lookup_( last_lookup )
+    {
+        ids_.reserve( k_bucket_size );
+        peers_.reserve( k_bucket_size );
+        rtt_estimators_.reserve( k_bucket_size );
+    }
+
+    /**
+     *
+     */
+    std::size_t
+    size
+        ( void )
+        const
+    { return ids_.size(); }
+
+    /**
+     *
+     */
+    bool
+    empty
+        ( void )
+        const
+    { return ids_.empty(); }
+
+    /**
+     *  @return The index of the peer or size() if it is unknown.
+     */
+    std::size_t
+    find
+        ( id const& peer_id )
+        const
+    {
+        auto const i = std::find( ids_.begin(), ids_.end(), peer_id );
+        return std::size_t( std::distance( ids_.begin(), i ) );
+    }
+
+    /**
+     *
+     */
+    void
+    push_back
+        ( id const& peer_id
+        , peer_type const& new_peer )
+    {
+        ids_.push_back( peer_id );
+        peers_.push_back( new_peer );
+        rtt_estimators_.emplace_back();
+    }
+
+    /**
+     *  @brief Make the entry at index the most recently seen one.
+     */
+    void
+    move_to_back
+        ( std::size_t index )
+    {
+        assert( index < size() && "can't move an unknown entry" );
+        std::rotate( std::next( ids_.begin(), index )
+                   , std::next( ids_.begin(), index + 1 ), ids_.end() );
+        std::rotate( std::next( peers_.begin(), index )
+                   , std::next( peers_.begin(), index + 1 ), peers_.end() );
+        std::rotate( std::next( rtt_estimators_.begin(), index )
+                   , std::next( rtt_estimators_.begin(), index + 1 )
+                   , rtt_estimators_.end() );
+    }
+
+    /**
+     *  @note Entries following index are shifted
+     *        in order to preserve their seniority.
+     */
+    void
+    erase
+        ( std::size_t index )
+    {
+        assert( index < size() && "can't erase an unknown entry" );
+        ids_.erase( std::next( ids_.begin(), index ) );
+        peers_.erase( std::next( peers_.begin(), index ) );
+        rtt_estimators_.erase( std::next( rtt_estimators_.begin(), index ) );
+    }
+
+    /**
+     *
+     */
+    reference
+    operator[]
+        ( std::size_t index )
+    { return reference{ ids_[ index ], peers_[ index ] }; }
+
+    /**
+     *
+     */
+    id const&
+    id_at
+        ( std::size_t index )
+        const
+    { return ids_[ index ]; }
+
+    /**
+     *
+     */
+    peer_type const&
+    peer_at
+        ( std::size_t index )
+        const
+    { return peers_[ index ]; }
+
+    /**
+     *
+     */
+    rtt_estimator &
+    rtt_estimator_at
+        ( std::size_t index )
+    { return rtt_estimators_[ index ]; }
+
+    /**
+     *
+     */
+    rtt_estimator const&
+    rtt_estimator_at
+        ( std::size_t index )
+        const
+    { return rtt_estimators_[ index ]; }
+
+    /**
+     *  @brief Remember a peer seen while the k_bucket is full,
+     *         the oldest replacement being dropped once
+     *         max_count replacements are known.
+     */
+    void
+    push_replacement
+        ( id const& peer_id
+        , peer_type const& new_peer
+        , std::size_t max_count )
+    {
+        auto i = find_replacement( peer_id );
+        if ( i != replacements_.end() )
+            replacements_.erase( i );
+        else if ( replacements_.size() == max_count )
+            replacements_.erase( replacements_.begin() );
+
+        replacements_.emplace_back( peer_id, new_peer );
+    }
+
+    /**
+     *
+     */
+    void
+    remove_replacement
+        ( id const& peer_id )
+    {
+        auto i = find_replacement( peer_id );
+        if ( i != replacements_.end() )
+            replacements_.erase( i );
+    }
+
+    /**
+     *  @brief Move the most recently seen replacement
+     *         to the entries.
+     *  @return false if there is no replacement.
+     */
+    bool
+    promote_replacement
+        ( void )
+    {
+        if ( replacements_.empty() )
+            return false;
+
+        auto const& r = replacements_.back();
+        push_back( r.first, r.second );
+        replacements_.pop_back();
+
+        return true;
+    }
+
+    /**
+     *  @brief Move the entries and the replacements
+     *         matching is_moved to the deeper k_bucket.
+     *  @note Entries keep their seniority and their round trip time
+     *        estimates while the pending eviction ping is forgotten.
+     */
+    template< typename Predicate >
+    void
+    split
+        ( k_bucket & deeper
+        , Predicate is_moved )
+    {
+        std::size_t kept = 0;
+        for ( std::size_t i = 0, e = size(); i != e; ++ i )
+        {
+            if ( is_moved( ids_[ i ] ) )
+            {
+                deeper.ids_.push_back( ids_[ i ] );
+                deeper.peers_.push_back( peers_[ i ] );
+                deeper.rtt_estimators_.push_back( rtt_estimators_[ i ] );
+                continue;
+            }
+
+            ids_[ kept ] = ids_[ i ];
+            peers_[ kept ] = peers_[ i ];
+            rtt_estimators_[ kept ] = rtt_estimators_[ i ];
+            ++ kept;
+        }
+
+        ids_.erase( std::next( ids_.begin(), kept ), ids_.end() );
+        peers_.erase( std::next( peers_.begin(), kept ), peers_.end() );
+        rtt_estimators_.erase( std::next( rtt_estimators_.begin(), kept )
+                             , rtt_estimators_.end() );
+
+        auto const moved = [ &is_moved ]( value_type const& r )
+                           { return is_moved( r.first ); };
+        std::copy_if( replacements_.begin(), replacements_.end()
+                    , std::back_inserter( deeper.replacements_ ), moved );
+        replacements_.erase( std::remove_if( replacements_.begin()
+                                           , replacements_.end(), moved )
+                           , replacements_.end() );
+
+        is_pinging_ = false;
+    }
+
+    /**
+     *
+     */
+    clock::time_point const&
+    last_lookup
+        ( void )
+        const
+    { return last_lookup_; }
+
+    /**
+     *
+     */
+    void
+    last_lookup
+        ( clock::time_point const& now )
+    { last_lookup_ = now; }
+
+    /**
+     *  @return true while the oldest entry is pinged.
+     */
+    bool
+    is_pinging
+        ( void )
+        const
+    { return is_pinging_; }
+
+    /**
+     *
+     */
+    void
+    is_pinging
+        ( bool pinging )
+    { is_pinging_ = pinging; }
+
+private:
+    /**
+     *
+     */
+    typename std::vector< value_type >::iterator
+    find_replacement
+        ( id const& peer_id )
+    {
+        return std::find_if( replacements_.begin(), replacements_.end()
+                           , [ &peer_id ]( value_type const& r )
+                             { return r.first == peer_id; } );
+    }
+
+private:
+    ///
+    std::vector< id > ids_;
+    ///
+    std::vector< peer_type > peers_;
+    ///
+    std::vector< rtt_estimator > rtt_estimators_;
+    /// Set while the oldest entry is pinged before its eviction.
+    bool is_pinging_;
+    /// Allocated on overflow only.
+    std::vector< value_type > replacements_;
+    /// Last lookup of an id covered by the k_bucket.
+    clock::time_point last_lookup_;
+};
+
+/**
+ *  Select the peers of the k_buckets [first, last) closest to
+ *  target, up to the end of the output buffer.
+ *  @return The end of the selected peers, sorted from the closest.
+ *  @note The buffer is used as a max-heap while the k_buckets
+ *        ids are scanned, hence only the selected peers are copied.
+ *        Selected entries hold their distance to target
+ *        instead of their id in order to compare them cheaply.
+ */
+template< typename PeerType, typename RandomAccessIterator >
+RandomAccessIterator
+select_closest_peers
+    ( std::vector< k_bucket< PeerType > > const& k_buckets
+    , std::size_t first
+    , std::size_t last
+    , id const& target
+    , RandomAccessIterator output
+    , RandomAccessIterator output_end )
+{
+    using value_type = typename k_bucket< PeerType >::value_type;
+
+    // The buffer is already full of closer peers.
+    if ( output == output_end )
+        return output;
+
+    auto const closer = []( value_type const& a, value_type const& b )
+                        { return a.first < b.first; };
+
+    auto selected_end = output;
+    for ( ; first != last; ++ first )
+    {
+        auto const& bucket = k_buckets[ first ];
+        for ( std::size_t i = 0, e = bucket.size(); i != e; ++ i )
+        {
+            auto const d = distance( bucket.id_at( i ), target );
+
+            if ( selected_end != output_end )
+            {
+                * selected_end = value_type{ d, bucket.peer_at( i ) };
+                std::push_heap( output, ++ selected_end, closer );
+            }
+            // Replace the farthest selected peer.
+            else if ( d < output->first )
+            {
+                std::pop_heap( output, selected_end, closer );
+                * std::prev( selected_end ) = value_type{ d, bucket.peer_at( i ) };
+                std::push_heap( output, selected_end, closer );
+            }
+        }
+    }
+
+    std::sort_heap( output, selected_end, closer );
+
+    return selected_end;
+}
+
+/**
+ *  Find the count peers closest to target.
+ *  @param k_buckets The k_buckets of a routing table, i.e.
+ *         the k_bucket at index i < k_buckets.size() - 1 contains
+ *         the peers sharing exactly i leading bits with our id
+ *         and the last one contains the remaining peers.
+ *  @param target_index The index of the k_bucket covering target.
+ *  @return The end of the peers written into output,
+ *          sorted from the closest.
+ *  @note The peers of the target k_bucket are closer than the
+ *        ones of the deeper k_buckets, which are closer than
+ *        the ones of the shallower k_buckets, each shallower
+ *        k_bucket being farther than the previous one. Hence
+ *        the selection stops once enough groups are visited.
+ *  @note Complexity: O(m log count), m being the visited peer count.
+ */
+template< typename PeerType, typename RandomAccessIterator >
+RandomAccessIterator
+find_closest_peers
+    ( std::vector< k_bucket< PeerType > > const& k_buckets
+    , std::size_t target_index
+    , id const& target
+    , std::size_t count
+    , RandomAccessIterator output )
+{
+    assert( target_index < k_buckets.size() && "unknown k_bucket" );
+
+    auto const output_end = std::next( output, count );
+
+    // The target k_bucket, then the deeper ones.
+    auto selected_end = select_closest_peers( k_buckets
+                                            , target_index, target_index + 1
+                                            , target, output, output_end );
+    selected_end = select_closest_peers( k_buckets
+                                       , target_index + 1, k_buckets.size()
+                                       , target, selected_end, output_end );
+
+    // Then the shallower ones from the closest.
+    for ( auto i = target_index; i != 0 && selected_end != output_end; -- i )
+        selected_end = select_closest_peers( k_buckets, i - 1, i
+                                           , target, selected_end, output_end );
+
+    // Restore the ids from their distance.
+    for ( ; output != selected_end; ++ output )
+        output->first = distance( output->first, target );
+
+    return selected_end;
+}
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
+
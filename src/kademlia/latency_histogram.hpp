@@ -0,0 +1,186 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_LATENCY_HISTOGRAM_HPP
+#define KADEMLIA_LATENCY_HISTOGRAM_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Estimate the percentiles of recent latencies.
+ *
+ *  Latencies are counted in logarithmic buckets,
+ *  each power of 2 microseconds being split into
+ *  SUB_BUCKETS_COUNT buckets, hence a percentile is
+ *  known within 25%. Counts are halved once
+ *  DECAY_THRESHOLD samples have been recorded so
+ *  the oldest samples fade away.
+ */
+class latency_histogram final
+{
+public:
+    ///
+    using duration = std::chrono::steady_clock::duration;
+
+    ///
+    static constexpr std::size_t SUB_BUCKETS_COUNT = 4;
+
+    /// Latencies above 2^26 microseconds (~67s) share the last bucket.
+    static constexpr std::size_t BUCKETS_COUNT = 27 * SUB_BUCKETS_COUNT;
+
+    ///
+    static constexpr std::size_t DECAY_THRESHOLD = 1024;
+
+public:
+    /**
+     *
+     */
+    latency_histogram
+        ( void )
+            : counts_(), samples_count_()
+    { counts_.fill( 0 ); }
+
+    /**
+     *  @return The weight of the recorded samples.
+     */
+    std::size_t
+    size
+        ( void )
+        const
+    { return samples_count_; }
+
+    /**
+     *
+     */
+    void
+    record
+        ( duration const& latency )
+    {
+        auto const us = std::chrono::duration_cast
+                < std::chrono::microseconds >( latency ).count();
+
+        ++ counts_[ to_bucket_index( us > 0 ? std::uint64_t( us ) : 0 ) ];
+
+        if ( ++ samples_count_ < DECAY_THRESHOLD )
+            return;
+
+        samples_count_ = 0;
+        for ( auto & c : counts_ )
+            samples_count_ += ( c /= 2 );
+    }
+
+    /**
+     *  @param p The percentile, in [0, 1].
+     *  @return The upper bound of the latencies below
+     *          the percentile or zero if no sample
+     *          has been recorded.
+     */
+    duration
+    percentile
+        ( double p )
+        const
+    {
+        assert( p >= 0. && p <= 1. && "percentile must be in [0, 1]" );
+
+        if ( samples_count_ == 0 )
+            return duration::zero();
+
+        // Find the bucket holding the sample of rank p * count.
+        auto const rank = std::size_t( p * ( samples_count_ - 1 ) );
+
+        std::size_t i = 0;
+        for ( std::size_t seen = counts_[ 0 ]
+            ; seen <= rank
+            ; seen += counts_[ ++ i ] )
+            ;
+
+        return std::chrono::microseconds( to_bucket_upper_bound( i ) );
+    }
+
+private:
+    /**
+     *
+     */
+    static std::size_t
+    to_bucket_index
+        ( std::uint64_t us )
+    {
+        if ( us < SUB_BUCKETS_COUNT )
+            return std::size_t( us );
+
+        std::size_t msb = 0;
+        for ( auto v = us; v >>= 1; )
+            ++ msb;
+
+        // The 2 bits following the most significant one
+        // select the bucket within the power of 2.
+        auto const sub_bucket = std::size_t( us >> ( msb - 2 ) ) & 3;
+        auto const i = ( msb - 1 ) * SUB_BUCKETS_COUNT + sub_bucket;
+
+        return i < BUCKETS_COUNT ? i : BUCKETS_COUNT - 1;
+    }
+
+    /**
+     *
+     */
+    static std::uint64_t
+    to_bucket_upper_bound
+        ( std::size_t index )
+    {
+        if ( index < SUB_BUCKETS_COUNT )
+            return index + 1;
+
+        auto const msb = index / SUB_BUCKETS_COUNT + 1;
+        auto const sub_bucket = index % SUB_BUCKETS_COUNT;
+
+        return ( SUB_BUCKETS_COUNT + 1 + sub_bucket ) << ( msb - 2 );
+    }
+
+private:
+    ///
+    std::array< std::size_t, BUCKETS_COUNT > counts_;
+    ///
+    std::size_t samples_count_;
+};
+
+constexpr std::size_t latency_histogram::SUB_BUCKETS_COUNT;
+constexpr std::size_t latency_histogram::BUCKETS_COUNT;
+constexpr std::size_t latency_histogram::DECAY_THRESHOLD;
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
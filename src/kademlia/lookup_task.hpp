@@ -30,8 +30,9 @@
 #   pragma once
 #endif
 
+#include <algorithm>
 #include <cassert>
-#include <map>
+#include <cstddef>
 #include <vector>
 
 #include "peer.hpp"
@@ -40,7 +41,16 @@
 namespace kademlia {
 namespace detail {
 
-///
+/**
+ *  @brief Keeps track of the candidates of an iterative lookup.
+ *
+ *  The candidates are kept in a vector sorted by distance
+ *  from the key and truncated to the max_candidates_count
+ *  closest ones, at least closest_count, its storage being
+ *  reserved on construction.
+ *  The lookup has converged once the closest_count closest
+ *  candidates that didn't fail responded.
+ */
 class lookup_task
 {
 public:
@@ -59,7 +69,18 @@ public:
         ( id const& candidate_id );
 
     /**
-     *
+     *  @brief Stop counting a request which has not been answered
+     *         yet as in flight, a late response remains accepted.
+     *  @return true if the candidate request was in flight.
+     */
+    bool
+    flag_candidate_as_slow
+        ( id const& candidate_id );
+
+    /**
+     *  @brief Select the closest not contacted candidates among
+     *         the closest_count ones so that at most max_count
+     *         requests are in flight.
      */
     std::vector< peer >
     select_new_closest_candidates
@@ -88,6 +109,15 @@ public:
         ( void )
         const;
 
+    /**
+     *  @return true if the closest_count closest candidates
+     *          which didn't fail have responded.
+     */
+    bool
+    is_converged
+        ( void )
+        const;
+
     /**
      *
      */
@@ -103,29 +133,42 @@ protected:
     ~lookup_task
         ( void );
 
+    /**
+     *  @brief Keep twice closest_count candidates.
+     */
+    template< typename Iterator >
+    lookup_task
+        ( id const & key
+        , Iterator i, Iterator e
+        , std::size_t closest_count );
+
     /**
      *
      */
     template< typename Iterator >
     lookup_task
         ( id const & key
-        , Iterator i, Iterator e );
+        , Iterator i, Iterator e
+        , std::size_t closest_count
+        , std::size_t max_candidates_count );
 
 private:
     ///
     struct candidate final
     {
+        id distance_;
         peer peer_;
         enum {
             STATE_UNKNOWN,
             STATE_CONTACTED,
+            STATE_SLOW,
             STATE_RESPONDED,
             STATE_TIMEOUTED,
         } state_;
     };
 
     ///
-    using candidates_type = std::map< id, candidate >;
+    using candidates_type = std::vector< candidate >;
 
 private:
     /**
@@ -135,6 +178,13 @@ private:
     add_candidate
         ( peer const& p );
 
+    /**
+     *
+     */
+    void
+    complete_request
+        ( candidate & c );
+
     /**
      *
      */
@@ -142,11 +192,32 @@ private:
     find_candidate
         ( id const& candidate_id );
 
+    /**
+     *
+     */
+    void
+    remove_farthest_candidate
+        ( void );
+
+    /**
+     *
+     */
+    candidates_type::iterator
+    lower_bound
+        ( id const& d );
+
 private:
     ///
     id key_;
+    /// The count of candidates the lookup converges to (k).
+    std::size_t closest_count_;
+    /// The count of candidates kept, the farther ones replace
+    /// the closest ones failing to respond.
+    std::size_t max_candidates_count_;
     ///
     std::size_t in_flight_requests_count_;
+    /// Requests flagged as slow still waiting for a response.
+    std::size_t slow_requests_count_;
     ///
     candidates_type candidates_;
 };
@@ -160,11 +231,32 @@ template< typename Iterator >
 inline
 lookup_task::lookup_task
     ( id const & key
-    , Iterator i, Iterator e )
+    , Iterator i, Iterator e
+    , std::size_t closest_count )
+        : lookup_task( key, i, e, closest_count, 2 * closest_count )
+{ }
+
+template< typename Iterator >
+inline
+lookup_task::lookup_task
+    ( id const & key
+    , Iterator i, Iterator e
+    , std::size_t closest_count
+    , std::size_t max_candidates_count )
         : key_{ key }
+        , closest_count_{ closest_count }
+        , max_candidates_count_{ std::max( max_candidates_count
+                                         , closest_count ) }
         , in_flight_requests_count_{ 0 }
+        , slow_requests_count_{ 0 }
         , candidates_{}
 {
+    assert( closest_count_ > 0 && "closest_count must be > 0" );
+
+    // One more as the farthest candidate is
+    // removed after the insertion of a closer one.
+    candidates_.reserve( max_candidates_count_ + 1 );
+
     for ( ; i != e; ++i )
         add_candidate( peer{ i->first, i->second } );
 }
@@ -177,8 +269,8 @@ lookup_task::flag_candidate_as_valid
     if ( i == candidates_.end() )
         return;
 
-    -- in_flight_requests_count_;
-    i->second.state_ = candidate::STATE_RESPONDED;
+    complete_request( *i );
+    i->state_ = candidate::STATE_RESPONDED;
 }
 
 inline void
@@ -189,8 +281,24 @@ lookup_task::flag_candidate_as_invalid
     if ( i == candidates_.end() )
         return;
 
+    complete_request( *i );
+    i->state_ = candidate::STATE_TIMEOUTED;
+}
+
+inline bool
+lookup_task::flag_candidate_as_slow
+    ( id const& candidate_id )
+{
+    auto i = find_candidate( candidate_id );
+    if ( i == candidates_.end()
+       || i->state_ != candidate::STATE_CONTACTED )
+        return false;
+
     -- in_flight_requests_count_;
-    i->second.state_ = candidate::STATE_TIMEOUTED;
+    ++ slow_requests_count_;
+    i->state_ = candidate::STATE_SLOW;
+
+    return true;
 }
 
 inline std::vector< peer >
@@ -199,17 +307,23 @@ lookup_task::select_new_closest_candidates
 {
     std::vector< peer > candidates;
 
-    // Iterate over all candidates until we picked
-    // candidates_max_count not-contacted candidates.
+    // Iterate over the closest candidates which didn't fail
+    // until we picked candidates_max_count not-contacted candidates.
+    std::size_t closest_count = 0;
     for ( auto i = candidates_.begin(), e = candidates_.end()
         ; i != e && in_flight_requests_count_ < max_count
+                 && closest_count != closest_count_
         ; ++ i )
     {
-        if ( i->second.state_ == candidate::STATE_UNKNOWN )
+        if ( i->state_ == candidate::STATE_TIMEOUTED )
+            continue;
+
+        ++ closest_count;
+        if ( i->state_ == candidate::STATE_UNKNOWN )
         {
-            i->second.state_ = candidate::STATE_CONTACTED;
+            i->state_ = candidate::STATE_CONTACTED;
             ++ in_flight_requests_count_;
-            candidates.push_back( i->second.peer_ );
+            candidates.push_back( i->peer_ );
         }
     }
 
@@ -228,8 +342,8 @@ lookup_task::select_closest_valid_candidates
         ; i != e && candidates.size() < max_count
         ; ++ i )
     {
-        if ( i->second.state_ == candidate::STATE_RESPONDED )
-            candidates.push_back( i->second.peer_ );
+        if ( i->state_ == candidate::STATE_RESPONDED )
+            candidates.push_back( i->peer_ );
     }
 
     return candidates;
@@ -248,7 +362,33 @@ inline bool
 lookup_task::have_all_requests_completed
     ( void )
     const
-{ return in_flight_requests_count_ == 0; }
+{ return in_flight_requests_count_ == 0 && slow_requests_count_ == 0; }
+
+inline bool
+lookup_task::is_converged
+    ( void )
+    const
+{
+    std::size_t responded_count = 0;
+    for ( auto i = candidates_.begin(), e = candidates_.end()
+        ; i != e && responded_count != closest_count_
+        ; ++ i )
+    {
+        switch ( i->state_ )
+        {
+            case candidate::STATE_RESPONDED:
+                ++ responded_count;
+                break;
+            case candidate::STATE_TIMEOUTED:
+                break;
+            default:
+                // A closer candidate may still provide closer peers.
+                return false;
+        }
+    }
+
+    return true;
+}
 
 inline id const&
 lookup_task::get_key
@@ -260,12 +400,35 @@ inline void
 lookup_task::add_candidate
     ( peer const& p )
 {
+    auto const d = distance( p.id_, key_ );
+    auto const i = lower_bound( d );
+
+    // Skip already known candidates and candidates
+    // farther than the max_candidates_count closest.
+    if ( i != candidates_.end() && i->distance_ == d )
+        return;
+
+    if ( i == candidates_.end()
+       && candidates_.size() == max_candidates_count_ )
+        return;
+
     LOG_DEBUG( lookup_task, this )
             << "adding '" << p << "'." << std::endl;
 
-    auto const d = distance( p.id_, key_ );
-    candidate const c{ p, candidate::STATE_UNKNOWN };
-    candidates_.emplace( d, c );
+    candidates_.insert( i, candidate{ d, p, candidate::STATE_UNKNOWN } );
+
+    if ( candidates_.size() > max_candidates_count_ )
+        remove_farthest_candidate();
+}
+
+inline void
+lookup_task::complete_request
+    ( candidate & c )
+{
+    if ( c.state_ == candidate::STATE_SLOW )
+        -- slow_requests_count_;
+    else
+        -- in_flight_requests_count_;
 }
 
 inline lookup_task::candidates_type::iterator
@@ -273,7 +436,38 @@ lookup_task::find_candidate
     ( id const& candidate_id )
 {
     auto const d = distance( candidate_id, key_ );
-    return candidates_.find( d );
+    auto const i = lower_bound( d );
+
+    if ( i == candidates_.end() || i->distance_ != d )
+        return candidates_.end();
+
+    return i;
+}
+
+inline void
+lookup_task::remove_farthest_candidate
+    ( void )
+{
+    auto & c = candidates_.back();
+
+    // Its request is forgotten, a late response
+    // won't be able to flag it anymore.
+    if ( c.state_ == candidate::STATE_CONTACTED
+       || c.state_ == candidate::STATE_SLOW )
+        complete_request( c );
+
+    candidates_.pop_back();
+}
+
+inline lookup_task::candidates_type::iterator
+lookup_task::lower_bound
+    ( id const& d )
+{
+    auto const closer = []( candidate const& c, id const& other )
+    { return c.distance_ < other; };
+
+    return std::lower_bound( candidates_.begin(), candidates_.end()
+                           , d, closer );
 }
 
 } // namespace detail
@@ -75,7 +75,7 @@ deserialize_integer
 
 inline void
 serialize
-    ( std::vector< std::uint8_t > data
+    ( std::vector< std::uint8_t > const& data
     , buffer & b )
 {
     serialize_integer( data.size(), b );
@@ -106,6 +106,31 @@ deserialize
     return std::error_code{};
 }
 
+/**
+ *
+ */
+inline std::error_code
+deserialize
+    ( shared_buffer const& message
+    , buffer::const_iterator & i
+    , buffer::const_iterator e
+    , buffer_view & data )
+{
+    std::size_t size;
+    auto failure = deserialize_integer( i, e, size );
+    if ( failure )
+        return failure;
+
+    if ( std::size_t( std::distance( i, e ) ) < size )
+        return make_error_code( CORRUPTED_BODY );
+
+    e = std::next( i, size );
+    data = buffer_view{ message, i, e };
+    i = e;
+
+    return std::error_code{};
+}
+
 inline void
 serialize
     ( id const& i
@@ -132,6 +157,31 @@ deserialize
     return std::error_code{};
 }
 
+inline void
+serialize
+    ( std::chrono::milliseconds const& duration
+    , buffer & b )
+{ serialize_integer( std::uint64_t( duration.count() ), b ); }
+
+/**
+ *
+ */
+inline std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , std::chrono::milliseconds & duration )
+{
+    std::uint64_t count;
+    auto failure = deserialize_integer( i, e, count );
+    if ( failure )
+        return failure;
+
+    duration = std::chrono::milliseconds( count );
+
+    return std::error_code{};
+}
+
 /**
  *
  */
@@ -429,6 +479,27 @@ serialize
     serialize( body.data_key_hash_, b );
 
     serialize( body.data_value_, b );
+
+    // Trailing, hence ignored by peers predating it.
+    serialize( body.data_lifetime_, b );
+}
+
+/**
+ *  @brief Deserialize the optional lifetime ending a STORE request.
+ */
+inline std::error_code
+deserialize_data_lifetime
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , std::chrono::milliseconds & lifetime )
+{
+    if ( i == e )
+    {
+        lifetime = std::chrono::milliseconds::max();
+        return std::error_code{};
+    }
+
+    return deserialize( i, e, lifetime );
 }
 
 std::error_code
@@ -441,7 +512,29 @@ deserialize
     if ( failure )
         return failure;
 
-    return deserialize( i, e, body.data_value_ );
+    failure = deserialize( i, e, body.data_value_ );
+    if ( failure )
+        return failure;
+
+    return deserialize_data_lifetime( i, e, body.data_lifetime_ );
+}
+
+std::error_code
+deserialize
+    ( shared_buffer const& message
+    , buffer::const_iterator & i
+    , buffer::const_iterator e
+    , store_value_request_view & body )
+{
+    auto failure = deserialize( i, e, body.data_key_hash_ );
+    if ( failure )
+        return failure;
+
+    failure = deserialize( message, i, e, body.data_value_ );
+    if ( failure )
+        return failure;
+
+    return deserialize_data_lifetime( i, e, body.data_lifetime_ );
 }
 
 } // namespace detail
@@ -31,6 +31,7 @@
 #endif
 
 #include <iosfwd>
+#include <chrono>
 #include <cstdint>
 #include <algorithm>
 #include <system_error>
@@ -41,6 +42,7 @@
 #include "peer.hpp"
 #include "id.hpp"
 #include "buffer.hpp"
+#include "buffer_pool.hpp"
 
 namespace kademlia {
 namespace detail {
@@ -263,6 +265,9 @@ struct store_value_request_body final
     id data_key_hash_;
     ///
     std::vector< std::uint8_t > data_value_;
+    /// Time left before the value expires, max() if the
+    /// request comes from a peer which doesn't provide it.
+    std::chrono::milliseconds data_lifetime_;
 };
 
 /**
@@ -290,6 +295,31 @@ deserialize
     , buffer::const_iterator e
     , store_value_request_body & body );
 
+/**
+ *  @brief Store value request whose value refers to
+ *         the buffer the request has been received in.
+ */
+struct store_value_request_view final
+{
+    ///
+    id data_key_hash_;
+    ///
+    buffer_view data_value_;
+    /// Time left before the value expires, max() if the
+    /// request comes from a peer which doesn't provide it.
+    std::chrono::milliseconds data_lifetime_;
+};
+
+/**
+ *  @pre [i, e) belongs to the buffer owned by message.
+ */
+std::error_code
+deserialize
+    ( shared_buffer const& message
+    , buffer::const_iterator & i
+    , buffer::const_iterator e
+    , store_value_request_view & body );
+
 } // namespace detail
 } // namespace kademlia
 
@@ -31,8 +31,11 @@ namespace detail {
 message_serializer::message_serializer
     ( id const& my_id )
     : my_id_( my_id )
+    , buffers_( buffer_pool::create( 0 ) )
 { }
 
+constexpr std::size_t message_serializer::INITIAL_BUFFER_CAPACITY;
+
 header
 message_serializer::generate_header
     ( header::type const& type
@@ -45,15 +48,26 @@ message_serializer::generate_header
             , token };
 }
 
-buffer
+shared_buffer
 message_serializer::serialize
     ( header::type const& type
     , id const& token )
 {
     auto const header = generate_header( type, token );
 
-    buffer b;
-    detail::serialize( header, b );
+    auto b = acquire_buffer();
+    detail::serialize( header, *b );
+
+    return b;
+}
+
+shared_buffer
+message_serializer::acquire_buffer
+    ( void )
+{
+    // Buffers are acquired empty, messages are appended.
+    auto b = buffers_->acquire();
+    b->reserve( INITIAL_BUFFER_CAPACITY );
 
     return b;
 }
@@ -32,6 +32,7 @@
 
 #include <memory>
 
+#include "buffer_pool.hpp"
 #include "message.hpp"
 
 namespace kademlia {
@@ -42,6 +43,10 @@ namespace detail {
  */
 class message_serializer
 {
+public:
+    /// Most messages fit in a buffer of this capacity.
+    static constexpr std::size_t INITIAL_BUFFER_CAPACITY = 1024;
+
 public:
     /**
      *
@@ -50,18 +55,22 @@ public:
         ( id const& my_id );
 
     /**
+     *  @brief Serialize the message into a pooled buffer.
      *
+     *  The buffer returns to the pool once released,
+     *  i.e. when the message has been sent.
+     *  @note This method can be called concurrently.
      */
     template< typename Message >
-    buffer
+    shared_buffer
     serialize
         ( Message const& message
         , id const& token );
 
     /**
-     *
+     *  @copydoc serialize
      */
-    buffer
+    shared_buffer
     serialize
         ( header::type const& type
         , id const& token );
@@ -75,13 +84,22 @@ private:
         ( header::type const& type
         , id const& token );
 
+    /**
+     *
+     */
+    shared_buffer
+    acquire_buffer
+        ( void );
+
 private:
     ///
     id const& my_id_;
+    ///
+    std::shared_ptr< buffer_pool > buffers_;
 };
 
 template< typename Message >
-buffer
+shared_buffer
 message_serializer::serialize
     ( Message const& message
     , id const& token )
@@ -89,9 +107,9 @@ message_serializer::serialize
     auto const type = message_traits< Message >::TYPE_ID;
     auto const header = generate_header( type, token );
 
-    buffer b;
-    detail::serialize( header, b );
-    detail::serialize( message, b );
+    auto b = acquire_buffer();
+    detail::serialize( header, *b );
+    detail::serialize( message, *b );
 
     return b;
 }
@@ -39,12 +39,30 @@
 #include <kademlia/error.hpp>
 
 #include "buffer.hpp"
+#include "buffer_pool.hpp"
 #include "ip_endpoint.hpp"
 #include "boost_to_std_error.hpp"
 
 namespace kademlia {
 namespace detail {
 
+/**
+ *  Count of receptions an underlying socket can complete
+ *  at once, i.e. its BATCH_SIZE if it reads by batches.
+ */
+template< typename UnderlyingSocketType, typename = void >
+struct underlying_receptions_count final
+{ static constexpr std::size_t value = 1; };
+
+/**
+ *
+ */
+template< typename UnderlyingSocketType >
+struct underlying_receptions_count
+        < UnderlyingSocketType
+        , decltype( void( UnderlyingSocketType::BATCH_SIZE ) ) > final
+{ static constexpr std::size_t value = UnderlyingSocketType::BATCH_SIZE; };
+
 /**
  *
  */
@@ -55,6 +73,11 @@ public:
     /// Consider we won't receive IPv6 jumbo datagram.
     static constexpr std::size_t INPUT_BUFFER_SIZE = UINT16_MAX;
 
+    /// Count of concurrent receptions worth arming, each
+    /// of them being identified by its reception index.
+    static constexpr std::size_t RECEPTIONS_COUNT
+            = underlying_receptions_count< UnderlyingSocketType >::value;
+
     ///
     using endpoint_type = ip_endpoint;
 
@@ -121,7 +144,18 @@ public:
     template<typename ReceiveCallback>
     void
     async_receive
-        ( ReceiveCallback const& callback );
+        ( ReceiveCallback const& callback )
+    { async_receive( 0, callback ); }
+
+    /**
+     *  @pre No other reception with the same
+     *       reception_index < RECEPTIONS_COUNT is pending.
+     */
+    template<typename ReceiveCallback>
+    void
+    async_receive
+        ( std::size_t reception_index
+        , ReceiveCallback const& callback );
 
     /**
      *
@@ -129,7 +163,7 @@ public:
     template<typename SendCallback>
     void
     async_send
-        ( buffer const& message
+        ( shared_buffer const& message
         , endpoint_type const& to
         , SendCallback const& callback );
 
@@ -180,9 +214,9 @@ private:
 
 private:
     ///
-    buffer reception_buffer_;
-    ///
-    underlying_endpoint_type current_message_sender_;
+    std::shared_ptr< buffer_pool > reception_buffers_;
+    /// The sender of each pending reception.
+    std::vector< underlying_endpoint_type > message_senders_;
     ///
     underlying_socket_type socket_;
 };
@@ -228,8 +262,8 @@ inline
 message_socket< UnderlyingSocketType >::message_socket
     ( boost::asio::io_service & io_service
     , endpoint_type const& e )
-    : reception_buffer_( INPUT_BUFFER_SIZE )
-    , current_message_sender_()
+    : reception_buffers_( buffer_pool::create( INPUT_BUFFER_SIZE ) )
+    , message_senders_( RECEPTIONS_COUNT )
     , socket_( create_underlying_socket( io_service, e ) )
 { }
 
@@ -246,9 +280,18 @@ template< typename UnderlyingSocketType >
 template< typename ReceiveCallback >
 inline void
 message_socket< UnderlyingSocketType >::async_receive
-    ( ReceiveCallback const& callback )
+    ( std::size_t reception_index
+    , ReceiveCallback const& callback )
 {
-    auto on_completion = [ this, callback ]
+    assert( reception_index < RECEPTIONS_COUNT && "unknown reception" );
+
+    // Each message is received into its own buffer, hence the
+    // callback can keep it alive while the next one is received.
+    auto reception_buffer = reception_buffers_->acquire();
+    auto & message_sender = message_senders_[ reception_index ];
+
+    auto on_completion = [ this, reception_index, callback
+                         , reception_buffer, &message_sender ]
         ( boost::system::error_code const& failure
         , std::size_t bytes_received )
     {
@@ -259,21 +302,22 @@ message_socket< UnderlyingSocketType >::async_receive
         // https://msdn.microsoft.com/en-us/library/ms740120.aspx
         // Ignore it and schedule another read.
         if ( failure == boost::system::errc::connection_reset )
-            return async_receive( callback );
+            return async_receive( reception_index, callback );
 #endif
-        auto i = reception_buffer_.begin(), e = i;
+        buffer::const_iterator i = reception_buffer->begin(), e = i;
 
         if ( ! failure )
             std::advance( e, bytes_received );
 
         callback( boost_to_std_error( failure )
-                , convert_endpoint( current_message_sender_ )
+                , convert_endpoint( message_sender )
+                , reception_buffer
                 , i, e );
     };
 
-    assert( reception_buffer_.size() == INPUT_BUFFER_SIZE );
-    socket_.async_receive_from( boost::asio::buffer( reception_buffer_ )
-                              , current_message_sender_
+    assert( reception_buffer->size() == INPUT_BUFFER_SIZE );
+    socket_.async_receive_from( boost::asio::buffer( *reception_buffer )
+                              , message_sender
                               , std::move( on_completion ) );
 }
 
@@ -281,23 +325,22 @@ template< typename UnderlyingSocketType >
 template< typename SendCallback >
 inline void
 message_socket< UnderlyingSocketType >::async_send
-    ( buffer const& message
+    ( shared_buffer const& message
     , endpoint_type const& to
     , SendCallback const& callback )
 {
-    if ( message.size() > INPUT_BUFFER_SIZE )
+    if ( message->size() > INPUT_BUFFER_SIZE )
         callback( make_error_code( std::errc::value_too_large ) );
     else {
-        // Copy the buffer as it has to live past the end of this call.
-        auto message_copy = std::make_shared< buffer >( message );
-        auto on_completion = [ this, callback, message_copy ]
+        // Keep the buffer alive until the message has been sent.
+        auto on_completion = [ callback, message ]
             ( boost::system::error_code const& failure
             , std::size_t /* bytes_sent */ )
         {
             callback( boost_to_std_error( failure ) );
         };
 
-        socket_.async_send_to( boost::asio::buffer( *message_copy )
+        socket_.async_send_to( boost::asio::buffer( *message )
                              , convert_endpoint( to )
                              , std::move( on_completion ) );
     }
@@ -31,11 +31,13 @@
 #endif
 
 #include <functional>
+#include <mutex>
 #include <boost/asio/io_service.hpp>
 
 #include "log.hpp"
 #include "ip_endpoint.hpp"
 #include "message_socket.hpp"
+#include "buffer_pool.hpp"
 #include "buffer.hpp"
 
 namespace kademlia {
@@ -60,6 +62,7 @@ public:
     ///
     using on_message_received_type = std::function<
         void ( endpoint_type const&
+             , shared_buffer const&
              , buffer::const_iterator
              , buffer::const_iterator ) >;
 public:
@@ -75,6 +78,7 @@ public:
             , socket_ipv4_( std::move( socket_ipv4 ) )
             , socket_ipv6_( std::move( socket_ipv6 ) )
             , on_message_received_( on_message_received )
+            , sockets_mutex_()
     {
         start_message_reception();
         LOG_DEBUG( network, this ) << "created at '"
@@ -100,13 +104,16 @@ public:
     /**
      *
      */
-    template< typename Message, typename OnMessageSent >
+    template< typename OnMessageSent >
     void
     send
-        ( Message const& message
+        ( shared_buffer const& message
         , endpoint_type const& e
         , OnMessageSent const& on_message_sent )
-    { get_socket_for( e ).async_send( message, e, on_message_sent ); }
+    {
+        std::lock_guard< std::recursive_mutex > lock{ sockets_mutex_ };
+        get_socket_for( e ).async_send( message, e, on_message_sent );
+    }
 
     /**
      *
@@ -119,14 +126,20 @@ public:
 
 private:
     /**
-     *
+     *  Arm as many receptions as the sockets complete at once,
+     *  hence a batch of messages is dispatched by a single handler.
      */
     void
     start_message_reception
         ( void )
     {
-        schedule_receive_on_socket( socket_ipv4_ );
-        schedule_receive_on_socket( socket_ipv6_ );
+        for ( std::size_t i = 0
+            ; i != message_socket_type::RECEPTIONS_COUNT
+            ; ++ i )
+        {
+            schedule_receive_on_socket( socket_ipv4_, i );
+            schedule_receive_on_socket( socket_ipv6_, i );
+        }
     }
 
     /**
@@ -134,11 +147,13 @@ private:
      */
     void
     schedule_receive_on_socket
-        ( message_socket_type & current_subnet )
+        ( message_socket_type & current_subnet
+        , std::size_t reception_index )
     {
-        auto on_new_message = [ this, &current_subnet ]
+        auto on_new_message = [ this, &current_subnet, reception_index ]
             ( std::error_code const& failure
             , endpoint_type const& sender
+            , shared_buffer const& message
             , buffer::const_iterator i
             , buffer::const_iterator e )
         {
@@ -146,11 +161,16 @@ private:
             if ( failure )
                 throw std::system_error{ failure };
 
-            on_message_received_( sender, i, e );
-            schedule_receive_on_socket( current_subnet );
+            // The message owns its buffer, hence the next one can be
+            // received, possibly by another thread, while this one
+            // is handled.
+            schedule_receive_on_socket( current_subnet, reception_index );
+
+            on_message_received_( sender, message, i, e );
         };
 
-        current_subnet.async_receive( on_new_message );
+        std::lock_guard< std::recursive_mutex > lock{ sockets_mutex_ };
+        current_subnet.async_receive( reception_index, on_new_message );
     }
 
     /**
@@ -175,6 +195,8 @@ private:
     message_socket_type socket_ipv6_;
     ///
     on_message_received_type on_message_received_;
+    /// Sockets are shared among the threads running the io_service.
+    std::recursive_mutex sockets_mutex_;
 };
 
 } // namespace detail
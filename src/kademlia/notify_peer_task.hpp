@@ -32,6 +32,9 @@
 
 #include <memory>
 #include <system_error>
+#include <utility>
+
+#include <kademlia/session_configuration.hpp>
 
 #include "lookup_task.hpp"
 #include "message.hpp"
@@ -63,11 +66,13 @@ public:
         ( detail::id const & key
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , OnFinishType on_finish )
+        , OnFinishType on_finish
+        , session_configuration const& configuration )
     {
         std::shared_ptr< notify_peer_task > c;
         c.reset( new notify_peer_task( key, tracker
-                                     , routing_table, on_finish ) );
+                                     , routing_table, on_finish
+                                     , configuration ) );
 
         try_to_notify_neighbors( c );
     }
@@ -81,12 +86,17 @@ private:
         ( detail::id const & key
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , OnFinishType on_finish )
+        , OnFinishType on_finish
+        , session_configuration const& configuration )
             : lookup_task( key
                          , routing_table.find( key )
-                         , routing_table.end() )
+                         , routing_table.end()
+                         , configuration.bucket_size()
+                         , configuration.lookup_candidates_count() )
             , tracker_( tracker )
+            , configuration_( configuration )
             , on_finish_( on_finish )
+            , is_finished_()
     {
         LOG_DEBUG( notify_peer_task, this )
                 << "create notify peer task for '"
@@ -100,6 +110,10 @@ private:
     try_to_notify_neighbors
         ( std::shared_ptr< notify_peer_task > task )
     {
+        // Late responses are ignored once the neighbors are notified.
+        if ( task->is_finished_ )
+            return;
+
         LOG_DEBUG( notify_peer_task, task.get() )
                 << "sending find peer to notify '"
                 << task->get_key() << "' owner bucket." << std::endl;
@@ -107,7 +121,7 @@ private:
         find_peer_request_body const request{ task->get_key() };
 
         auto const closest_peers = task->select_new_closest_candidates
-                ( CONCURRENT_FIND_PEER_REQUESTS_COUNT );
+                ( task->configuration_.concurrent_requests_count() );
 
         for ( auto const& c : closest_peers )
             send_notify_peer_request( request, c, task );
@@ -145,10 +159,10 @@ private:
         };
 
         task->tracker_.send_request( request
-                                   , current_peer.endpoint_
-                                   , PEER_LOOKUP_TIMEOUT
-                                   , on_message_received
-                                   , on_error );
+                                   , current_peer
+                                   , task->configuration_.peer_lookup_timeout()
+                                   , std::move( on_message_received )
+                                   , std::move( on_error ) );
     }
 
     /**
@@ -158,8 +172,11 @@ private:
     check_for_completion
         ( void )
     {
-        if (have_all_requests_completed())
-            on_finish_();
+        if ( is_finished_ || ! is_converged() )
+            return;
+
+        is_finished_ = true;
+        on_finish_();
     }
 
     /**
@@ -197,7 +214,11 @@ private:
     ///
     tracker_type & tracker_;
     ///
+    session_configuration const configuration_;
+    ///
     OnFinishType on_finish_;
+    ///
+    bool is_finished_;
 };
 
 /**
@@ -211,12 +232,14 @@ start_notify_peer_task
     ( id const& key
     , TrackerType & tracker
     , RoutingTableType & routing_table
-    , OnFinishType on_finish )
+    , OnFinishType on_finish
+    , session_configuration const& configuration = session_configuration{} )
 {
     using task = notify_peer_task< TrackerType, OnFinishType >;
 
     task::start( key, tracker, routing_table
-               , std::forward< OnFinishType >( on_finish ) );
+               , std::forward< OnFinishType >( on_finish )
+               , configuration );
 }
 
 } // namespace detail
@@ -26,44 +26,204 @@
 #include "response_callbacks.hpp"
 
 #include <cassert>
+#include <cstring>
+#include <utility>
 
 #include <kademlia/error.hpp>
 
 namespace kademlia {
 namespace detail {
 
+namespace {
+
+/// Power of 2.
+constexpr std::size_t INITIAL_SLOTS_COUNT = 16;
+
+} // anonymous namespace
+
+response_callbacks::response_callbacks
+    ( void )
+    : slots_()
+    , size_{ 0 }
+{ }
+
 void
 response_callbacks::push_callback
     ( id const& message_id
-    , callback const& on_message_received )
+    , callback on_message_received
+    , error_callback on_error
+    , timer::handle const& timeout )
 {
-    auto i = callbacks_.emplace( message_id, on_message_received );
-    (void)i;
-    assert( i.second && "an id can't be registered twice" );
+    assert( find( message_id ) == slots_.size()
+          && "an id can't be registered twice" );
+
+    // Keep the load factor under 1/2.
+    if ( ( size_ + 1 ) * 2 > slots_.size() )
+        grow();
+
+    auto const h = hash( message_id );
+    auto const mask = slots_.size() - 1;
+
+    auto index = h & mask;
+    while ( slots_[ index ].used_ )
+        index = ( index + 1 ) & mask;
+
+    auto & s = slots_[ index ];
+    s.used_ = true;
+    s.hash_ = h;
+    s.message_id_ = message_id;
+    s.on_message_received_ = std::move( on_message_received );
+    s.on_error_ = std::move( on_error );
+    s.timeout_ = timeout;
+
+    ++ size_;
 }
 
 bool
 response_callbacks::remove_callback
-    ( id const& message_id )
-{ return callbacks_.erase( message_id ) > 0; }
+    ( id const& message_id
+    , timer::handle * timeout )
+{
+    auto const index = find( message_id );
+    if ( index == slots_.size() )
+        return false;
+
+    if ( timeout )
+        *timeout = slots_[ index ].timeout_;
+
+    erase( index );
+
+    return true;
+}
+
+bool
+response_callbacks::report_failure
+    ( id const& message_id
+    , std::error_code const& failure
+    , timer::handle * timeout )
+{
+    auto const index = find( message_id );
+    if ( index == slots_.size() )
+        return false;
+
+    if ( timeout )
+        *timeout = slots_[ index ].timeout_;
+
+    // The callback may push new callbacks hence
+    // it's removed from the table before being called.
+    auto on_error = std::move( slots_[ index ].on_error_ );
+    erase( index );
+
+    if ( on_error )
+        on_error( failure );
+
+    return true;
+}
 
 std::error_code
 response_callbacks::dispatch_response
     ( endpoint_type const& sender
     , header const& h
     , buffer::const_iterator i
-    , buffer::const_iterator e )
+    , buffer::const_iterator e
+    , timer::handle * timeout )
 {
-    auto callback = callbacks_.find( h.random_token_ );
-    if ( callback == callbacks_.end() )
+    auto const index = find( h.random_token_ );
+    if ( index == slots_.size() )
         return make_error_code( UNASSOCIATED_MESSAGE_ID );
 
-    callback->second( sender, h, i, e );
-    callbacks_.erase( callback );
+    if ( timeout )
+        *timeout = slots_[ index ].timeout_;
+
+    // The callback may push new callbacks hence
+    // it's removed from the table before being called.
+    auto on_message_received = std::move( slots_[ index ].on_message_received_ );
+    erase( index );
+
+    on_message_received( sender, h, i, e );
 
     return std::error_code{};
 }
 
+std::uint64_t
+response_callbacks::hash
+    ( id const& message_id )
+{
+    std::uint64_t h;
+    std::memcpy( &h, message_id.begin(), sizeof( h ) );
+    return h;
+}
+
+std::size_t
+response_callbacks::find
+    ( id const& message_id )
+    const
+{
+    if ( slots_.empty() )
+        return slots_.size();
+
+    auto const h = hash( message_id );
+    auto const mask = slots_.size() - 1;
+
+    for ( auto index = h & mask; slots_[ index ].used_; index = ( index + 1 ) & mask )
+    {
+        auto const& s = slots_[ index ];
+        if ( s.hash_ == h && s.message_id_ == message_id )
+            return index;
+    }
+
+    return slots_.size();
+}
+
+void
+response_callbacks::erase
+    ( std::size_t index )
+{
+    auto const mask = slots_.size() - 1;
+
+    // Move back the slots which would be unreachable
+    // once slot index is free (no tombstone).
+    for ( auto next = ( index + 1 ) & mask
+        ; slots_[ next ].used_
+        ; next = ( next + 1 ) & mask )
+    {
+        auto const ideal = slots_[ next ].hash_ & mask;
+        if ( ( ( next - ideal ) & mask ) >= ( ( next - index ) & mask ) )
+        {
+            slots_[ index ] = std::move( slots_[ next ] );
+            index = next;
+        }
+    }
+
+    auto & s = slots_[ index ];
+    s.used_ = false;
+    s.on_message_received_ = nullptr;
+    s.on_error_ = nullptr;
+
+    -- size_;
+}
+
+void
+response_callbacks::grow
+    ( void )
+{
+    slots previous_slots( slots_.empty() ? INITIAL_SLOTS_COUNT
+                                         : slots_.size() * 2 );
+    previous_slots.swap( slots_ );
+
+    auto const mask = slots_.size() - 1;
+    for ( auto & s : previous_slots )
+    {
+        if ( ! s.used_ )
+            continue;
+
+        auto index = s.hash_ & mask;
+        while ( slots_[ index ].used_ )
+            index = ( index + 1 ) & mask;
+
+        slots_[ index ] = std::move( s );
+    }
+}
+
 } // namespace detail
 } // namespace kademlia
-
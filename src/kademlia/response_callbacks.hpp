@@ -30,17 +30,26 @@
 #   pragma once
 #endif
 
-#include <map>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include "id.hpp"
+#include "inplace_function.hpp"
 #include "ip_endpoint.hpp"
 #include "message.hpp"
+#include "timer.hpp"
 
 namespace kademlia {
 namespace detail {
 
-///
+/**
+ *  @brief Associate the random token of requests
+ *         with the callback handling their response.
+ *
+ *  Tokens are uniformly random, hence their first bytes are used
+ *  as hash of an open addressing table (linear probing).
+ */
 class response_callbacks final
 {
 public:
@@ -48,45 +57,134 @@ public:
     using endpoint_type = ip_endpoint;
 
     ///
-    using callback = std::function< void
+    using callback = inplace_function< void
             ( endpoint_type const& sender
             , header const& h
             , buffer::const_iterator i
             , buffer::const_iterator e ) >;
 
+    ///
+    using error_callback = inplace_function< void
+            ( std::error_code const& failure ) >;
+
 public:
     /**
      *
      */
+    response_callbacks
+        ( void );
+
+    /**
+     *  @param on_error Called if the response is never received.
+     *  @param timeout The timeout to cancel once the callback is removed.
+     */
     void
     push_callback
         ( id const& message_id
-        , callback const& on_message_received );
+        , callback on_message_received
+        , error_callback on_error = nullptr
+        , timer::handle const& timeout = timer::handle{} );
 
     /**
-     *
+     *  @param timeout If not null, receives the timeout
+     *         associated with the removed callback.
      */
     bool
     remove_callback
-        ( id const& message_id );
+        ( id const& message_id
+        , timer::handle * timeout = nullptr );
 
     /**
-     *
+     *  @brief Remove the callback associated with message_id
+     *         and report failure through its error callback.
+     *  @param timeout If not null, receives the timeout
+     *         associated with the removed callback.
+     *  @return true if a callback was associated with message_id.
+     */
+    bool
+    report_failure
+        ( id const& message_id
+        , std::error_code const& failure
+        , timer::handle * timeout = nullptr );
+
+    /**
+     *  @param timeout If not null, receives the timeout
+     *         associated with the dispatched callback.
      */
     std::error_code
     dispatch_response
         ( endpoint_type const& sender
         , header const& h
         , buffer::const_iterator i
-        , buffer::const_iterator e );
+        , buffer::const_iterator e
+        , timer::handle * timeout = nullptr );
+
+    /**
+     *
+     */
+    std::size_t
+    size
+        ( void )
+        const
+    { return size_; }
 
 private:
     ///
-    using callbacks = std::map< id, callback >;
+    struct slot final
+    {
+        ///
+        bool used_;
+        ///
+        std::uint64_t hash_;
+        ///
+        id message_id_;
+        ///
+        callback on_message_received_;
+        ///
+        error_callback on_error_;
+        ///
+        timer::handle timeout_;
+    };
+
+    ///
+    using slots = std::vector< slot >;
+
+private:
+    /**
+     *
+     */
+    static std::uint64_t
+    hash
+        ( id const& message_id );
+
+    /**
+     *  @return The index of message_id slot or the slots count.
+     */
+    std::size_t
+    find
+        ( id const& message_id )
+        const;
+
+    /**
+     *  @brief Free the slot and move back the following
+     *         slots of its probe sequence.
+     */
+    void
+    erase
+        ( std::size_t index );
+
+    /**
+     *
+     */
+    void
+    grow
+        ( void );
 
 private:
+    /// The count is a power of 2.
+    slots slots_;
     ///
-    callbacks callbacks_;
+    std::size_t size_;
 };
 
 } // namespace detail
@@ -26,6 +26,8 @@
 #ifndef KADEMLIA_RESPONSE_ROUTER_HPP
 #define KADEMLIA_RESPONSE_ROUTER_HPP
 
+#include <utility>
+
 #include <kademlia/error.hpp>
 #include "ip_endpoint.hpp"
 #include "response_callbacks.hpp"
@@ -59,6 +61,17 @@ public:
             , timer_( io_service )
     { }
 
+    /**
+     *  @brief Create a router whose timeouts are reported
+     *         through the provided strand.
+     */
+    explicit
+    response_router
+        ( boost::asio::io_service::strand const& strand )
+            : response_callbacks_()
+            , timer_( strand )
+    { }
+
     /**
      *
      */
@@ -85,44 +98,101 @@ public:
         , buffer::const_iterator e )
     {
         // Try to forward the message to its associated callback.
+        timer::handle timeout;
         auto failure = response_callbacks_.dispatch_response( sender
-                                                            , h, i, e );
+                                                            , h, i, e
+                                                            , &timeout );
         if ( failure == UNASSOCIATED_MESSAGE_ID )
             // Unknown request or unassociated responses
             // are discarded.
             LOG_DEBUG( response_router, this ) << "dropping unknown response."
                     << std::endl;
+        else
+            // The response has been received in time,
+            // hence the timeout is useless.
+            timer_.cancel( timeout );
     }
 
     /**
-     *
+     *  @brief Call on_response_received once the response_id
+     *         response is received or on_error on failure.
      */
     template< typename OnResponseReceived, typename OnError >
     void
     register_temporary_callback
         ( id const& response_id
         , timer::duration const& callback_ttl
-        , OnResponseReceived const& on_response_received
-        , OnError const& on_error )
+        , OnResponseReceived && on_response_received
+        , OnError && on_error )
     {
-        auto on_timeout = [ this, on_error, response_id ]
+        // If the timeout expires, that means
+        // the message has never been received
+        // hence report the timeout to the client.
+        auto on_timeout = [ this, response_id ]
             ( void )
         {
-            // If a callback has been removed, that means
-            // the message has never been received
-            // hence report the timeout to the client.
-            if ( response_callbacks_.remove_callback( response_id ) )
-                on_error( make_error_code( std::errc::timed_out ) );
+            response_callbacks_.report_failure( response_id
+                    , make_error_code( std::errc::timed_out ) );
         };
 
+        auto const timeout = timer_.expires_from_now( callback_ttl
+                                                    , on_timeout );
+
         // Associate the response id with the
         // on_response_received callback.
         response_callbacks_.push_callback( response_id
-                                         , on_response_received );
+                , std::forward< OnResponseReceived >( on_response_received )
+                , std::forward< OnError >( on_error )
+                , timeout );
+    }
 
-        timer_.expires_from_now( callback_ttl, on_timeout );
+    /**
+     *  @brief Forget the callback associated with response_id.
+     *  @return true if the callback was still registered.
+     */
+    bool
+    remove_temporary_callback
+        ( id const& response_id )
+    {
+        timer::handle timeout;
+        if ( ! response_callbacks_.remove_callback( response_id, &timeout ) )
+            return false;
+
+        timer_.cancel( timeout );
+
+        return true;
     }
 
+    /**
+     *  @brief Forget the callback associated with response_id
+     *         and report failure through its error callback.
+     *  @return true if the callback was still registered.
+     */
+    bool
+    fail_temporary_callback
+        ( id const& response_id
+        , std::error_code const& failure )
+    {
+        timer::handle timeout;
+        if ( ! response_callbacks_.report_failure( response_id
+                                                 , failure
+                                                 , &timeout ) )
+            return false;
+
+        timer_.cancel( timeout );
+
+        return true;
+    }
+
+    /**
+     *  @return The count of callbacks waiting for their timeout.
+     */
+    std::size_t
+    pending_timeouts_count
+        ( void )
+        const
+    { return timer_.pending_timeouts_count(); }
+
 private:
     ///
     response_callbacks response_callbacks_;
@@ -32,14 +32,14 @@
 
 #include <algorithm>
 #include <cassert>
-#include <cstdint>
 #include <iostream>
-#include <list>
-#include <utility>
+#include <random>
 #include <vector>
 #include <boost/iterator/iterator_facade.hpp>
 
+#include "basic_routing_table.hpp"
 #include "id.hpp"
+#include "k_bucket.hpp"
 #include "log.hpp"
 
 namespace kademlia {
@@ -51,16 +51,25 @@ namespace detail {
  */
 template< typename PeerType >
 class routing_table final
+    : public basic_routing_table< routing_table< PeerType >, PeerType >
 {
+    ///
+    using base_type = basic_routing_table< routing_table, PeerType >;
+
+    friend base_type;
+
 public:
     ///
-    enum { DEFAULT_K_BUCKET_SIZE = 20 };
+    using peer_type = typename base_type::peer_type;
+
+    ///
+    using value_type = typename base_type::value_type;
 
     ///
-    using peer_type = PeerType;
+    using reference = typename base_type::reference;
 
     ///
-    using value_type = std::pair< id, peer_type >;
+    using clock = typename base_type::clock;
 
     class iterator;
 
@@ -70,115 +79,36 @@ public:
      */
     routing_table
         ( id const& my_id
-        , std::size_t k_bucket_size = DEFAULT_K_BUCKET_SIZE )
-            : k_buckets_( id::BIT_SIZE ), my_id_( my_id )
-            , peer_count_( 0 ), k_bucket_size_( k_bucket_size )
+        , std::size_t k_bucket_size = base_type::DEFAULT_K_BUCKET_SIZE )
+            : base_type( my_id, k_bucket_size )
             , largest_k_bucket_index_( 0 )
     {
-        assert( k_bucket_size_ > 0 && "k_bucket size must be > 0" );
+        // Buckets are idle from now on.
+        auto const now = clock::now();
 
-        LOG_DEBUG( routing_table, this ) << "created with id '"
-                << my_id_ << "'." << std::endl;
+        k_buckets_.reserve( id::BIT_SIZE );
+        for ( std::size_t i = 0; i != id::BIT_SIZE; ++ i )
+            k_buckets_.emplace_back( k_bucket_size_, now );
     }
 
     /**
-     *  Disabled copy constructor.
-     */
-    routing_table
-        ( routing_table const& )
-        = delete;
-
-    /**
-     *  Disabled assignement operator.
-     */
-    routing_table&
-    operator=
-        ( routing_table const& )
-        = delete;
-
-    /**
-     *  Count the number of peer in the routing table.
-     *  @note Complexity: O(1).
+     *  Generate a random id covered by a k_bucket,
+     *  i.e. sharing index leading bits with our id.
      */
-    std::size_t
-    peer_count
-        ( void )
+    id
+    random_id_in_k_bucket
+        ( std::size_t index
+        , std::default_random_engine & random_engine )
         const
-    { return peer_count_; }
-
-    /**
-     *  Register a peer into the routing table.
-     *  @return true if the peer has been inserted.
-     *  @note This method takes ownership of the peer.
-     *  @note The peer may not be pushed if the target bucket is full.
-     *  @note Complexity: O(log n)
-     */
-    bool
-    push
-        ( id const& peer_id
-        , peer_type const& new_peer )
     {
-        LOG_DEBUG( routing_table, this ) << "pushing peer '"
-                << new_peer << "' as '"
-                << peer_id << "'." << std::endl;
-
-        auto k_bucket_index = find_k_bucket_index( peer_id );
-        auto & bucket = k_buckets_[ k_bucket_index ];
-
-        // If there is room in the bucket.
-        if ( bucket.size() == k_bucket_size_ )
-        {
-            update_largest_k_bucket_index( k_bucket_index );
-
-            if ( k_bucket_index != largest_k_bucket_index_ )
-                return false;
-        }
-
-        auto const end = bucket.end();
-
-        // Check if the peer is not already known.
-        auto is_peer_known = [ &peer_id ] ( value_type const& entry )
-        { return entry.first == peer_id; };
-
-        if ( std::find_if( bucket.begin(), end, is_peer_known ) != end )
-            return false;
-
-        bucket.insert( end, value_type{ peer_id, new_peer } );
-        ++ peer_count_;
-
-        return true;
-    }
-
-    /**
-     *  Remove a peer from the routing table.
-     *  @return true if the peer has been removed.
-     *  @note Complexity: O(log n)
-     */
-    bool
-    remove
-        ( id const& peer_id )
-    {
-        LOG_DEBUG( routing_table, this ) << "removing peer '"
-                << peer_id << "'." << std::endl;
-
-        // Find the closer bucket.
-        auto & bucket = k_buckets_[ find_k_bucket_index( peer_id ) ];
-
-        // Check if the peer is inside.
-        auto is_peer_known = [&peer_id] ( value_type const& entry )
-        { return entry.first == peer_id; };
-
-        auto i = std::find_if( bucket.begin(), bucket.end(), is_peer_known );
-
-        // If the peer wasn't inside.
-        if ( i == bucket.end() )
-            return false;
+        assert( index < id::BIT_SIZE && "unknown k_bucket" );
 
-        // Remove it.
-        bucket.erase( i );
-        -- peer_count_;
+        id random_id{ random_engine };
+        for ( std::size_t i = 0; i != index; ++ i )
+            random_id[ i ] = bool( my_id_[ i ] );
+        random_id[ index ] = ! my_id_[ index ];
 
-        return true;
+        return random_id;
     }
 
     /**
@@ -202,7 +132,7 @@ public:
         while ( i->empty() && i != k_buckets_.begin() )
             -- i;
 
-        return iterator( &k_buckets_, i, i->begin() );
+        return iterator( &k_buckets_, i, 0 );
     }
 
     /**
@@ -216,46 +146,18 @@ public:
               && "routing_table must always contains k_buckets" );
         auto const first_k_bucket = k_buckets_.begin();
 
-        return iterator( &k_buckets_, first_k_bucket, first_k_bucket->end() );
-    }
-
-    /**
-     *  Print the routing table content.
-     *  @param out The output stream.
-     *  @param table The routing table to print.
-     *  @return A reference to the output stream.
-     */
-    friend std::ostream &
-    operator<<
-        ( std::ostream & out
-        , routing_table const& table )
-    {
-        out << "{" << std::endl
-            << "\t\"id\": " << table.my_id_ << "," << std::endl
-            << "\t\"peer_count\": " << table.peer_count_ << ',' << std::endl
-            << "\t\"k_bucket_size\": " << table.k_bucket_size_<< ',' << std::endl
-            << "\t\"k_buckets\": " << std::endl;
-
-        for ( std::size_t i = 0, e = table.k_buckets_.size(); i != e; ++i )
-        {
-            out << "\t{" << std::endl
-                << "\t\t\"index\": " << i << "," << std::endl
-                << "\t\t\"bit_value\": " << bool(table.my_id_[i]) << "," << std::endl
-                << "\t\t\"peer_count\": " << table.k_buckets_[i].size() << std::endl
-                << "\t}" << std::endl;
-        }
-
-        return out << "}" << std::endl;
+        return iterator( &k_buckets_, first_k_bucket, first_k_bucket->size() );
     }
 
 private:
-    /// Contains peer with a common base id.
-    using k_bucket = std::list< value_type >;
-    /// Contains all the k_bucket.
-    /// @note Algorithms expect a vector here, do not change this.
-    using k_buckets = std::vector< k_bucket >;
+    ///
+    using k_buckets = typename base_type::k_buckets;
 
 private:
+    using base_type::k_buckets_;
+    using base_type::my_id_;
+    using base_type::k_bucket_size_;
+
     /**
      *
      */
@@ -268,10 +170,9 @@ private:
         // i.e. the index of the first different bit
         // in the id of the new peer vs our id is equal to the
         // index of the closest bucket in the buckets container.
-        std::size_t bit_index = 0;
-        while ( bit_index < id::BIT_SIZE - 1
-              && id_to_find[ bit_index ] == my_id_[ bit_index ] )
-            ++ bit_index;
+        auto const bit_index = std::min( common_prefix_length( id_to_find
+                                                             , my_id_ )
+                                       , id::BIT_SIZE - 1 );
 
         LOG_DEBUG( routing_table, this ) << "found bucket at index '"
                 << bit_index << "'." << std::endl;
@@ -300,6 +201,44 @@ private:
         return i;
     }
 
+    /**
+     *  @note Only the largest k_bucket can exceed k_bucket_size.
+     */
+    bool
+    is_k_bucket_full
+        ( std::size_t index )
+    {
+        if ( k_buckets_[ index ].size() < k_bucket_size_ )
+            return false;
+
+        update_largest_k_bucket_index( index );
+
+        return index != largest_k_bucket_index_;
+    }
+
+    /**
+     *  @note k_buckets are never split, they all exist from the start.
+     */
+    bool
+    split_k_bucket
+        ( std::size_t )
+    { return false; }
+
+    /**
+     *  @return The count of k_buckets up to the deepest non empty one.
+     */
+    std::size_t
+    refreshable_k_buckets_count
+        ( void )
+        const
+    {
+        auto deepest = k_buckets_.size();
+        while ( deepest && k_buckets_[ deepest - 1 ].empty() )
+            -- deepest;
+
+        return deepest;
+    }
+
     /**
      *
      */
@@ -312,14 +251,6 @@ private:
     }
 
 private:
-    /// This contains buckets up to id bit count.
-    k_buckets k_buckets_;
-    /// Own id.
-    id const my_id_;
-    /// Keep a track of peer count to make size() complexity O(1).
-    std::size_t peer_count_;
-    /// This is max number of peers stored per k_bucket.
-    std::size_t k_bucket_size_;
     /// This keeps the index of the largest subtree.
     std::size_t largest_k_bucket_index_;
 };
@@ -332,7 +263,8 @@ class routing_table< PeerType >::iterator
     : public boost::iterator_facade
         < iterator
         , typename routing_table::value_type
-        , boost::single_pass_traversal_tag >
+        , boost::single_pass_traversal_tag
+        , typename routing_table::reference >
 {
 public:
     /**
@@ -341,26 +273,12 @@ public:
     iterator
         ( k_buckets * buckets
         , typename k_buckets::iterator current_bucket
-        , typename k_bucket::iterator current_peer )
+        , std::size_t current_peer )
         : k_buckets_( buckets )
         , current_k_bucket_( current_bucket )
         , current_entry_( current_peer )
     { }
 
-    /**
-     *
-     */
-    iterator &
-    operator=
-        ( iterator const& o )
-    {
-        k_buckets_ = o.k_buckets_;
-        current_k_bucket_ = o.current_k_bucket_;
-        current_entry_ = o.current_entry_;
-
-        return *this;
-    }
-
 private:
     friend class boost::iterator_core_access;
 
@@ -375,7 +293,7 @@ private:
 
         // If the current entry is not at the end of the bucket
         // then there is nothing more to do.
-        if ( current_entry_ != current_k_bucket_->end() )
+        if ( current_entry_ != current_k_bucket_->size() )
             return;
 
         // If the current bucket is already the first (far)
@@ -387,7 +305,7 @@ private:
         do
             -- current_k_bucket_;
         while ( current_k_bucket_->empty() && current_k_bucket_ != k_buckets_->begin() );
-        current_entry_ = current_k_bucket_->begin();
+        current_entry_ = 0;
     }
 
     /**
@@ -406,11 +324,11 @@ private:
     /**
      *
      */
-    typename routing_table::value_type &
+    typename routing_table::reference
     dereference
         ( void )
         const
-    { return *current_entry_; }
+    { return ( *current_k_bucket_ )[ current_entry_ ]; }
 
 private:
     ///
@@ -418,7 +336,7 @@ private:
     ///
     typename k_buckets::iterator current_k_bucket_;
     ///
-    typename k_bucket::iterator current_entry_;
+    std::size_t current_entry_;
 
 };
 
@@ -0,0 +1,214 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_RTT_ESTIMATOR_HPP
+#define KADEMLIA_RTT_ESTIMATOR_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+#include "constants.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Estimate the round trip time of the requests sent to a peer.
+ *
+ *  Smoothed round trip time & its variation are computed
+ *  as TCP does (RFC 6298), the request timeout being derived
+ *  from these two estimates. Each timeout doubles the request
+ *  timeout until the next sample, hence a peer slower than
+ *  the timeout eventually answers in time. As TCP backs off
+ *  once per lost window, requests in flight together
+ *  count as a single timeout.
+ */
+class rtt_estimator final
+{
+public:
+    ///
+    using duration = std::chrono::steady_clock::duration;
+
+    ///
+    using time_point = std::chrono::steady_clock::time_point;
+
+public:
+    /**
+     *
+     */
+    rtt_estimator
+        ( void )
+            : smoothed_rtt_(), rtt_variation_(), has_sample_()
+            , consecutive_timeouts_count_()
+            , last_timeout_( time_point::min() )
+    { }
+
+    /**
+     *  @return true if at least one sample has been recorded.
+     */
+    bool
+    has_sample
+        ( void )
+        const
+    { return has_sample_; }
+
+    /**
+     *
+     */
+    duration
+    smoothed_rtt
+        ( void )
+        const
+    { return smoothed_rtt_; }
+
+    /**
+     *
+     */
+    duration
+    rtt_variation
+        ( void )
+        const
+    { return rtt_variation_; }
+
+    /**
+     *  @return The count of timeouts since the last sample.
+     */
+    std::size_t
+    consecutive_timeouts_count
+        ( void )
+        const
+    { return consecutive_timeouts_count_; }
+
+    /**
+     *  Update the estimates with a new round trip time sample.
+     */
+    void
+    record
+        ( duration const& rtt )
+    {
+        consecutive_timeouts_count_ = 0;
+
+        if ( ! has_sample_ )
+        {
+            smoothed_rtt_ = rtt;
+            rtt_variation_ = rtt / 2;
+            has_sample_ = true;
+            return;
+        }
+
+        auto const error = rtt > smoothed_rtt_
+                         ? rtt - smoothed_rtt_
+                         : smoothed_rtt_ - rtt;
+
+        // RTTVAR = 3/4 * RTTVAR + 1/4 * |SRTT - R|
+        rtt_variation_ += ( error - rtt_variation_ ) / 4;
+        // SRTT = 7/8 * SRTT + 1/8 * R
+        smoothed_rtt_ += ( rtt - smoothed_rtt_ ) / 8;
+    }
+
+    /**
+     *  @return The time past which a response is later
+     *          than usual or zero if no sample has been recorded.
+     */
+    duration
+    soft_timeout
+        ( void )
+        const
+    {
+        if ( ! has_sample_ )
+            return duration::zero();
+
+        // SRTT + 2 * RTTVAR
+        return smoothed_rtt_ + 2 * rtt_variation_;
+    }
+
+    /**
+     *  Back off the timeout of the next requests
+     *  after a request sent at sent_at timed out at now.
+     *  @note Requests sent before the last recorded
+     *        timeout are ignored.
+     */
+    void
+    record_timeout
+        ( time_point const& sent_at
+        , time_point const& now )
+    {
+        if ( sent_at < last_timeout_ )
+            return;
+
+        ++ consecutive_timeouts_count_;
+        last_timeout_ = now;
+    }
+
+    /**
+     *  @return The timeout of the next request or
+     *          default_timeout if no sample has been recorded,
+     *          doubled for each timeout since the last sample.
+     */
+    duration
+    timeout
+        ( duration const& default_timeout )
+        const
+    {
+        duration t = default_timeout;
+
+        if ( has_sample_ )
+            // RTO = SRTT + 4 * RTTVAR
+            t = std::min< duration >
+                    ( std::max< duration >( smoothed_rtt_ + 4 * rtt_variation_
+                                          , MIN_REQUEST_TIMEOUT )
+                    , MAX_REQUEST_TIMEOUT );
+
+        // RTO = 2 * RTO up to the upper bound (RFC 6298 5.5).
+        for ( auto i = consecutive_timeouts_count_
+            ; i != 0 && t < MAX_REQUEST_TIMEOUT
+            ; -- i )
+            t = std::min< duration >( 2 * t, MAX_REQUEST_TIMEOUT );
+
+        return t;
+    }
+
+private:
+    ///
+    duration smoothed_rtt_;
+    ///
+    duration rtt_variation_;
+    ///
+    bool has_sample_;
+    ///
+    std::size_t consecutive_timeouts_count_;
+    ///
+    time_point last_timeout_;
+};
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
@@ -41,10 +41,12 @@ struct session::impl final
     impl
         ( endpoint const& initial_peer
         , endpoint const& listen_on_ipv4
-        , endpoint const& listen_on_ipv6 )
+        , endpoint const& listen_on_ipv6
+        , session_configuration const& configuration )
             : session_impl{ initial_peer
                           , listen_on_ipv4
-                          , listen_on_ipv6 }
+                          , listen_on_ipv6
+                          , configuration }
     { }
 };
 
@@ -52,7 +54,21 @@ session::session
     ( endpoint const& initial_peer
     , endpoint const& listen_on_ipv4
     , endpoint const& listen_on_ipv6 )
-        : impl_{ new impl{ initial_peer, listen_on_ipv4, listen_on_ipv6 } }
+        : session{ session_configuration{}
+                 , initial_peer
+                 , listen_on_ipv4
+                 , listen_on_ipv6 }
+{ }
+
+session::session
+    ( session_configuration const& configuration
+    , endpoint const& initial_peer
+    , endpoint const& listen_on_ipv4
+    , endpoint const& listen_on_ipv6 )
+        : impl_{ new impl{ initial_peer
+                         , listen_on_ipv4
+                         , listen_on_ipv6
+                         , configuration } }
 { }
 
 session::~session
@@ -77,6 +93,16 @@ session::run
     ( void )
 { return impl_->run(); }
 
+std::error_code
+session::run_concurrently
+    ( std::size_t threads_count )
+{ return impl_->run( threads_count ); }
+
+std::size_t
+session::poll
+    ( std::size_t max_handlers_count )
+{ return impl_->poll( max_handlers_count ); }
+
 void
 session::abort
         ( void )
@@ -33,13 +33,22 @@
 
 #include "session_impl.hpp"
 
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/udp.hpp>
 
 #include "message_socket.hpp"
+#ifdef KADEMLIA_ENABLE_BATCHED_IO
+#   include "batched_udp_socket.hpp"
+#endif
 #include "engine.hpp"
 #include "concurrent_guard.hpp"
+#include "submission_queue.hpp"
 
 namespace kademlia {
 namespace detail {
@@ -55,7 +64,11 @@ public:
     ///
     using key_type = std::vector< std::uint8_t >;
     ///
+#ifdef KADEMLIA_ENABLE_BATCHED_IO
+    using socket_type = batched_udp_socket;
+#else
     using socket_type = boost::asio::ip::udp::socket;
+#endif
     ///
     using engine_type = detail::engine< socket_type >;
 
@@ -65,12 +78,16 @@ public:
      */
     session_impl
         ( endpoint const& listen_on_ipv4
-        , endpoint const& listen_on_ipv6 )
+        , endpoint const& listen_on_ipv6
+        , session_configuration const& configuration )
             : io_service_{}
+            , work_{ io_service_ }
             , engine_{ io_service_
                      , listen_on_ipv4
-                     , listen_on_ipv6 }
-            , is_abort_requested_{}
+                     , listen_on_ipv6
+                     , id{}
+                     , configuration }
+            , submissions_{}
             , concurrent_guard_{}
     { }
 
@@ -80,18 +97,22 @@ public:
     session_impl
         ( endpoint const& initial_peer
         , endpoint const& listen_on_ipv4
-        , endpoint const& listen_on_ipv6 )
+        , endpoint const& listen_on_ipv6
+        , session_configuration const& configuration )
             : io_service_{}
+            , work_{ io_service_ }
             , engine_{ io_service_
                      , initial_peer
                      , listen_on_ipv4
-                     , listen_on_ipv6 }
-            , is_abort_requested_{}
+                     , listen_on_ipv6
+                     , id{}
+                     , configuration }
+            , submissions_{}
             , concurrent_guard_{}
     { }
 
     /**
-     *
+     *  @note This method can be called concurrently.
      */
     template< typename HandlerType >
     void
@@ -100,13 +121,17 @@ public:
         , data_type const& data
         , HandlerType && handler )
     {
-        engine_.async_save( key
-                          , data
-                          , std::forward< HandlerType >( handler ) );
+        using handler_type = typename std::decay< HandlerType >::type;
+        auto save = [ this, key, data
+                    , handler = handler_type( std::forward< HandlerType >( handler ) ) ]
+            ( void ) mutable
+        { engine_.async_save( key, data, std::move( handler ) ); };
+
+        submit( std::move( save ) );
     }
 
     /**
-     *
+     *  @note This method can be called concurrently.
      */
     template< typename HandlerType >
     void
@@ -114,8 +139,13 @@ public:
         ( key_type const& key
         , HandlerType && handler )
     {
-        engine_.async_load( key
-                          , std::forward< HandlerType >( handler ) );
+        using handler_type = typename std::decay< HandlerType >::type;
+        auto load = [ this, key
+                    , handler = handler_type( std::forward< HandlerType >( handler ) ) ]
+            ( void ) mutable
+        { engine_.async_load( key, std::move( handler ) ); };
+
+        submit( std::move( load ) );
     }
 
     /**
@@ -124,23 +154,87 @@ public:
     std::error_code
     run
         ( void )
+    { return run( 1 ); }
+
+    /**
+     *  @brief Run the main loop from the calling thread
+     *         and threads_count - 1 additional threads.
+     */
+    std::error_code
+    run
+        ( std::size_t threads_count )
     {
         // Protect against concurrent invocation of this method.
         detail::concurrent_guard::sentry s{ concurrent_guard_ };
         if ( ! s )
             return make_error_code( ALREADY_RUNNING );
 
-        is_abort_requested_ = false;
+        // Clear the stopped state left by a previous abort().
+        io_service_.reset();
+
+        std::exception_ptr failure;
+        std::mutex failure_mutex;
 
-        while ( ! is_abort_requested_ )
+        // The work guard keeps io_service::run() dispatching
+        // handlers until abort() stops it. The first exception
+        // thrown stops every thread and is rethrown from the
+        // calling thread.
+        auto run_loop = [ this, &failure, &failure_mutex ] ( void )
         {
-            io_service_.run_one();
-            io_service_.poll();
-        }
+            try
+            {
+                io_service_.run();
+            }
+            catch ( ... )
+            {
+                std::lock_guard< std::mutex > const lock{ failure_mutex };
+                if ( ! failure )
+                    failure = std::current_exception();
+
+                io_service_.stop();
+            }
+        };
+
+        std::vector< std::thread > threads;
+        for ( std::size_t i = 1; i < threads_count; ++ i )
+            threads.emplace_back( run_loop );
+
+        run_loop();
+
+        for ( auto & t : threads )
+            t.join();
+
+        if ( failure )
+            std::rethrow_exception( failure );
 
         return make_error_code( RUN_ABORTED );
     }
 
+    /**
+     *  @brief Execute at most max_handlers_count ready handlers
+     *         from the calling thread without blocking.
+     *  @return The number of executed handlers.
+     */
+    std::size_t
+    poll
+        ( std::size_t max_handlers_count )
+    {
+        // Protect against concurrent invocation of this method.
+        detail::concurrent_guard::sentry s{ concurrent_guard_ };
+        if ( ! s )
+            return 0;
+
+        if ( io_service_.stopped() )
+            io_service_.reset();
+
+        std::size_t executed_count = 0;
+        while ( executed_count < max_handlers_count
+              && io_service_.poll_one() )
+            ++ executed_count;
+
+        return executed_count;
+    }
+
     /**
      *
      */
@@ -149,18 +243,64 @@ public:
         ( void )
     {
         auto service_stopper = [ this ] ( void )
-        { is_abort_requested_ = true; };
+        { io_service_.stop(); };
 
         io_service_.post( service_stopper );
     }
 
+private:
+    /**
+     *  @brief Forward task to the engine strand.
+     *
+     *  Tasks submitted while a previous batch is still waiting
+     *  to be executed are appended to it, hence only the first
+     *  task of a batch costs an io_service post.
+     */
+    template< typename Task >
+    void
+    submit
+        ( Task && task )
+    {
+        if ( submissions_.push( std::forward< Task >( task ) ) )
+            schedule_submissions_consumption();
+    }
+
+    /**
+     *  @brief Execute the submitted tasks from the engine strand.
+     *
+     *  If a task throws, the exception reaches run() while the
+     *  tasks following it stay queued, hence they are executed
+     *  once the application calls run() again.
+     */
+    void
+    schedule_submissions_consumption
+        ( void )
+    {
+        auto consume = [ this ] ( void )
+        {
+            try
+            {
+                submissions_.consume_all();
+            }
+            catch ( ... )
+            {
+                schedule_submissions_consumption();
+                throw;
+            }
+        };
+
+        engine_.post( std::move( consume ) );
+    }
+
 private:
     ///
     boost::asio::io_service io_service_;
     ///
+    boost::asio::io_service::work work_;
+    ///
     engine_type engine_;
     ///
-    bool is_abort_requested_;
+    submission_queue submissions_;
     ///
     detail::concurrent_guard concurrent_guard_;
 };
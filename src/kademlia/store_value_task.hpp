@@ -30,10 +30,15 @@
 #   pragma once
 #endif
 
+#include <cassert>
+#include <chrono>
 #include <memory>
 #include <type_traits>
+#include <utility>
 #include <system_error>
 
+#include <kademlia/session_configuration.hpp>
+
 #include "lookup_task.hpp"
 #include "log.hpp"
 #include "message.hpp"
@@ -66,16 +71,20 @@ public:
     start
         ( detail::id const & key
         , data_type const& data
+        , std::chrono::milliseconds const& lifetime
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , save_handler_type handler )
+        , save_handler_type handler
+        , session_configuration const& configuration )
     {
         std::shared_ptr< store_value_task > c;
         c.reset( new store_value_task( key
                                      , data
+                                     , lifetime
                                      , tracker
                                      , routing_table
-                                     , std::move( handler ) ) );
+                                     , std::move( handler )
+                                     , configuration ) );
 
         try_to_store_value( c );
     }
@@ -88,15 +97,22 @@ private:
     store_value_task
         ( detail::id const & key
         , data_type const& data
+        , std::chrono::milliseconds const& lifetime
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , HandlerType && save_handler )
+        , HandlerType && save_handler
+        , session_configuration const& configuration )
             : lookup_task( key
                          , routing_table.find( key )
-                         , routing_table.end() )
+                         , routing_table.end()
+                         , configuration.bucket_size()
+                         , configuration.lookup_candidates_count() )
             , tracker_( tracker )
+            , configuration_( configuration )
             , data_( data )
+            , lifetime_( lifetime )
             , save_handler_( std::forward< HandlerType >( save_handler ) )
+            , is_finished_()
     {
         LOG_DEBUG( store_value_task, this )
                 << "create store value task for '"
@@ -110,7 +126,20 @@ private:
     void
     notify_caller
         ( std::error_code const& failure )
-    { save_handler_( failure ); }
+    {
+        assert( ! is_caller_notified() );
+        save_handler_( failure );
+        is_finished_ = true;
+    }
+
+    /**
+     *
+     */
+    bool
+    is_caller_notified
+        ( void )
+        const
+    { return is_finished_; }
 
     /**
      *
@@ -121,14 +150,26 @@ private:
         const
     { return data_; }
 
+    /**
+     *
+     */
+    std::chrono::milliseconds const&
+    get_lifetime
+        ( void )
+        const
+    { return lifetime_; }
+
     /**
      *
      */
     static void
     try_to_store_value
-        ( std::shared_ptr< store_value_task > task
-        , std::size_t concurrent_requests_count = CONCURRENT_FIND_PEER_REQUESTS_COUNT )
+        ( std::shared_ptr< store_value_task > task )
     {
+        // Late responses are ignored once the value has been stored.
+        if ( task->is_caller_notified() )
+            return;
+
         LOG_DEBUG( store_value_task, task.get() )
                 << "trying to find closer peer to store '"
                 << task->get_key() << "' value." << std::endl;
@@ -136,16 +177,16 @@ private:
         find_peer_request_body const request{ task->get_key() };
 
         auto const closest_candidates = task->select_new_closest_candidates
-                ( concurrent_requests_count );
+                ( task->configuration_.concurrent_requests_count() );
 
         for ( auto const& c : closest_candidates )
             send_find_peer_to_store_request( request, c, task );
 
-        // If no more requests are in flight
-        // we know the closest peers hence ask
-        // them to store the value.
-        if ( task->have_all_requests_completed() )
-            send_store_requests( task ); 
+        // If the closest peers have responded
+        // we know them hence ask them to store
+        // the value.
+        if ( task->is_converged() )
+            send_store_requests( task );
     }
 
     /**
@@ -176,18 +217,18 @@ private:
         auto on_error = [ task, current_candidate ]
             ( std::error_code const& )
         {
-            // XXX: Can also flag candidate as invalid is
-            // present in routing table.
+            // The tracker has already reported a timeout to the
+            // routing table, which drops peers timing out repeatedly.
             task->flag_candidate_as_invalid( current_candidate.id_ );
 
             try_to_store_value( task );
         };
 
         task->tracker_.send_request( request
-                                   , current_candidate.endpoint_
-                                   , PEER_LOOKUP_TIMEOUT
-                                   , on_message_received
-                                   , on_error );
+                                   , current_candidate
+                                   , task->configuration_.peer_lookup_timeout()
+                                   , std::move( on_message_received )
+                                   , std::move( on_error ) );
     }
 
     /**
@@ -242,7 +283,8 @@ private:
         ( std::shared_ptr< store_value_task > task )
     {
         auto const & candidates
-                = task->select_closest_valid_candidates( REDUNDANT_SAVE_COUNT );
+                = task->select_closest_valid_candidates
+                        ( task->configuration_.redundant_saves_count() );
 
         for ( auto c : candidates )
             send_store_request( c, task );
@@ -267,7 +309,8 @@ private:
                 << current_candidate << "'." << std::endl;
 
         store_value_request_body const request{ task->get_key()
-                                              , task->get_data() };
+                                              , task->get_data()
+                                              , task->get_lifetime() };
         task->tracker_.send_request( request, current_candidate.endpoint_ );
     }
 
@@ -275,9 +318,15 @@ private:
     ///
     tracker_type & tracker_;
     ///
+    session_configuration const configuration_;
+    ///
     data_type data_;
+    /// Time left before the value expires.
+    std::chrono::milliseconds lifetime_;
     ///
     save_handler_type save_handler_;
+    ///
+    bool is_finished_;
 };
 
 /**
@@ -291,15 +340,18 @@ void
 start_store_value_task
     ( id const& key
     , DataType const& data
+    , std::chrono::milliseconds const& lifetime
     , TrackerType & tracker
     , RoutingTableType & routing_table
-    , HandlerType && save_handler )
+    , HandlerType && save_handler
+    , session_configuration const& configuration = session_configuration{} )
 {
     using handler_type = typename std::decay< HandlerType >::type;
     using task = store_value_task< handler_type, TrackerType, DataType >;
 
-    task::start( key, data, tracker, routing_table
-               , std::forward< HandlerType >( save_handler ) );
+    task::start( key, data, lifetime, tracker, routing_table
+               , std::forward< HandlerType >( save_handler )
+               , configuration );
 }
 
 } // namespace detail
@@ -0,0 +1,281 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_SUBMISSION_QUEUE_HPP
+#define KADEMLIA_SUBMISSION_QUEUE_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Lock-free multiple producers / single consumer queue of tasks.
+ *
+ *  Producers push tasks from any thread while the consumer executes
+ *  all of them at once, in submission order. push() reports when
+ *  the queue was empty, i.e. when a new consumption has to be
+ *  scheduled, so that a burst of submissions requires a single wakeup
+ *  of the consumer. As io_service does with its handlers, tasks left
+ *  unexecuted by a throwing task stay queued.
+ */
+class submission_queue final
+{
+public:
+    /**
+     *
+     */
+    submission_queue
+        ( void )
+            : head_{ nullptr }
+    { }
+
+    /**
+     *
+     */
+    submission_queue
+        ( submission_queue const& )
+        = delete;
+
+    /**
+     *
+     */
+    submission_queue &
+    operator=
+        ( submission_queue const& )
+        = delete;
+
+    /**
+     *
+     */
+    ~submission_queue
+        ( void )
+    { delete_tasks( head_.exchange( nullptr, std::memory_order_acquire ) ); }
+
+    /**
+     *  @brief Enqueue a task.
+     *  @note This method can be called concurrently.
+     *  @return true if the queue was empty, hence the consumer
+     *          must be scheduled to execute this task.
+     */
+    template< typename Task >
+    bool
+    push
+        ( Task && task )
+    {
+        using task_type = typename std::decay< Task >::type;
+
+        task_base * t = new concrete_task< task_type >
+                { std::forward< Task >( task ) };
+
+        auto head = head_.load( std::memory_order_relaxed );
+        do
+            t->next_ = head;
+        while ( ! head_.compare_exchange_weak( head, t
+                                             , std::memory_order_release
+                                             , std::memory_order_relaxed ) );
+
+        return head == nullptr;
+    }
+
+    /**
+     *  @brief Execute all the tasks enqueued so far.
+     *  @note This method must not be called concurrently.
+     *  @note If a task throws, the tasks following it are put
+     *        back ahead of the ones pushed since, hence the
+     *        consumer must be scheduled again.
+     *  @return The number of executed tasks.
+     */
+    std::size_t
+    consume_all
+        ( void )
+    {
+        // Tasks have been stacked, hence restore submission order.
+        task_base * reversed = nullptr;
+        for ( auto t = head_.exchange( nullptr, std::memory_order_acquire )
+            ; t
+            ; )
+        {
+            auto next = t->next_;
+            t->next_ = reversed;
+            reversed = t;
+            t = next;
+        }
+
+        // Remaining tasks are put back if one of them throws.
+        task_list_restorer remaining{ *this, reversed };
+
+        std::size_t executed_count = 0;
+        while ( remaining.head_ )
+        {
+            std::unique_ptr< task_base > current{ remaining.head_ };
+            remaining.head_ = current->next_;
+
+            current->execute();
+            ++ executed_count;
+        }
+
+        return executed_count;
+    }
+
+private:
+    ///
+    struct task_base
+    {
+        ///
+        virtual
+        ~task_base
+            ( void )
+            = default;
+
+        ///
+        virtual void
+        execute
+            ( void )
+            = 0;
+
+        ///
+        task_base * next_;
+    };
+
+    ///
+    template< typename Task >
+    struct concrete_task final
+            : task_base
+    {
+        ///
+        explicit
+        concrete_task
+            ( Task && task )
+                : task_( std::move( task ) )
+        { }
+
+        ///
+        explicit
+        concrete_task
+            ( Task const& task )
+                : task_( task )
+        { }
+
+        ///
+        void
+        execute
+            ( void )
+            override
+        { task_(); }
+
+        ///
+        Task task_;
+    };
+
+    ///
+    struct task_list_restorer final
+    {
+        ///
+        ~task_list_restorer
+            ( void )
+        { queue_.restore( head_ ); }
+
+        ///
+        submission_queue & queue_;
+        ///
+        task_base * head_;
+    };
+
+private:
+    /**
+     *  @brief Enqueue tasks listed in submission order
+     *         ahead of the tasks already enqueued.
+     */
+    void
+    restore
+        ( task_base * t )
+    {
+        // Stack them, the oldest one at the bottom.
+        task_base * stacked = nullptr;
+        while ( t )
+        {
+            auto next = t->next_;
+            t->next_ = stacked;
+            stacked = t;
+            t = next;
+        }
+
+        if ( ! stacked )
+            return;
+
+        task_base * head = nullptr;
+        while ( ! head_.compare_exchange_weak( head, stacked
+                                             , std::memory_order_release
+                                             , std::memory_order_relaxed ) )
+        {
+            // Tasks pushed meanwhile are more recent,
+            // hence stacked above the restored ones.
+            auto pushed = head_.exchange( nullptr, std::memory_order_acquire );
+            if ( pushed )
+            {
+                auto bottom = pushed;
+                while ( bottom->next_ )
+                    bottom = bottom->next_;
+                bottom->next_ = stacked;
+                stacked = pushed;
+            }
+
+            head = nullptr;
+        }
+    }
+
+    /**
+     *
+     */
+    static void
+    delete_tasks
+        ( task_base * t )
+    {
+        while ( t )
+        {
+            auto next = t->next_;
+            delete t;
+            t = next;
+        }
+    }
+
+private:
+    ///
+    std::atomic< task_base * > head_;
+};
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
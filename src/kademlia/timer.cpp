@@ -25,6 +25,7 @@
 
 #include "timer.hpp"
 
+#include <cassert>
 #include <functional>
 
 #include <kademlia/error.hpp>
@@ -34,16 +35,52 @@
 namespace kademlia {
 namespace detail {
 
+constexpr timer::duration timer::DEFAULT_TICK;
+
 timer::timer
-    ( boost::asio::io_service & io_service )
-    : timer_{ io_service }
-    , timeouts_{}
+    ( boost::asio::io_service & io_service
+    , duration const& tick )
+    : timer{ boost::asio::io_service::strand{ io_service }, tick }
 {}
 
+timer::timer
+    ( boost::asio::io_service::strand const& strand
+    , duration const& tick )
+    : strand_{ strand }
+    , timer_{ strand_.context() }
+    , tick_{ tick }
+    , origin_{ clock::now() }
+    , timeouts_{}
+    , waiting_{ false }
+    , waited_tick_{ 0 }
+{
+    assert( tick_ > duration::zero() && "tick must be positive" );
+}
+
+timer::tick_type
+timer::to_tick
+    ( time_point const& t )
+    const
+{
+    return static_cast< tick_type >( ( t - origin_ ) / tick_ );
+}
+
 void
 timer::schedule_next_tick
-    ( time_point const& expiration_time )
+    ( void )
 {
+    if ( timeouts_.empty() )
+        return;
+
+    auto const next_tick = timeouts_.next_tick();
+    if ( waiting_ && waited_tick_ <= next_tick )
+        return;
+
+    waiting_ = true;
+    waited_tick_ = next_tick;
+
+    auto const expiration_time = origin_ + next_tick * tick_;
+
     // This will cancel any pending task.
     timer_.expires_at( expiration_time );
 
@@ -52,7 +89,7 @@ timer::schedule_next_tick
             << "." << std::endl;
 
     using std::placeholders::_1;
-    timer_.async_wait( std::bind( &timer::on_fire, this, _1 ) );
+    timer_.async_wait( strand_.wrap( std::bind( &timer::on_fire, this, _1 ) ) );
 }
 
 void
@@ -67,30 +104,18 @@ timer::on_fire
     if ( failure )
         throw std::system_error{ make_error_code( TIMER_MALFUNCTION ) };
 
-    // The callbacks to execute are the first
-    // n callbacks with the same keys.
-    auto begin = timeouts_.begin();
-    auto end = timeouts_.upper_bound( begin->first );
-    // Call the user callbacks.
-    for ( auto i = begin; i != end; ++ i )
-        i->second();
+    waiting_ = false;
 
-    LOG_DEBUG( timer, this )
-            << "remove " << std::distance( begin, end )
-            << " callback(s) scheduled at "
-            << begin->first.time_since_epoch().count()
-            << "." << std::endl;
+    // Call the user callbacks of the expired timeouts,
+    // the others move closer to expiration.
+    auto const executed_count = timeouts_.advance( to_tick( clock::now() ) );
 
-    // And remove the timeout.
-    timeouts_.erase( begin, end );
+    LOG_DEBUG( timer, this )
+            << "executed " << executed_count
+            << " callback(s)." << std::endl;
 
     // If there is a remaining timeout, schedule it.
-    if ( ! timeouts_.empty() )
-    {
-        LOG_DEBUG( timer, this )
-                << "schedule remaining timers" << std::endl;
-        schedule_next_tick( timeouts_.begin()->first );
-    }
+    schedule_next_tick();
 }
 
 } // namespace detail
@@ -30,16 +30,25 @@
 #   pragma once
 #endif
 
-#include <map>
 #include <chrono>
-#include <functional>
+#include <cstddef>
+#include <utility>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/basic_waitable_timer.hpp>
 
+#include "timing_wheel.hpp"
+
 namespace kademlia {
 namespace detail {
 
-///
+/**
+ *  @brief Execute callbacks after a timeout.
+ *
+ *  Timeouts are rounded up to a tick and stored
+ *  into a timing wheel, the underlying asio timer
+ *  only waits for the next tick to process.
+ */
 class timer final
 {
 public:
@@ -49,43 +58,83 @@ public:
     ///
     using duration = clock::duration;
 
+    /// Identifies a pending timeout.
+    using handle = timing_wheel::handle;
+
+    /// The granularity of the timeouts.
+    static constexpr duration DEFAULT_TICK = std::chrono::milliseconds{ 1 };
+
 public:
     /**
      *
      */
     explicit
     timer
-        ( boost::asio::io_service & io_service );
+        ( boost::asio::io_service & io_service
+        , duration const& tick = DEFAULT_TICK );
 
     /**
-     *
+     *  @brief Create a timer whose callbacks are executed
+     *         through the provided strand.
+     */
+    explicit
+    timer
+        ( boost::asio::io_service::strand const& strand
+        , duration const& tick = DEFAULT_TICK );
+
+    /**
+     *  @return A handle usable to cancel the timeout.
      */
     template< typename Callback >
-    void
+    handle
     expires_from_now
         ( duration const& timeout
-        , Callback const& on_timer_expired );
+        , Callback && on_timer_expired );
+
+    /**
+     *  @brief Forget a pending timeout, its callback won't be executed.
+     *  @return true if the timeout was still pending.
+     */
+    bool
+    cancel
+        ( handle const& timeout )
+    { return timeouts_.cancel( timeout ); }
+
+    /**
+     *
+     */
+    std::size_t
+    pending_timeouts_count
+        ( void )
+        const
+    { return timeouts_.size(); }
 
 private:
     ///
     using time_point = clock::time_point;
 
     ///
-    using callback = std::function< void ( void ) >;
-
-    ///
-    using timeouts = std::multimap< time_point, callback >;
+    using tick_type = timing_wheel::tick_type;
 
     ///
     using deadline_timer = boost::asio::basic_waitable_timer< clock >;
 
 private:
     /**
-     *
+     *  @return The tick the provided time belongs to.
+     */
+    tick_type
+    to_tick
+        ( time_point const& t )
+        const;
+
+    /**
+     *  @brief Wait for the next tick of the wheel if it's
+     *         sooner than the one currently waited for.
      */
     void
     schedule_next_tick
-        ( time_point const& expiration_time );
+        ( void );
 
     /**
      *
@@ -95,26 +144,38 @@ private:
         ( boost::system::error_code const& failure );
 
 private:
+    ///
+    boost::asio::io_service::strand strand_;
     ///
     deadline_timer timer_;
     ///
-    timeouts timeouts_;
+    duration tick_;
+    /// The tick 0 of the wheel.
+    time_point origin_;
+    ///
+    timing_wheel timeouts_;
+    ///
+    bool waiting_;
+    /// Valid if waiting_.
+    tick_type waited_tick_;
 };
 
 template< typename Callback >
-void
+timer::handle
 timer::expires_from_now
     ( duration const& timeout
-    , Callback const& on_timer_expired )
+    , Callback && on_timer_expired )
 {
-    auto expiration_time = clock::now() + timeout;
+    // Round up, a timeout never expires early.
+    auto const expiration_time = clock::now() + timeout + tick_ - duration{ 1 };
+    auto const h = timeouts_.insert( to_tick( expiration_time )
+                                   , std::forward< Callback >( on_timer_expired ) );
 
     // If the current expiration time will be the sooner to expires
     // then cancel any pending wait and schedule this one instead.
-    if ( timeouts_.empty() || expiration_time < timeouts_.begin()->first )
-        schedule_next_tick( expiration_time );
+    schedule_next_tick();
 
-    timeouts_.emplace( expiration_time, on_timer_expired );
+    return h;
 }
 
 } // namespace detail
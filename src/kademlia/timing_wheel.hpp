@@ -0,0 +1,563 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_TIMING_WHEEL_HPP
+#define KADEMLIA_TIMING_WHEEL_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <utility>
+
+#include "inplace_function.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Hierarchical timing wheel.
+ *
+ *  Timeouts are expressed in ticks. Each level splits the time
+ *  into SLOTS_COUNT slots, a slot of a level covering a whole
+ *  revolution of the level below. A timeout is stored in the lowest
+ *  level where its expiration tick differs from the current one,
+ *  and cascades to the lower levels as the wheel advances.
+ *
+ *  Insertion and cancellation are O(1), the timeout nodes
+ *  are recycled hence don't allocate once the wheel is warm.
+ */
+class timing_wheel final
+{
+public:
+    ///
+    using tick_type = std::uint64_t;
+
+    ///
+    using callback_type = inplace_function< void ( void ) >;
+
+    ///
+    static constexpr std::size_t SLOT_BITS = 6;
+
+    ///
+    static constexpr std::size_t SLOTS_COUNT = 1 << SLOT_BITS;
+
+    /// Timeouts beyond SLOTS_COUNT ^ LEVELS_COUNT ticks are delayed.
+    static constexpr std::size_t LEVELS_COUNT = 4;
+
+private:
+    ///
+    struct node;
+
+public:
+    /**
+     *  @brief Identifies an inserted timeout.
+     *
+     *  A handle remains safe to use once its timeout
+     *  has expired or has been cancelled.
+     */
+    class handle final
+    {
+    public:
+        /**
+         *
+         */
+        handle
+            ( void )
+                : node_{ nullptr }
+                , generation_{ 0 }
+        { }
+
+    private:
+        friend class timing_wheel;
+
+        /**
+         *
+         */
+        handle
+            ( node * n
+            , std::uint64_t generation )
+                : node_{ n }
+                , generation_{ generation }
+        { }
+
+    private:
+        ///
+        node * node_;
+        ///
+        std::uint64_t generation_;
+    };
+
+public:
+    /**
+     *
+     */
+    explicit
+    timing_wheel
+        ( tick_type now = 0 )
+            : now_{ now }
+            , size_{ 0 }
+            , slots_()
+            , occupied_slots_()
+            , overflow_{}
+            , expired_{}
+            , nodes_()
+            , free_nodes_{ nullptr }
+    {
+        for ( std::size_t l = 0; l != LEVELS_COUNT; ++ l )
+            for ( std::size_t s = 0; s != SLOTS_COUNT; ++ s )
+                slots_[ l ][ s ] = slot{ l, s };
+
+        overflow_ = slot{ LEVELS_COUNT, 0 };
+        expired_ = slot{ LEVELS_COUNT, 0 };
+    }
+
+    /**
+     *
+     */
+    timing_wheel
+        ( timing_wheel const& )
+        = delete;
+
+    /**
+     *
+     */
+    timing_wheel &
+    operator=
+        ( timing_wheel const& )
+        = delete;
+
+    /**
+     *  @return The tick the wheel has been advanced to.
+     */
+    tick_type
+    now
+        ( void )
+        const
+    { return now_; }
+
+    /**
+     *  @return The count of pending timeouts.
+     */
+    std::size_t
+    size
+        ( void )
+        const
+    { return size_; }
+
+    /**
+     *
+     */
+    bool
+    empty
+        ( void )
+        const
+    { return size_ == 0; }
+
+    /**
+     *  @brief Execute callback once the wheel is advanced
+     *         to expiration or later.
+     *
+     *  An expiration already elapsed is moved to the next tick.
+     */
+    handle
+    insert
+        ( tick_type expiration
+        , callback_type callback )
+    {
+        auto n = acquire_node();
+        n->expiration_ = std::max( expiration, now_ + 1 );
+        n->callback_ = std::move( callback );
+
+        place( n );
+        ++ size_;
+
+        return handle{ n, n->generation_ };
+    }
+
+    /**
+     *  @return true if the timeout was pending and has been cancelled.
+     */
+    bool
+    cancel
+        ( handle const& h )
+    {
+        auto n = h.node_;
+        if ( ! n || n->generation_ != h.generation_ || ! n->owner_ )
+            return false;
+
+        unlink( n );
+        -- size_;
+        release_node( n );
+
+        return true;
+    }
+
+    /**
+     *  @return The tick advance() has to be called at, to either
+     *          execute timeouts or cascade them to lower levels.
+     *  @pre The wheel isn't empty.
+     */
+    tick_type
+    next_tick
+        ( void )
+        const
+    {
+        assert( ! empty() && "the wheel has no pending timeout" );
+
+        if ( expired_.first_ )
+            return now_;
+
+        auto next = std::numeric_limits< tick_type >::max();
+
+        for ( std::size_t l = 0; l != LEVELS_COUNT; ++ l )
+        {
+            auto const occupied = occupied_slots_[ l ];
+            if ( ! occupied )
+                continue;
+
+            auto const shift = l * SLOT_BITS;
+            auto const current = ( now_ >> shift ) & SLOT_MASK;
+            // Slot current is always empty, hence distance is in [1, SLOTS_COUNT[.
+            auto const rotated = ( occupied >> current )
+                               | ( occupied << ( ( SLOTS_COUNT - current ) & SLOT_MASK ) );
+            auto const distance = count_trailing_zeros( rotated );
+
+            next = std::min( next, ( ( now_ >> shift ) + distance ) << shift );
+        }
+
+        if ( overflow_.first_ )
+        {
+            auto const shift = LEVELS_COUNT * SLOT_BITS;
+            next = std::min( next, ( ( now_ >> shift ) + 1 ) << shift );
+        }
+
+        return next;
+    }
+
+    /**
+     *  @brief Advance the wheel to now and execute
+     *         the callbacks of the expired timeouts.
+     *  @return The count of executed callbacks.
+     */
+    std::size_t
+    advance
+        ( tick_type now )
+    {
+        if ( now <= now_ )
+            return 0;
+
+        // Collect the nodes of the slots entered while
+        // moving from now_ to now.
+        slot pending{ LEVELS_COUNT, 0 };
+        for ( std::size_t l = 0; l != LEVELS_COUNT; ++ l )
+        {
+            auto const shift = l * SLOT_BITS;
+            auto const from = now_ >> shift, to = now >> shift;
+            // Higher levels haven't moved either.
+            if ( from == to )
+                break;
+
+            auto const entered_count = std::min< tick_type >( to - from, SLOTS_COUNT );
+            for ( tick_type i = 1; i <= entered_count; ++ i )
+            {
+                auto & s = slots_[ l ][ ( from + i ) & SLOT_MASK ];
+                if ( s.first_ )
+                    splice( s, pending );
+            }
+        }
+
+        auto const overflow_shift = LEVELS_COUNT * SLOT_BITS;
+        if ( ( now_ >> overflow_shift ) != ( now >> overflow_shift )
+           && overflow_.first_ )
+            splice( overflow_, pending );
+
+        now_ = now;
+
+        // Either the nodes expired or they cascade to a lower level.
+        for ( auto n = pending.first_, next = n; n; n = next )
+        {
+            next = n->next_;
+            if ( n->expiration_ <= now_ )
+                link( n, expired_ );
+            else
+                place( n );
+        }
+
+        // Callbacks can insert or cancel timeouts.
+        std::size_t executed_count = 0;
+        while ( auto n = expired_.first_ )
+        {
+            unlink( n );
+            -- size_;
+
+            auto callback = std::move( n->callback_ );
+            release_node( n );
+
+            callback();
+            ++ executed_count;
+        }
+
+        return executed_count;
+    }
+
+private:
+    ///
+    static constexpr tick_type SLOT_MASK = SLOTS_COUNT - 1;
+
+    ///
+    struct slot final
+    {
+        ///
+        slot
+            ( void )
+                : first_{ nullptr }
+                , last_{ nullptr }
+                , level_{ 0 }
+                , index_{ 0 }
+        { }
+
+        ///
+        slot
+            ( std::size_t level
+            , std::size_t index )
+                : first_{ nullptr }
+                , last_{ nullptr }
+                , level_{ level }
+                , index_{ index }
+        { }
+
+        ///
+        node * first_;
+        ///
+        node * last_;
+        /// LEVELS_COUNT if the slot doesn't belong to a level.
+        std::size_t level_;
+        ///
+        std::size_t index_;
+    };
+
+    ///
+    struct node final
+    {
+        ///
+        node * previous_;
+        ///
+        node * next_;
+        /// The slot the node belongs to, if it's pending.
+        slot * owner_;
+        ///
+        tick_type expiration_;
+        /// Incremented each time the node is recycled.
+        std::uint64_t generation_;
+        ///
+        callback_type callback_;
+    };
+
+private:
+    /**
+     *
+     */
+    static std::size_t
+    count_trailing_zeros
+        ( std::uint64_t value )
+    {
+        assert( value && "value must have a bit set" );
+
+#if defined( __GNUC__ )
+        return static_cast< std::size_t >( __builtin_ctzll( value ) );
+#else
+        std::size_t count = 0;
+        for ( ; ! ( value & 1 ); value >>= 1 )
+            ++ count;
+
+        return count;
+#endif
+    }
+
+    /**
+     *  Store n in the slot of the lowest level
+     *  where its expiration differs from now_.
+     */
+    void
+    place
+        ( node * n )
+    {
+        auto const differences = n->expiration_ ^ now_;
+
+        std::size_t level = 0;
+        while ( level != LEVELS_COUNT
+              && differences >> ( ( level + 1 ) * SLOT_BITS ) )
+            ++ level;
+
+        if ( level == LEVELS_COUNT )
+            link( n, overflow_ );
+        else
+        {
+            auto const index = ( n->expiration_ >> ( level * SLOT_BITS ) ) & SLOT_MASK;
+            link( n, slots_[ level ][ index ] );
+        }
+    }
+
+    /**
+     *
+     */
+    void
+    link
+        ( node * n
+        , slot & s )
+    {
+        n->owner_ = &s;
+        n->next_ = nullptr;
+        n->previous_ = s.last_;
+
+        if ( s.last_ )
+            s.last_->next_ = n;
+        else
+        {
+            s.first_ = n;
+            if ( s.level_ != LEVELS_COUNT )
+                occupied_slots_[ s.level_ ] |= std::uint64_t{ 1 } << s.index_;
+        }
+
+        s.last_ = n;
+    }
+
+    /**
+     *
+     */
+    void
+    unlink
+        ( node * n )
+    {
+        auto & s = *n->owner_;
+
+        if ( n->previous_ )
+            n->previous_->next_ = n->next_;
+        else
+            s.first_ = n->next_;
+
+        if ( n->next_ )
+            n->next_->previous_ = n->previous_;
+        else
+            s.last_ = n->previous_;
+
+        if ( ! s.first_ && s.level_ != LEVELS_COUNT )
+            occupied_slots_[ s.level_ ] &= ~( std::uint64_t{ 1 } << s.index_ );
+
+        n->owner_ = nullptr;
+    }
+
+    /**
+     *  Move all the nodes of from at the end of to,
+     *  the nodes owner isn't updated.
+     */
+    void
+    splice
+        ( slot & from
+        , slot & to )
+    {
+        if ( to.last_ )
+        {
+            to.last_->next_ = from.first_;
+            from.first_->previous_ = to.last_;
+        }
+        else
+            to.first_ = from.first_;
+
+        to.last_ = from.last_;
+
+        if ( from.level_ != LEVELS_COUNT )
+            occupied_slots_[ from.level_ ] &= ~( std::uint64_t{ 1 } << from.index_ );
+
+        from.first_ = from.last_ = nullptr;
+    }
+
+    /**
+     *
+     */
+    node *
+    acquire_node
+        ( void )
+    {
+        if ( ! free_nodes_ )
+        {
+            nodes_.push_back( node{ nullptr, nullptr, nullptr, 0, 0, {} } );
+            return &nodes_.back();
+        }
+
+        auto n = free_nodes_;
+        free_nodes_ = n->next_;
+
+        return n;
+    }
+
+    /**
+     *
+     */
+    void
+    release_node
+        ( node * n )
+    {
+        ++ n->generation_;
+        n->callback_ = nullptr;
+        n->next_ = free_nodes_;
+        free_nodes_ = n;
+    }
+
+private:
+    ///
+    tick_type now_;
+    ///
+    std::size_t size_;
+    ///
+    std::array< std::array< slot, SLOTS_COUNT >, LEVELS_COUNT > slots_;
+    /// One bit per non-empty slot.
+    std::array< std::uint64_t, LEVELS_COUNT > occupied_slots_;
+    /// Timeouts beyond the last level.
+    slot overflow_;
+    /// Timeouts whose callbacks are about to be executed.
+    slot expired_;
+    /// Owns all the nodes, either pending or free.
+    std::deque< node > nodes_;
+    ///
+    node * free_nodes_;
+};
+
+constexpr std::size_t timing_wheel::SLOT_BITS;
+constexpr std::size_t timing_wheel::SLOTS_COUNT;
+constexpr std::size_t timing_wheel::LEVELS_COUNT;
+constexpr timing_wheel::tick_type timing_wheel::SLOT_MASK;
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
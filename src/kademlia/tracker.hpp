@@ -30,12 +30,20 @@
 #   pragma once
 #endif
 
+#include <type_traits>
+#include <utility>
+
+#include <boost/asio/strand.hpp>
+
+#include "latency_histogram.hpp"
 #include "log.hpp"
 #include "message_serializer.hpp"
 #include "response_router.hpp"
 #include "network.hpp"
 #include "message.hpp"
+#include "peer.hpp"
 #include "routing_table.hpp"
+#include "timer.hpp"
 #include "value_store.hpp"
 #include "constants.hpp"
 
@@ -45,13 +53,18 @@ namespace detail {
 /**
  *
  */
-template< typename RandomEngineType, typename NetworkType >
+template< typename RandomEngineType
+        , typename NetworkType
+        , typename RoutingTableType >
 class tracker final
 {
 public:
     ///
     using network_type = NetworkType;
 
+    ///
+    using routing_table_type = RoutingTableType;
+
     ///
     using endpoint_type = typename network_type::endpoint_type;
 
@@ -63,14 +76,19 @@ public:
      *
      */
     tracker
-        ( boost::asio::io_service & io_service
+        ( boost::asio::io_service::strand const& strand
         , id const& my_id
         , network_type & network
-        , random_engine_type & random_engine )
-            : response_router_( io_service )
+        , random_engine_type & random_engine
+        , routing_table_type & routing_table )
+            : strand_( strand )
+            , response_router_( strand )
             , message_serializer_( my_id )
             , network_( network )
             , random_engine_( random_engine )
+            , routing_table_( routing_table )
+            , round_trip_times_()
+            , timer_( strand )
     { }
 
     /**
@@ -97,31 +115,99 @@ public:
         ( Request const& request
         , endpoint_type const& e
         , timer::duration const& timeout
-        , OnResponseReceived const& on_response_received
-        , OnError const& on_error )
+        , OnResponseReceived && on_response_received
+        , OnError && on_error )
     {
         id const response_id( random_engine_ );
         // Generate the request buffer.
         auto message = message_serializer_.serialize( request, response_id );
 
-        // This lamba will keep the request message alive.
-        auto on_request_sent = [ this, response_id
-                               , on_response_received, on_error
-                               , timeout ]
+        // The callback is registered before the request is sent
+        // as the response may be received before the send completion
+        // handler is executed.
+        response_router_.register_temporary_callback( response_id, timeout
+                , std::forward< OnResponseReceived >( on_response_received )
+                , std::forward< OnError >( on_error ) );
+
+        auto on_request_sent = [ this, response_id ]
             ( std::error_code const& failure )
         {
-            if ( failure )
-                on_error( failure );
-            else
-                response_router_.register_temporary_callback( response_id, timeout
-                                                            , on_response_received
-                                                            , on_error );
+            if ( ! failure )
+                return;
+
+            auto report_failure = [ this, response_id, failure ]
+                ( void )
+            { response_router_.fail_temporary_callback( response_id, failure ); };
+
+            strand_.dispatch( report_failure );
         };
 
         // Serialize the request and send it.
         network_.send( message, e, on_request_sent );
     }
 
+    /**
+     *  @brief Send a request to a peer whose timeout
+     *         is derived from the peer round trip time.
+     *
+     *  The round trip time of the request is measured
+     *  on response in order to refine the peer estimates
+     *  stored in the routing table, default_timeout being
+     *  used until the peer has answered once. A timeout
+     *  doubles the timeout of the next requests to the peer.
+     */
+    template< typename Request, typename OnResponseReceived, typename OnError >
+    void
+    send_request
+        ( Request const& request
+        , peer const& p
+        , timer::duration const& default_timeout
+        , OnResponseReceived && on_response_received
+        , OnError && on_error )
+    {
+        using on_response_received_type
+                = typename std::decay< OnResponseReceived >::type;
+        using on_error_type = typename std::decay< OnError >::type;
+
+        auto const timeout = routing_table_.request_timeout( p.id_
+                                                           , default_timeout );
+        auto const sent_at = timer::clock::now();
+
+        auto on_response = [ this, sent_at, peer_id = p.id_
+                           , on_response_received = on_response_received_type
+                                ( std::forward< OnResponseReceived >
+                                    ( on_response_received ) ) ]
+            ( endpoint_type const& s
+            , header const& h
+            , buffer::const_iterator i
+            , buffer::const_iterator e )
+        {
+            auto const rtt = timer::clock::now() - sent_at;
+            // A response from another peer doesn't tell
+            // anything about the round trip time of this one.
+            if ( h.source_id_ == peer_id )
+                routing_table_.record_round_trip_time( peer_id, rtt );
+            round_trip_times_.record( rtt );
+            on_response_received( s, h, i, e );
+        };
+
+        // Back off the timeout of the next requests to this peer,
+        // otherwise a peer slower than the timeout is never sampled.
+        auto on_failure = [ this, sent_at, peer_id = p.id_
+                          , on_error = on_error_type
+                                ( std::forward< OnError >( on_error ) ) ]
+            ( std::error_code const& failure )
+        {
+            if ( failure == std::errc::timed_out )
+                routing_table_.record_request_timeout( peer_id, sent_at );
+            on_error( failure );
+        };
+
+        send_request( request, p.endpoint_, timeout
+                    , std::move( on_response )
+                    , std::move( on_failure ) );
+    }
+
     /**
      *
      */
@@ -154,6 +240,44 @@ public:
         network_.send( message, e, on_response_sent );
     }
 
+    /**
+     *  @return The time past which the response of a peer is late,
+     *          derived from the peer round trip time if known,
+     *          otherwise the round trip time under which the
+     *          percentile of the recent requests have been answered,
+     *          zero if none has been answered yet.
+     */
+    timer::duration
+    request_soft_timeout
+        ( id const& peer_id
+        , double percentile )
+        const
+    {
+        auto const t = routing_table_.request_soft_timeout( peer_id );
+        if ( t != timer::duration::zero() )
+            return t;
+
+        return round_trip_times_.percentile( percentile );
+    }
+
+    /**
+     *  @brief Execute callback on the strand once timeout elapsed.
+     */
+    template< typename Callback >
+    timer::handle
+    expires_from_now
+        ( timer::duration const& timeout
+        , Callback && callback )
+    { return timer_.expires_from_now( timeout, std::forward< Callback >( callback ) ); }
+
+    /**
+     *  @brief Forget a timeout scheduled by expires_from_now().
+     */
+    bool
+    cancel
+        ( timer::handle const& timeout )
+    { return timer_.cancel( timeout ); }
+
     /**
      *
      */
@@ -166,6 +290,8 @@ public:
     { response_router_.handle_new_response( s, h, i, e ); }
 
 private:
+    ///
+    boost::asio::io_service::strand strand_;
     ///
     response_router response_router_;
     ///
@@ -174,6 +300,12 @@ private:
     network_type & network_;
     ///
     random_engine_type & random_engine_;
+    ///
+    routing_table_type & routing_table_;
+    /// Round trip times of the requests sent to peers.
+    latency_histogram round_trip_times_;
+    /// Schedules the deadlines of the tasks.
+    timer timer_;
 };
 
 } // namespace detail
@@ -0,0 +1,374 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_TREE_ROUTING_TABLE_HPP
+#define KADEMLIA_TREE_ROUTING_TABLE_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "basic_routing_table.hpp"
+#include "id.hpp"
+#include "k_bucket.hpp"
+#include "log.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  This class keeps track of peers and find the known peer closed to an id.
+ *  @note This implementation is the binary tree of the paper:
+ *        it starts with a single k_bucket and splits the one
+ *        covering our own id when it overflows. As only this
+ *        branch is split, the tree is stored as its spine, i.e.
+ *        the k_bucket at index i < depth contains the peers
+ *        sharing exactly i leading bits with our id while the
+ *        deepest one (the leaf) contains the remaining ones.
+ *  @note It has the same interface than routing_table.
+ */
+template< typename PeerType >
+class tree_routing_table final
+    : public basic_routing_table< tree_routing_table< PeerType >, PeerType >
+{
+    ///
+    using base_type = basic_routing_table< tree_routing_table, PeerType >;
+
+    friend base_type;
+
+public:
+    ///
+    using peer_type = typename base_type::peer_type;
+
+    ///
+    using value_type = typename base_type::value_type;
+
+    ///
+    using reference = typename base_type::reference;
+
+    ///
+    using clock = typename base_type::clock;
+
+    class iterator;
+
+public:
+    /**
+     *  Construct the tree_routing_table implementation.
+     */
+    tree_routing_table
+        ( id const& my_id
+        , std::size_t k_bucket_size = base_type::DEFAULT_K_BUCKET_SIZE )
+            : base_type( my_id, k_bucket_size )
+    {
+        // The root k_bucket covers the whole id space.
+        k_buckets_.emplace_back( k_bucket_size_, clock::now() );
+    }
+
+    /**
+     *  Generate a random id covered by a k_bucket,
+     *  i.e. sharing index leading bits with our id,
+     *  and at least as many for the leaf.
+     */
+    id
+    random_id_in_k_bucket
+        ( std::size_t index
+        , std::default_random_engine & random_engine )
+        const
+    {
+        assert( index < k_buckets_.size() && "unknown k_bucket" );
+
+        id random_id{ random_engine };
+        for ( std::size_t i = 0; i != index; ++ i )
+            random_id[ i ] = bool( my_id_[ i ] );
+
+        if ( index != k_buckets_.size() - 1 )
+            random_id[ index ] = ! my_id_[ index ];
+
+        return random_id;
+    }
+
+    /**
+     *  Find closest peers to an id.
+     *  @return An iterator to the closest peer from the id to the far.
+     *  @note Complexity: O(1)
+     */
+    iterator
+    find
+        ( id const& id_to_find )
+    {
+        LOG_DEBUG( routing_table, this ) << "finding peer near '"
+                << id_to_find << "'." << std::endl;
+
+        return iterator( &k_buckets_, find_k_bucket_index( id_to_find ) );
+    }
+
+    /**
+     *  @return An iterator to the end of the routing table.
+     */
+    iterator
+    end
+        ( void )
+    { return iterator( &k_buckets_ ); }
+
+private:
+    /// Contains all the k_bucket, from the root to the leaf.
+    using k_buckets = typename base_type::k_buckets;
+
+private:
+    using base_type::k_buckets_;
+    using base_type::my_id_;
+    using base_type::k_bucket_size_;
+
+    /**
+     *
+     */
+    std::size_t
+    find_k_bucket_index
+        ( id const& id_to_find )
+        const
+    {
+        // Peers sharing more leading bits with our id
+        // than the depth of the leaf are within the leaf.
+        auto const bit_index = std::min( common_prefix_length( id_to_find
+                                                             , my_id_ )
+                                       , k_buckets_.size() - 1 );
+
+        LOG_DEBUG( routing_table, this ) << "found bucket at index '"
+                << bit_index << "'." << std::endl;
+
+        return bit_index;
+    }
+
+    /**
+     *
+     */
+    bool
+    is_k_bucket_full
+        ( std::size_t index )
+        const
+    {
+        return k_buckets_[ index ].size() >= k_bucket_size_
+                && ! is_splittable( index );
+    }
+
+    /**
+     *  @brief Split the leaf if it is full.
+     *  @return true if it has been split.
+     */
+    bool
+    split_k_bucket
+        ( std::size_t index )
+    {
+        if ( k_buckets_[ index ].size() < k_bucket_size_
+           || ! is_splittable( index ) )
+            return false;
+
+        split_leaf();
+
+        return true;
+    }
+
+    /**
+     *  @return The count of k_buckets, from the root to the leaf.
+     */
+    std::size_t
+    refreshable_k_buckets_count
+        ( void )
+        const
+    { return k_buckets_.size(); }
+
+    /**
+     *  @note Only the leaf covers our own id, hence
+     *        the other k_buckets are never split.
+     */
+    bool
+    is_splittable
+        ( std::size_t index )
+        const
+    {
+        return index == k_buckets_.size() - 1
+                && k_buckets_.size() < id::BIT_SIZE;
+    }
+
+    /**
+     *  @brief Move the leaf peers sharing more leading bits
+     *         with our id than its depth into a new leaf.
+     */
+    void
+    split_leaf
+        ( void )
+    {
+        auto const depth = k_buckets_.size() - 1;
+
+        LOG_DEBUG( routing_table, this ) << "splitting bucket at index '"
+                << depth << "'." << std::endl;
+
+        k_buckets_.emplace_back( k_bucket_size_
+                               , k_buckets_[ depth ].last_lookup() );
+
+        auto const is_deeper = [ this, depth ]( id const& peer_id )
+                               { return common_prefix_length( peer_id, my_id_ )
+                                      > depth; };
+        k_buckets_[ depth ].split( k_buckets_.back(), is_deeper );
+    }
+};
+
+/**
+ *  Visit the k_bucket of the searched id, then the deeper
+ *  ones as they share as many leading bits with it, and
+ *  finally the shallower ones, from the closest to the far.
+ */
+template< typename PeerType >
+class tree_routing_table< PeerType >::iterator
+    : public boost::iterator_facade
+        < iterator
+        , typename tree_routing_table::value_type
+        , boost::single_pass_traversal_tag
+        , typename tree_routing_table::reference >
+{
+public:
+    /**
+     *  Construct an iterator to the end of the k_buckets.
+     */
+    explicit
+    iterator
+        ( k_buckets * buckets )
+        : k_buckets_( buckets )
+        , first_k_bucket_( 0 )
+        , current_k_bucket_( buckets->size() )
+        , current_entry_( 0 )
+    { }
+
+    /**
+     *
+     */
+    iterator
+        ( k_buckets * buckets
+        , std::size_t first_bucket )
+        : k_buckets_( buckets )
+        , first_k_bucket_( first_bucket )
+        , current_k_bucket_( first_bucket )
+        , current_entry_( 0 )
+    { skip_empty_k_buckets(); }
+
+private:
+    friend class boost::iterator_core_access;
+
+    /**
+     *
+     */
+    void
+    increment
+        ( void )
+    {
+        ++ current_entry_;
+
+        // If the current entry is not at the end of the bucket
+        // then there is nothing more to do.
+        if ( current_entry_ != ( *k_buckets_ )[ current_k_bucket_ ].size() )
+            return;
+
+        current_k_bucket_ = next_k_bucket( current_k_bucket_ );
+        current_entry_ = 0;
+        skip_empty_k_buckets();
+    }
+
+    /**
+     *
+     */
+    void
+    skip_empty_k_buckets
+        ( void )
+    {
+        while ( current_k_bucket_ != k_buckets_->size()
+              && ( *k_buckets_ )[ current_k_bucket_ ].empty() )
+            current_k_bucket_ = next_k_bucket( current_k_bucket_ );
+    }
+
+    /**
+     *  @return The index of the k_bucket following index
+     *          or k_buckets_->size() once they all are visited.
+     */
+    std::size_t
+    next_k_bucket
+        ( std::size_t index )
+        const
+    {
+        if ( index >= first_k_bucket_ )
+        {
+            if ( index + 1 != k_buckets_->size() )
+                return index + 1;
+
+            index = first_k_bucket_;
+        }
+
+        return index == 0 ? k_buckets_->size() : index - 1;
+    }
+
+    /**
+     *
+     */
+    bool
+    equal
+        ( iterator const& o )
+        const
+    {
+        return k_buckets_ == o.k_buckets_
+                && current_k_bucket_ == o.current_k_bucket_
+                && current_entry_ == o.current_entry_;
+    }
+
+    /**
+     *
+     */
+    typename tree_routing_table::reference
+    dereference
+        ( void )
+        const
+    { return ( *k_buckets_ )[ current_k_bucket_ ][ current_entry_ ]; }
+
+private:
+    ///
+    k_buckets * k_buckets_;
+    ///
+    std::size_t first_k_bucket_;
+    ///
+    std::size_t current_k_bucket_;
+    ///
+    std::size_t current_entry_;
+};
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
+
@@ -30,9 +30,18 @@
 #   pragma once
 #endif
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
 #include <unordered_map>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include <boost/functional/hash.hpp>
 
@@ -59,6 +68,371 @@ using value_store = std::unordered_map
         , Value
         , value_store_key_hasher< Key > >;
 
+/**
+ *  @return The memory held by value, accounted
+ *          against the value store budget.
+ */
+template< typename Value >
+inline std::size_t
+held_bytes_count
+    ( Value const& value )
+{ return value.size(); }
+
+/**
+ *  @brief Value store counters.
+ */
+struct value_store_statistics final
+{
+    /// Count of values currently stored.
+    std::size_t values_count_;
+    /// Count of bytes held by the stored values.
+    std::size_t held_bytes_count_;
+    /// Count of values removed to honor the memory budget.
+    std::size_t evicted_values_count_;
+    /// Count of values not stored as they exceed the memory budget.
+    std::size_t rejected_values_count_;
+    /// Count of values removed once their lifetime elapsed.
+    std::size_t expired_values_count_;
+};
+
+/**
+ *  @brief This class splits a value store into shards
+ *         selected by the key prefix.
+ *
+ *  Each shard has its own lock, hence values whose keys
+ *  belong to different shards can be accessed concurrently.
+ *
+ *  Each value expires at the time provided when it has been
+ *  stored. The bytes held by the values of all the shards are
+ *  bounded by a single budget: once it is exceeded, the least
+ *  recently used values of the shard a value has been stored in
+ *  are evicted, then the ones of the other shards if needed.
+ *
+ *  Each value also has a republication time, postponed each time
+ *  the value is stored again or collected for republication.
+ */
+template< typename Key, typename Value >
+class sharded_value_store final
+{
+public:
+    /// Keys are selected using their first byte.
+    static constexpr std::size_t SHARDS_COUNT = 16;
+
+    ///
+    using clock = std::chrono::steady_clock;
+
+    ///
+    using time_point = clock::time_point;
+
+public:
+    /**
+     *
+     */
+    explicit
+    sharded_value_store
+        ( std::size_t max_held_bytes_count )
+            : max_held_bytes_count_{ max_held_bytes_count }
+            , held_bytes_count_{ 0 }
+            , shards_()
+    { }
+
+    /**
+     *
+     */
+    sharded_value_store
+        ( sharded_value_store const& )
+        = delete;
+
+    /**
+     *
+     */
+    sharded_value_store &
+    operator=
+        ( sharded_value_store const& )
+        = delete;
+
+    /**
+     *  @brief Store value until expiration_time, replacing any
+     *         value previously associated with key.
+     *  @return false if value alone exceeds the budget, in which
+     *          case it isn't stored and the previous value is kept.
+     */
+    bool
+    insert_or_assign
+        ( Key const& key
+        , Value && value
+        , time_point const& expiration_time
+        , time_point const& republication_time )
+    {
+        auto & s = get_shard( key );
+        auto const size = held_bytes_count( value );
+
+        {
+            std::lock_guard< std::mutex > const lock{ s.mutex_ };
+
+            if ( size > max_held_bytes_count_ )
+            {
+                ++ s.rejected_values_count_;
+                return false;
+            }
+
+            auto found = s.index_.find( key );
+            if ( found != s.index_.end() )
+                erase( s, found->second );
+
+            // Least recently used values are at the front.
+            s.entries_.push_back( { key, std::move( value )
+                                  , expiration_time, republication_time } );
+            s.index_.emplace( key, std::prev( s.entries_.end() ) );
+            s.held_bytes_count_ += size;
+            held_bytes_count_ += size;
+
+            // The new value is the last one evicted from its shard.
+            while ( held_bytes_count_ > max_held_bytes_count_
+                  && s.entries_.size() > 1 )
+                evict_least_recently_used( s );
+        }
+
+        // Shards are locked one at a time, hence
+        // concurrent insertions can't deadlock.
+        for ( auto & other : shards_ )
+        {
+            if ( held_bytes_count_ <= max_held_bytes_count_ )
+                break;
+
+            if ( &other == &s )
+                continue;
+
+            std::lock_guard< std::mutex > const lock{ other.mutex_ };
+            while ( held_bytes_count_ > max_held_bytes_count_
+                  && ! other.entries_.empty() )
+                evict_least_recently_used( other );
+        }
+
+        return true;
+    }
+
+    /**
+     *  @brief Copy the value associated with key into value.
+     *  @return true if the value has been found and hasn't expired.
+     */
+    bool
+    find
+        ( Key const& key
+        , Value & value
+        , time_point const& now )
+    {
+        auto & s = get_shard( key );
+
+        std::lock_guard< std::mutex > const lock{ s.mutex_ };
+        auto found = s.index_.find( key );
+        if ( found == s.index_.end() )
+            return false;
+
+        auto entry = found->second;
+        if ( entry->expiration_time_ <= now )
+        {
+            erase( s, entry );
+            ++ s.expired_values_count_;
+            return false;
+        }
+
+        // Mark the value as the most recently used.
+        s.entries_.splice( s.entries_.end(), s.entries_, entry );
+
+        value = entry->value_;
+        return true;
+    }
+
+    /**
+     *  @brief Remove the values expired at now.
+     *  @return The count of removed values.
+     */
+    std::size_t
+    remove_expired
+        ( time_point const& now )
+    {
+        std::size_t removed_count = 0;
+
+        for ( auto & s : shards_ )
+        {
+            std::lock_guard< std::mutex > const lock{ s.mutex_ };
+
+            for ( auto i = s.entries_.begin(); i != s.entries_.end(); )
+            {
+                auto const current = i ++;
+                if ( current->expiration_time_ > now )
+                    continue;
+
+                erase( s, current );
+                ++ s.expired_values_count_;
+                ++ removed_count;
+            }
+        }
+
+        return removed_count;
+    }
+
+    /**
+     *  @brief Copy up to max_count values whose republication time
+     *         elapsed at now into out as (key, value, expiration time)
+     *         tuples and postpone their republication to
+     *         next_republication_time.
+     *  @return The count of copied values.
+     */
+    template< typename OutputIterator >
+    std::size_t
+    collect_values_to_republish
+        ( time_point const& now
+        , time_point const& next_republication_time
+        , std::size_t max_count
+        , OutputIterator out )
+    {
+        std::size_t collected_count = 0;
+
+        for ( auto & s : shards_ )
+        {
+            std::lock_guard< std::mutex > const lock{ s.mutex_ };
+
+            for ( auto & e : s.entries_ )
+            {
+                if ( collected_count == max_count )
+                    return collected_count;
+
+                if ( e.republication_time_ > now || e.expiration_time_ <= now )
+                    continue;
+
+                e.republication_time_ = next_republication_time;
+                *out ++ = std::make_tuple( e.key_, e.value_, e.expiration_time_ );
+                ++ collected_count;
+            }
+        }
+
+        return collected_count;
+    }
+
+    /**
+     *
+     */
+    value_store_statistics
+    statistics
+        ( void )
+        const
+    {
+        value_store_statistics total{ 0, 0, 0, 0, 0 };
+
+        for ( auto & s : shards_ )
+        {
+            std::lock_guard< std::mutex > const lock{ s.mutex_ };
+            total.values_count_ += s.entries_.size();
+            total.held_bytes_count_ += s.held_bytes_count_;
+            total.evicted_values_count_ += s.evicted_values_count_;
+            total.rejected_values_count_ += s.rejected_values_count_;
+            total.expired_values_count_ += s.expired_values_count_;
+        }
+
+        return total;
+    }
+
+private:
+    ///
+    struct entry final
+    {
+        ///
+        Key key_;
+        ///
+        Value value_;
+        ///
+        time_point expiration_time_;
+        ///
+        time_point republication_time_;
+    };
+
+    ///
+    using entries = std::list< entry >;
+
+    ///
+    struct shard final
+    {
+        ///
+        shard
+            ( void )
+                : mutex_{}
+                , entries_{}
+                , index_{}
+                , held_bytes_count_{ 0 }
+                , evicted_values_count_{ 0 }
+                , rejected_values_count_{ 0 }
+                , expired_values_count_{ 0 }
+        { }
+
+        ///
+        mutable std::mutex mutex_;
+        /// Sorted from the least to the most recently used.
+        entries entries_;
+        ///
+        value_store< Key, typename entries::iterator > index_;
+        ///
+        std::size_t held_bytes_count_;
+        ///
+        std::size_t evicted_values_count_;
+        ///
+        std::size_t rejected_values_count_;
+        ///
+        std::size_t expired_values_count_;
+    };
+
+private:
+    /**
+     *  @note The shard must be locked.
+     */
+    void
+    erase
+        ( shard & s
+        , typename entries::iterator e )
+    {
+        auto const size = held_bytes_count( e->value_ );
+        s.held_bytes_count_ -= size;
+        held_bytes_count_ -= size;
+
+        s.index_.erase( e->key_ );
+        s.entries_.erase( e );
+    }
+
+    /**
+     *  @note The shard must be locked.
+     */
+    void
+    evict_least_recently_used
+        ( shard & s )
+    {
+        erase( s, s.entries_.begin() );
+        ++ s.evicted_values_count_;
+    }
+
+    /**
+     *
+     */
+    shard &
+    get_shard
+        ( Key const& key )
+    {
+        auto const prefix = std::size_t{ *key.begin() };
+        return shards_[ prefix * SHARDS_COUNT / 256 ];
+    }
+
+private:
+    ///
+    std::size_t max_held_bytes_count_;
+    /// Bytes held by the values of all the shards.
+    std::atomic< std::size_t > held_bytes_count_;
+    ///
+    std::array< shard, SHARDS_COUNT > shards_;
+};
+
+template< typename Key, typename Value >
+constexpr std::size_t sharded_value_store< Key, Value >::SHARDS_COUNT;
+
 } // namespace detail
 } // namespace kademlia
 
@@ -0,0 +1,101 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_BENCHMARK_HPP
+#define KADEMLIA_BENCHMARK_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace kademlia {
+namespace benchmark {
+
+/**
+ *  @brief Prevent the compiler from discarding value computation.
+ */
+template< typename ValueType >
+inline void
+do_not_optimize
+    ( ValueType const& value )
+{
+#if defined( __GNUC__ )
+    asm volatile( "" : : "r,m"( value ) : "memory" );
+#else
+    static void const* volatile sink;
+    sink = &value;
+#endif
+}
+
+/**
+ *  @brief Execute callable iterations_count times.
+ *  @return The mean duration of one iteration in nanoseconds.
+ */
+template< typename Callable >
+inline double
+measure
+    ( std::size_t iterations_count
+    , Callable && callable )
+{
+    using clock = std::chrono::steady_clock;
+
+    auto const start = clock::now();
+    for ( std::size_t i = 0; i != iterations_count; ++ i )
+        callable( i );
+    auto const elapsed = clock::now() - start;
+
+    using nanoseconds = std::chrono::duration< double, std::nano >;
+    return nanoseconds{ elapsed }.count() / iterations_count;
+}
+
+/**
+ *
+ */
+inline void
+report
+    ( std::string const& name
+    , double value
+    , std::string const& unit = "ns/op" )
+{
+    auto const previous_flags = std::cout.flags();
+
+    std::cout << std::left << std::setw( 56 ) << name
+              << std::right << std::setw( 14 )
+              << std::fixed << std::setprecision( 2 ) << value
+              << ' ' << unit << std::endl;
+
+    std::cout.flags( previous_flags );
+}
+
+} // namespace benchmark
+} // namespace kademlia
+
+#endif
@@ -0,0 +1,154 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <system_error>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+
+#include <kademlia/endpoint.hpp>
+
+#include "buffer_pool.hpp"
+#include "message_socket.hpp"
+#ifdef __linux__
+#   include "batched_udp_socket.hpp"
+#endif
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+/**
+ *  Send datagrams_count datagrams of datagram_size bytes on the
+ *  loopback by bursts of burst_size, the next burst being sent
+ *  once the previous one has been received.
+ *  @return The received datagrams count per second.
+ */
+template< typename UnderlyingSocketType >
+double
+measure_burst_throughput
+    ( std::size_t datagram_size
+    , std::size_t burst_size
+    , std::size_t datagrams_count )
+{
+    using socket_type = kd::message_socket< UnderlyingSocketType >;
+
+    boost::asio::io_service io_service;
+    k::endpoint const loopback{ "127.0.0.1", 0 };
+    auto receiver = socket_type::ipv4( io_service, loopback );
+    auto sender = socket_type::ipv4( io_service, loopback );
+    auto const destination = receiver.local_endpoint();
+
+    auto const message = kd::shared_buffer::allocate( datagram_size );
+    auto on_sent = [] ( std::error_code const& failure )
+    {
+        if ( failure )
+            throw std::system_error{ failure };
+    };
+
+    auto send_burst = [ & ] ( void )
+    {
+        for ( std::size_t i = 0; i != burst_size; ++ i )
+            sender.async_send( message, destination, on_sent );
+    };
+
+    std::size_t received_count = 0;
+    std::function< void ( std::size_t ) > receive;
+    receive = [ & ] ( std::size_t reception_index )
+    {
+        receiver.async_receive( reception_index, [ &, reception_index ]
+            ( std::error_code const& failure
+            , typename socket_type::endpoint_type const&
+            , kd::shared_buffer const&
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+        {
+            if ( failure )
+                throw std::system_error{ failure };
+
+            ++ received_count;
+            // The other receptions are still armed.
+            if ( received_count == datagrams_count )
+                return io_service.stop();
+
+            receive( reception_index );
+            if ( received_count % burst_size == 0 )
+                send_burst();
+        } );
+    };
+
+    using clock = std::chrono::steady_clock;
+    auto const start = clock::now();
+
+    // As network does.
+    for ( std::size_t i = 0; i != socket_type::RECEPTIONS_COUNT; ++ i )
+        receive( i );
+    send_burst();
+    io_service.run();
+
+    std::chrono::duration< double > const elapsed = clock::now() - start;
+    return received_count / elapsed.count();
+}
+
+/**
+ *
+ */
+template< typename UnderlyingSocketType >
+void
+report_burst_throughput
+    ( std::string const& name
+    , std::size_t burst_size )
+{
+    kb::report( name + ", bursts of " + std::to_string( burst_size )
+              , measure_burst_throughput< UnderlyingSocketType >
+                    ( 256, burst_size, 200000 )
+              , "datagram/s" );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    for ( std::size_t burst_size : { 1, 16, 64 } )
+    {
+        report_burst_throughput< boost::asio::ip::udp::socket >
+                ( "asio udp::socket", burst_size );
+#ifdef __linux__
+        report_burst_throughput< kd::batched_udp_socket >
+                ( "batched_udp_socket", burst_size );
+#endif
+    }
+}
@@ -0,0 +1,470 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <kademlia/endpoint.hpp>
+
+#include "engine.hpp"
+#include "message.hpp"
+#include "message_serializer.hpp"
+
+#include "fake_socket.hpp"
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kt = k::test;
+namespace kb = k::benchmark;
+
+using engine_type = kd::engine< kt::fake_socket >;
+
+/**
+ *  Requests shared by a set of clients.
+ */
+struct traffic final
+{
+    ///
+    std::atomic< std::ptrdiff_t > requests_left_;
+    ///
+    std::atomic< std::ptrdiff_t > responses_left_;
+    /// Called once the last response has been received.
+    std::function< void ( void ) > on_completion_;
+};
+
+/**
+ *  Peer sending the same request again each time
+ *  the previous one has been answered.
+ */
+class client final
+{
+public:
+    client
+        ( boost::asio::io_service & io_service
+        , kt::fake_socket::endpoint_type const& server
+        , traffic & t )
+            : socket_{ io_service, kt::fake_socket::protocol_type::v4() }
+            , server_{ server }
+            , traffic_( t )
+            , id_{ random_engine() }
+            , request_{}
+            , response_( kd::message_socket< kt::fake_socket >::INPUT_BUFFER_SIZE )
+            , sender_{}
+    {
+        socket_.bind( kt::fake_socket::endpoint_type{ server.address()
+                                                    , kt::fake_socket::FIXED_PORT } );
+        receive();
+    }
+
+    void
+    set_request
+        ( kd::buffer const& request )
+    { request_ = request; }
+
+    kd::id const&
+    get_id
+        ( void )
+        const
+    { return id_; }
+
+    void
+    send
+        ( void )
+    {
+        auto on_sent = []
+            ( boost::system::error_code const&, std::size_t )
+        { };
+
+        socket_.async_send_to( boost::asio::buffer( request_ ), server_, on_sent );
+    }
+
+private:
+    static std::default_random_engine &
+    random_engine
+        ( void )
+    {
+        static std::default_random_engine engine;
+        return engine;
+    }
+
+    void
+    receive
+        ( void )
+    {
+        auto on_received = [ this ]
+            ( boost::system::error_code const&, std::size_t )
+        {
+            receive();
+
+            if ( -- traffic_.requests_left_ >= 0 )
+                send();
+
+            if ( -- traffic_.responses_left_ == 0 )
+                traffic_.on_completion_();
+        };
+
+        socket_.async_receive_from( boost::asio::buffer( response_ )
+                                  , sender_
+                                  , on_received );
+    }
+
+private:
+    kt::fake_socket socket_;
+    kt::fake_socket::endpoint_type server_;
+    traffic & traffic_;
+    kd::id id_;
+    kd::buffer request_;
+    kd::buffer response_;
+    kt::fake_socket::endpoint_type sender_;
+};
+
+/**
+ *
+ */
+void
+discard_logged_packets
+    ( void )
+{
+    auto & packets = kt::fake_socket::get_logged_packets();
+    while ( ! packets.empty() )
+        packets.pop();
+}
+
+/**
+ *  Run io_service from threads_count threads until it's stopped.
+ *  @return The elapsed time in seconds.
+ */
+double
+run
+    ( boost::asio::io_service & io_service
+    , std::size_t threads_count )
+{
+    using clock = std::chrono::steady_clock;
+
+    auto const start = clock::now();
+
+    std::vector< std::thread > threads;
+    for ( std::size_t i = 1; i < threads_count; ++ i )
+        threads.emplace_back( [ &io_service ] { io_service.run(); } );
+
+    io_service.run();
+
+    for ( auto & t : threads )
+        t.join();
+
+    io_service.reset();
+
+    using seconds = std::chrono::duration< double >;
+    return seconds{ clock::now() - start }.count();
+}
+
+/**
+ *  Measure how many FIND_VALUE_REQUEST an engine answers per second
+ *  when its io_service is run from threads_count threads.
+ */
+void
+measure_find_value_throughput
+    ( std::size_t clients_count
+    , std::size_t keys_count
+    , std::size_t value_size
+    , std::size_t requests_count
+    , std::vector< std::size_t > const& threads_counts )
+{
+    boost::asio::io_service io_service;
+
+    engine_type server{ io_service
+                      , k::endpoint{ "127.0.0.1", kt::fake_socket::FIXED_PORT }
+                      , k::endpoint{ "::1", kt::fake_socket::FIXED_PORT } };
+
+    kt::fake_socket::endpoint_type const server_endpoint
+            { kt::fake_socket::get_last_allocated_ipv4()
+            , kt::fake_socket::FIXED_PORT };
+
+    // The engine timers keep the io_service busy.
+    traffic t{ {}, {}, [ &io_service ] { io_service.stop(); } };
+    std::vector< std::unique_ptr< client > > clients;
+    for ( std::size_t i = 0; i != clients_count; ++ i )
+        clients.emplace_back( new client{ io_service
+                                        , server_endpoint
+                                        , t } );
+
+    // Store the values the clients will look for.
+    std::vector< kd::id > keys;
+    for ( std::size_t i = 0; i != keys_count; ++ i )
+    {
+        auto const key = "key-" + std::to_string( i );
+        keys.emplace_back( kd::id::value_to_hash_type{ key.begin(), key.end() } );
+
+        kd::store_value_request_body const request
+                { keys.back(), kd::buffer( value_size, 0x5a )
+                , std::chrono::hours{ 24 } };
+        auto & c = *clients[ i % clients_count ];
+        kd::message_serializer serializer{ c.get_id() };
+        c.set_request( *serializer.serialize( request, kd::id{} ) );
+        c.send();
+        while ( io_service.poll() )
+            continue;
+    }
+
+    for ( std::size_t i = 0; i != clients_count; ++ i )
+    {
+        kd::find_value_request_body const request{ keys[ i % keys_count ] };
+        kd::message_serializer serializer{ clients[ i ]->get_id() };
+        clients[ i ]->set_request( *serializer.serialize( request, kd::id{} ) );
+    }
+
+    for ( auto threads_count : threads_counts )
+    {
+        t.requests_left_ = std::ptrdiff_t( requests_count - clients_count );
+        t.responses_left_ = std::ptrdiff_t( requests_count );
+        for ( auto & c : clients )
+            c->send();
+
+        auto const elapsed = run( io_service, threads_count );
+
+        discard_logged_packets();
+
+        kb::report( "FIND_VALUE_REQUEST, " + std::to_string( threads_count )
+                  + " thread(s)"
+                  , requests_count / elapsed
+                  , "req/s" );
+    }
+}
+
+/**
+ *  Flood an engine with PING_REQUEST and measure how many handlers
+ *  per second run_loop( io_service, is_done ) dispatches.
+ */
+template< typename RunLoop >
+void
+measure_ping_flood_dispatch_rate
+    ( std::string const& name
+    , std::size_t clients_count
+    , std::size_t requests_count
+    , RunLoop run_loop )
+{
+    boost::asio::io_service io_service;
+
+    engine_type server{ io_service
+                      , k::endpoint{ "127.0.0.1", kt::fake_socket::FIXED_PORT }
+                      , k::endpoint{ "::1", kt::fake_socket::FIXED_PORT } };
+
+    kt::fake_socket::endpoint_type const server_endpoint
+            { kt::fake_socket::get_last_allocated_ipv4()
+            , kt::fake_socket::FIXED_PORT };
+
+    std::atomic< bool > is_done{ false };
+    traffic t{ { std::ptrdiff_t( requests_count - clients_count ) }
+             , { std::ptrdiff_t( requests_count ) }
+             , [ &is_done, &io_service ]
+               {
+                   is_done = true;
+                   io_service.stop();
+               } };
+
+    std::vector< std::unique_ptr< client > > clients;
+    for ( std::size_t i = 0; i != clients_count; ++ i )
+    {
+        clients.emplace_back( new client{ io_service, server_endpoint, t } );
+
+        kd::message_serializer serializer{ clients.back()->get_id() };
+        clients.back()->set_request
+                ( *serializer.serialize( kd::header::PING_REQUEST, kd::id{} ) );
+        clients.back()->send();
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto const start = clock::now();
+
+    auto const handlers_count = run_loop( io_service, is_done );
+
+    using seconds = std::chrono::duration< double >;
+    auto const elapsed = seconds{ clock::now() - start }.count();
+
+    discard_logged_packets();
+
+    kb::report( name, handlers_count / elapsed, "handler/s" );
+}
+
+/**
+ *  Former session loop, checking an abort flag after each handler.
+ */
+std::size_t
+run_one_and_poll
+    ( boost::asio::io_service & io_service
+    , std::atomic< bool > const& is_done )
+{
+    std::size_t handlers_count = 0;
+
+    while ( ! is_done )
+    {
+        handlers_count += io_service.run_one();
+        handlers_count += io_service.poll();
+    }
+
+    return handlers_count;
+}
+
+/**
+ *  Current session loop, io_service is stopped once the flood is over.
+ */
+std::size_t
+run_until_stopped
+    ( boost::asio::io_service & io_service
+    , std::atomic< bool > const& /* is_done */ )
+{
+    boost::asio::io_service::work work{ io_service };
+
+    return io_service.run();
+}
+
+/**
+ *  Embedding loop executing at most 64 handlers per iteration.
+ */
+std::size_t
+poll_bounded
+    ( boost::asio::io_service & io_service
+    , std::atomic< bool > const& is_done )
+{
+    std::size_t handlers_count = 0;
+
+    while ( ! is_done )
+        for ( std::size_t i = 0; i != 64 && io_service.poll_one(); ++ i )
+            ++ handlers_count;
+
+    return handlers_count;
+}
+
+/**
+ *  Measure how many values of value_size bytes an engine
+ *  loads per second from another engine.
+ */
+void
+measure_load_throughput
+    ( std::size_t value_size
+    , std::size_t loads_count )
+{
+    boost::asio::io_service io_service;
+
+    engine_type server{ io_service
+                      , k::endpoint{ "127.0.0.1", kt::fake_socket::FIXED_PORT }
+                      , k::endpoint{ "::1", kt::fake_socket::FIXED_PORT } };
+
+    k::endpoint const server_endpoint
+            { kt::fake_socket::get_last_allocated_ipv4().to_string()
+            , kt::fake_socket::FIXED_PORT };
+
+    engine_type client{ io_service
+                      , server_endpoint
+                      , k::endpoint{ "127.0.0.1", kt::fake_socket::FIXED_PORT }
+                      , k::endpoint{ "::1", kt::fake_socket::FIXED_PORT } };
+
+    engine_type::key_type const key{ 'k', 'e', 'y' };
+    engine_type::data_type const value( value_size, 0x5a );
+
+    bool is_saved = false;
+    auto on_save = [ &is_saved ] ( std::error_code const& failure )
+    {
+        if ( failure )
+            throw std::system_error{ failure };
+        is_saved = true;
+    };
+
+    client.async_save( key, value, on_save );
+    while ( ! is_saved )
+        io_service.run_one();
+    // Let the server handle the store request.
+    io_service.poll();
+
+    std::size_t loads_left = loads_count;
+    std::function< void ( std::error_code const&
+                        , engine_type::data_type const& ) > on_load;
+    on_load = [ & ]
+        ( std::error_code const& failure
+        , engine_type::data_type const& data )
+    {
+        if ( failure || data.size() != value_size )
+            throw std::runtime_error{ "unexpected value" };
+
+        if ( loads_left % 256 == 0 )
+            discard_logged_packets();
+
+        if ( -- loads_left )
+            client.async_load( key, on_load );
+    };
+
+    using clock = std::chrono::steady_clock;
+    auto const start = clock::now();
+
+    client.async_load( key, on_load );
+    while ( loads_left )
+        io_service.run_one();
+
+    using seconds = std::chrono::duration< double >;
+    auto const elapsed = seconds{ clock::now() - start }.count();
+
+    discard_logged_packets();
+
+    kb::report( "async_load, " + std::to_string( value_size / 1024 )
+              + " KiB values"
+              , loads_count / elapsed
+              , "load/s" );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    measure_ping_flood_dispatch_rate( "ping flood, run_one() + poll() loop"
+                                    , 64, 500000, &run_one_and_poll );
+    measure_ping_flood_dispatch_rate( "ping flood, run() until stop()"
+                                    , 64, 500000, &run_until_stopped );
+    measure_ping_flood_dispatch_rate( "ping flood, poll_one() x 64 per iteration"
+                                    , 64, 500000, &poll_bounded );
+
+    measure_find_value_throughput( 64, 256, 1024, 200000
+                                 , { 1, 2, 4, 8 } );
+
+    measure_load_throughput( 1024, 20000 );
+    measure_load_throughput( 48 * 1024, 20000 );
+}
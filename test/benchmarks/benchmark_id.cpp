@@ -0,0 +1,189 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "id.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+/**
+ *  Byte-wise implementations used before ids were stored as words.
+ */
+kd::id
+legacy_distance
+    ( kd::id const& a
+    , kd::id const& b )
+{
+    kd::id result;
+
+    std::transform( a.begin(), a.end(), b.begin()
+                  , result.begin()
+                  , std::bit_xor< kd::id::block_type >{} );
+
+    return result;
+}
+
+bool
+legacy_less
+    ( kd::id const& a
+    , kd::id const& b )
+{
+    return std::lexicographical_compare( a.begin(), a.end()
+                                       , b.begin(), b.end() );
+}
+
+std::size_t
+legacy_common_prefix_length
+    ( kd::id const& a
+    , kd::id const& b )
+{
+    std::size_t bit_index = 0;
+    while ( bit_index < kd::id::BIT_SIZE - 1
+          && a[ bit_index ] == b[ bit_index ] )
+        ++ bit_index;
+
+    return bit_index;
+}
+
+std::vector< kd::id >
+generate_ids
+    ( std::size_t count )
+{
+    std::default_random_engine random_engine{ 42 };
+
+    std::vector< kd::id > ids;
+    ids.reserve( count );
+    for ( std::size_t i = 0; i != count; ++ i )
+        ids.emplace_back( random_engine );
+
+    return ids;
+}
+
+/**
+ *  Ids sharing a random length prefix with reference,
+ *  as seen by the routing table of a busy node.
+ */
+std::vector< kd::id >
+generate_close_ids
+    ( kd::id const& reference
+    , std::size_t count )
+{
+    std::default_random_engine random_engine{ 43 };
+    std::geometric_distribution< std::size_t > prefix_length{ 0.05 };
+
+    std::vector< kd::id > ids;
+    ids.reserve( count );
+    for ( std::size_t i = 0; i != count; ++ i )
+    {
+        kd::id new_id{ random_engine };
+        auto const length = std::min( prefix_length( random_engine )
+                                    , kd::id::BIT_SIZE - 1 );
+        for ( std::size_t j = 0; j != length; ++ j )
+            new_id[ j ] = bool( reference[ j ] );
+        new_id[ length ] = ! reference[ length ];
+        ids.push_back( new_id );
+    }
+
+    return ids;
+}
+
+template< typename Distance >
+double
+measure_distance
+    ( std::vector< kd::id > const& ids
+    , Distance distance )
+{
+    auto const mask = ids.size() - 1;
+    return kb::measure( 10000000, [ & ]( std::size_t i )
+    { kb::do_not_optimize( distance( ids[ i & mask ], ids[ ( i + 1 ) & mask ] ) ); } );
+}
+
+template< typename Less >
+double
+measure_sort
+    ( std::vector< kd::id > const& ids
+    , Less less )
+{
+    std::size_t const iterations_count = 20;
+    return kb::measure( iterations_count, [ & ]( std::size_t )
+    {
+        auto copy = ids;
+        std::sort( copy.begin(), copy.end(), less );
+        kb::do_not_optimize( copy.front() );
+    } ) / ids.size();
+}
+
+template< typename CommonPrefixLength >
+double
+measure_common_prefix_length
+    ( kd::id const& reference
+    , std::vector< kd::id > const& ids
+    , CommonPrefixLength common_prefix_length )
+{
+    auto const mask = ids.size() - 1;
+    return kb::measure( 10000000, [ & ]( std::size_t i )
+    { kb::do_not_optimize( common_prefix_length( reference, ids[ i & mask ] ) ); } );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    // Must be a power of 2.
+    std::size_t const ids_count = 1 << 16;
+    auto const ids = generate_ids( ids_count );
+    auto const reference = ids.front();
+    auto const close_ids = generate_close_ids( reference, ids_count );
+
+    kb::report( "distance (byte-wise)"
+              , measure_distance( ids, &legacy_distance ) );
+    kb::report( "distance (word-wise)"
+              , measure_distance( ids, &kd::distance ) );
+
+    using less_type = bool (*)( kd::id const&, kd::id const& );
+    kb::report( "sort (byte-wise operator<), per id"
+              , measure_sort( ids, &legacy_less ) );
+    kb::report( "sort (word-wise operator<), per id"
+              , measure_sort( ids, less_type{ &kd::operator< } ) );
+
+    kb::report( "k_bucket index (bit-wise)"
+              , measure_common_prefix_length( reference, close_ids
+                                             , &legacy_common_prefix_length ) );
+    kb::report( "k_bucket index (common_prefix_length)"
+              , measure_common_prefix_length( reference, close_ids
+                                             , &kd::common_prefix_length ) );
+}
@@ -0,0 +1,491 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <kademlia/error.hpp>
+#include <kademlia/session_configuration.hpp>
+
+#include "find_value_task.hpp"
+#include "store_value_task.hpp"
+#include "ip_endpoint.hpp"
+#include "latency_histogram.hpp"
+#include "message.hpp"
+#include "peer.hpp"
+#include "routing_table.hpp"
+#include "rtt_estimator.hpp"
+#include "timer.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+using duration = kd::timer::duration;
+using ms = std::chrono::milliseconds;
+using data_type = std::vector< std::uint8_t >;
+
+/// Peers of the simulated network.
+std::size_t const PEERS_COUNT = 1000;
+/// Peers known by the lookup initiator.
+std::size_t const KNOWN_PEERS_COUNT = 100;
+/// Peers holding the searched value.
+std::size_t const HOLDERS_COUNT = 3;
+/// Lookups measured per configuration.
+std::size_t const LOOKUPS_COUNT = 5000;
+
+/**
+ *  @brief Simulate a network of peers with a virtual clock.
+ *
+ *  Each peer has a base round trip time of 20 to 60ms,
+ *  each request adding an exponential jitter to it while
+ *  5% of them stall for 100ms to 1s and 1% are lost.
+ *  A peer answers with the value if it holds it, otherwise
+ *  with peers 4 times closer to the searched key.
+ *  Malicious peers never answer with the value but with
+ *  the malicious peers closest to the searched key.
+ *  Requests without response (i.e. stores) are only counted.
+ */
+class simulated_tracker final
+{
+public:
+    ///
+    using endpoint_type = kd::ip_endpoint;
+
+public:
+    simulated_tracker
+        ( std::vector< kd::peer > const& peers
+        , double malicious_ratio = 0. )
+            : random_engine_( 42 ), now_(), events_(), events_count_()
+            , peers_( peers ), base_rtts_(), malicious_peers_(), ranks_()
+            , sorted_peers_(), sorted_malicious_peers_()
+            , round_trip_times_(), rtt_estimators_(), sent_requests_count_()
+    {
+        std::uniform_int_distribution< int > base_rtt{ 20, 60 };
+        std::uniform_real_distribution< double > draw;
+        for ( std::size_t i = 0; i != peers_.size(); ++ i )
+        {
+            base_rtts_.emplace( peers_[ i ].id_, ms{ base_rtt( random_engine_ ) } );
+            if ( draw( random_engine_ ) < malicious_ratio )
+                malicious_peers_.emplace( peers_[ i ].id_ );
+        }
+    }
+
+    /// Sort the peers by distance from the key of the next lookup.
+    void
+    prepare_lookup
+        ( kd::id const& key )
+    {
+        sorted_peers_ = peers_;
+        std::sort( sorted_peers_.begin(), sorted_peers_.end()
+                 , [ &key ]( kd::peer const& a, kd::peer const& b )
+                   { return kd::distance( a.id_, key ) < kd::distance( b.id_, key ); } );
+
+        ranks_.clear();
+        sorted_malicious_peers_.clear();
+        for ( std::size_t i = 0; i != sorted_peers_.size(); ++ i )
+        {
+            ranks_.emplace( sorted_peers_[ i ].id_, i );
+            if ( malicious_peers_.count( sorted_peers_[ i ].id_ ) )
+                sorted_malicious_peers_.push_back( sorted_peers_[ i ] );
+        }
+    }
+
+    template< typename Request, typename OnResponseReceived, typename OnError >
+    void
+    send_request
+        ( Request const& request
+        , kd::peer const& p
+        , duration const& timeout
+        , OnResponseReceived && on_response_received
+        , OnError && on_error )
+    {
+        ++ sent_requests_count_;
+
+        auto const answered = std::make_shared< bool >( false );
+        auto const rtt = draw_rtt( p.id_ );
+
+        if ( rtt < timeout )
+        {
+            kd::header h{ kd::header::V1, kd::header::FIND_PEER_RESPONSE
+                        , p.id_, kd::id{} };
+            auto body = std::make_shared< kd::buffer >();
+            make_response( request, p.id_, h, *body );
+
+            schedule( rtt, [ this, answered, rtt, p, h, body, on_response_received ]
+            {
+                if ( *answered )
+                    return;
+
+                *answered = true;
+                round_trip_times_.record( rtt );
+                rtt_estimators_[ p.id_ ].record( rtt );
+                on_response_received( p.endpoint_, h, body->cbegin(), body->cend() );
+            } );
+        }
+
+        schedule( timeout, [ answered, on_error ]
+        {
+            if ( *answered )
+                return;
+
+            *answered = true;
+            on_error( std::make_error_code( std::errc::timed_out ) );
+        } );
+    }
+
+    template< typename Request >
+    void
+    send_request
+        ( Request const&
+        , endpoint_type const& )
+    { ++ sent_requests_count_; }
+
+    duration
+    round_trip_time_percentile
+        ( double percentile )
+        const
+    { return round_trip_times_.percentile( percentile ); }
+
+    duration
+    request_soft_timeout
+        ( kd::id const& peer_id
+        , double percentile )
+        const
+    {
+        auto const e = rtt_estimators_.find( peer_id );
+        if ( e != rtt_estimators_.end() )
+            return e->second.soft_timeout();
+
+        return round_trip_time_percentile( percentile );
+    }
+
+    template< typename Callback >
+    kd::timer::handle
+    expires_from_now
+        ( duration const& timeout
+        , Callback && callback )
+    {
+        schedule( timeout, std::forward< Callback >( callback ) );
+        return kd::timer::handle{};
+    }
+
+    /// Timeouts aren't cancellable, the task ignores outdated ones.
+    bool
+    cancel
+        ( kd::timer::handle const& )
+    { return false; }
+
+    duration
+    now
+        ( void )
+        const
+    { return now_; }
+
+    std::size_t
+    sent_requests_count
+        ( void )
+        const
+    { return sent_requests_count_; }
+
+    /// Execute the events until none is left.
+    void
+    run
+        ( void )
+    {
+        while ( ! events_.empty() )
+        {
+            auto e = events_.top();
+            events_.pop();
+            now_ = std::get< 0 >( e );
+            std::get< 2 >( e )();
+        }
+    }
+
+private:
+    using event = std::tuple< duration, std::size_t, std::function< void ( void ) > >;
+
+    struct later final
+    {
+        bool
+        operator()
+            ( event const& a
+            , event const& b )
+            const
+        { return std::tie( std::get< 0 >( a ), std::get< 1 >( a ) )
+               > std::tie( std::get< 0 >( b ), std::get< 1 >( b ) ); }
+    };
+
+private:
+    template< typename Callback >
+    void
+    schedule
+        ( duration const& delay
+        , Callback && callback )
+    { events_.emplace( now_ + delay, events_count_ ++, std::forward< Callback >( callback ) ); }
+
+    duration
+    draw_rtt
+        ( kd::id const& peer_id )
+    {
+        std::uniform_real_distribution< double > draw;
+        auto const r = draw( random_engine_ );
+
+        // Lost.
+        if ( r < 0.01 )
+            return duration::max();
+
+        auto const base = base_rtts_.at( peer_id );
+        // Stalled.
+        if ( r < 0.06 )
+            return base + ms{ std::uniform_int_distribution< int >{ 100, 1000 }( random_engine_ ) };
+
+        std::exponential_distribution< double > jitter{ 1. / 0.2 };
+        return base + std::chrono::duration_cast< duration >( base * jitter( random_engine_ ) );
+    }
+
+    void
+    make_response
+        ( kd::find_value_request_body const& request
+        , kd::id const& peer_id
+        , kd::header & h
+        , kd::buffer & body )
+    {
+        if ( malicious_peers_.count( peer_id ) )
+        {
+            auto const last = std::min< std::size_t >( 20, sorted_malicious_peers_.size() );
+            kd::find_peer_response_body response;
+            response.peers_.assign( sorted_malicious_peers_.begin()
+                                  , sorted_malicious_peers_.begin() + last );
+            kd::serialize( response, body );
+            return;
+        }
+
+        if ( ranks_.at( peer_id ) < HOLDERS_COUNT )
+        {
+            h.type_ = kd::header::FIND_VALUE_RESPONSE;
+            kd::serialize( kd::find_value_response_body{ { 1, 2, 3, 4 } }, body );
+            return;
+        }
+
+        make_response( kd::find_peer_request_body{ request.value_to_find_ }
+                     , peer_id, h, body );
+    }
+
+    void
+    make_response
+        ( kd::find_peer_request_body const&
+        , kd::id const& peer_id
+        , kd::header &
+        , kd::buffer & body )
+    {
+        auto const rank = ranks_.at( peer_id );
+        kd::find_peer_response_body response;
+        auto const first = rank / 4;
+        auto const last = std::min( first + 20, sorted_peers_.size() );
+        response.peers_.assign( sorted_peers_.begin() + first
+                              , sorted_peers_.begin() + last );
+        kd::serialize( response, body );
+    }
+
+private:
+    std::mt19937 random_engine_;
+    duration now_;
+    std::priority_queue< event, std::vector< event >, later > events_;
+    std::size_t events_count_;
+    std::vector< kd::peer > const& peers_;
+    std::map< kd::id, duration > base_rtts_;
+    std::set< kd::id > malicious_peers_;
+    std::map< kd::id, std::size_t > ranks_;
+    std::vector< kd::peer > sorted_peers_;
+    std::vector< kd::peer > sorted_malicious_peers_;
+    kd::latency_histogram round_trip_times_;
+    std::map< kd::id, kd::rtt_estimator > rtt_estimators_;
+    std::size_t sent_requests_count_;
+};
+
+/**
+ *  Run LOOKUPS_COUNT find value lookups on the simulated
+ *  network and report their p50 & p99 durations.
+ */
+void
+measure_find_value_latency
+    ( double hedged_requests_percentile
+    , std::size_t disjoint_paths_count = 1
+    , double malicious_ratio = 0. )
+{
+    std::default_random_engine random_engine{ 1 };
+
+    std::vector< kd::peer > peers;
+    for ( std::size_t i = 0; i != PEERS_COUNT; ++ i )
+        peers.push_back( kd::peer{ kd::id{ random_engine }
+                                 , { boost::asio::ip::address_v4( 0x0a000000 + i )
+                                   , 27980 } } );
+
+    kd::routing_table< kd::ip_endpoint > routing_table{ kd::id{ random_engine } };
+    for ( std::size_t i = 0; i != KNOWN_PEERS_COUNT; ++ i )
+        routing_table.push( peers[ i ].id_, peers[ i ].endpoint_ );
+
+    simulated_tracker tracker{ peers, malicious_ratio };
+
+    k::session_configuration configuration;
+    configuration.hedged_requests_percentile( hedged_requests_percentile );
+    configuration.disjoint_paths_count( disjoint_paths_count );
+
+    std::vector< duration > latencies;
+    std::size_t failures_count = 0;
+    for ( std::size_t i = 0; i != LOOKUPS_COUNT; ++ i )
+    {
+        kd::id const key{ random_engine };
+        tracker.prepare_lookup( key );
+
+        auto const start = tracker.now();
+        auto on_load = [ & ]( std::error_code const& failure, data_type const& )
+        {
+            if ( failure )
+                ++ failures_count;
+            latencies.push_back( tracker.now() - start );
+        };
+
+        kd::start_find_value_task< data_type >( key, tracker, routing_table
+                                              , on_load, configuration );
+        tracker.run();
+    }
+
+    std::sort( latencies.begin(), latencies.end() );
+    auto percentile = [ & ]( double p )
+    {
+        auto const l = latencies[ std::size_t( p * ( latencies.size() - 1 ) ) ];
+        return std::chrono::duration< double, std::milli >{ l }.count();
+    };
+
+    std::string name = "find value";
+    if ( disjoint_paths_count > 1 )
+        name += ", " + std::to_string( disjoint_paths_count ) + " disjoint paths";
+    if ( malicious_ratio > 0. )
+        name += ", " + std::to_string( int( malicious_ratio * 100 ) ) + "% malicious";
+    name += hedged_requests_percentile > 0.
+            ? ", hedged at p" + std::to_string( int( hedged_requests_percentile * 100 ) )
+            : std::string{ ", not hedged" };
+    kb::report( name + ", p50", percentile( 0.5 ), "ms" );
+    kb::report( name + ", p99", percentile( 0.99 ), "ms" );
+    kb::report( name + ", requests"
+              , double( tracker.sent_requests_count() ) / LOOKUPS_COUNT, "req/lookup" );
+    kb::report( name + ", failures", double( failures_count ), "lookups" );
+
+    if ( hedged_requests_percentile > 0. )
+        kb::report( name + ", fallback soft deadline"
+                  , std::chrono::duration< double, std::milli >
+                        { tracker.round_trip_time_percentile( hedged_requests_percentile ) }.count()
+                  , "ms" );
+}
+
+/**
+ *  Run LOOKUPS_COUNT store value tasks on the simulated
+ *  network and report the messages they sent.
+ */
+void
+measure_store_value_messages
+    ( void )
+{
+    std::default_random_engine random_engine{ 1 };
+
+    std::vector< kd::peer > peers;
+    for ( std::size_t i = 0; i != PEERS_COUNT; ++ i )
+        peers.push_back( kd::peer{ kd::id{ random_engine }
+                                 , { boost::asio::ip::address_v4( 0x0a000000 + i )
+                                   , 27980 } } );
+
+    kd::routing_table< kd::ip_endpoint > routing_table{ kd::id{ random_engine } };
+    for ( std::size_t i = 0; i != KNOWN_PEERS_COUNT; ++ i )
+        routing_table.push( peers[ i ].id_, peers[ i ].endpoint_ );
+
+    simulated_tracker tracker{ peers };
+
+    std::vector< duration > latencies;
+    std::size_t failures_count = 0;
+    for ( std::size_t i = 0; i != LOOKUPS_COUNT; ++ i )
+    {
+        kd::id const key{ random_engine };
+        tracker.prepare_lookup( key );
+
+        auto const start = tracker.now();
+        auto on_save = [ & ]( std::error_code const& failure )
+        {
+            if ( failure )
+                ++ failures_count;
+            latencies.push_back( tracker.now() - start );
+        };
+
+        kd::start_store_value_task( key, data_type{ 1, 2, 3, 4 }
+                                  , std::chrono::hours{ 24 }
+                                  , tracker, routing_table, on_save );
+        tracker.run();
+    }
+
+    std::sort( latencies.begin(), latencies.end() );
+    auto const p50 = latencies[ latencies.size() / 2 ];
+
+    std::string const name = "store value";
+    kb::report( name + ", p50"
+              , std::chrono::duration< double, std::milli >{ p50 }.count(), "ms" );
+    kb::report( name + ", messages"
+              , double( tracker.sent_requests_count() ) / LOOKUPS_COUNT, "msg/store" );
+    kb::report( name + ", failures", double( failures_count ), "stores" );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    for ( auto percentile : { 0., 0.95, 0.75 } )
+        measure_find_value_latency( percentile );
+
+    for ( auto malicious_ratio : { 0., 0.2 } )
+        for ( std::size_t paths_count : { 1, 2, 3 } )
+            if ( paths_count > 1 || malicious_ratio > 0. )
+                measure_find_value_latency( 0., paths_count, malicious_ratio );
+
+    measure_store_value_messages();
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "id.hpp"
+#include "ip_endpoint.hpp"
+#include "lookup_task.hpp"
+#include "peer.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+/// Peers known by the lookup initiator.
+std::size_t const KNOWN_PEERS_COUNT = 20;
+/// Responses handled by a lookup.
+std::size_t const RESPONSES_COUNT = 200;
+/// Peers per response.
+std::size_t const RESPONSE_PEERS_COUNT = 20;
+
+///
+struct task final : kd::lookup_task
+{
+    template< typename Iterator >
+    task
+        ( kd::id const& key
+        , Iterator i, Iterator e )
+            : lookup_task( key, i, e, 20 )
+    { }
+};
+
+/**
+ *  Perform lookups_count lookups, each handling RESPONSES_COUNT
+ *  responses of random peers, and report the duration of a lookup.
+ */
+void
+measure_lookup
+    ( std::size_t lookups_count )
+{
+    std::default_random_engine random_engine;
+
+    auto const make_peer = [ &random_engine ]( std::size_t i )
+    {
+        return kd::peer{ kd::id{ random_engine }
+                       , { boost::asio::ip::address_v4( 0x0a000000 + i )
+                         , 27980 } };
+    };
+
+    std::vector< std::pair< kd::id, kd::ip_endpoint > > known_peers;
+    for ( std::size_t i = 0; i != KNOWN_PEERS_COUNT; ++ i )
+    {
+        auto const p = make_peer( i );
+        known_peers.emplace_back( p.id_, p.endpoint_ );
+    }
+
+    std::vector< std::vector< kd::peer > > responses( RESPONSES_COUNT );
+    for ( auto & r : responses )
+        for ( std::size_t i = 0; i != RESPONSE_PEERS_COUNT; ++ i )
+            r.push_back( make_peer( i ) );
+
+    kd::id const key{ random_engine };
+    std::size_t selected_count = 0;
+
+    auto lookup = [ & ]( std::size_t )
+    {
+        task t{ key, known_peers.begin(), known_peers.end() };
+
+        // Each response flags a contacted candidate as valid,
+        // provides new candidates and frees a request slot.
+        for ( auto const& r : responses )
+        {
+            for ( auto const& c : t.select_new_closest_candidates( 3 ) )
+            {
+                t.flag_candidate_as_valid( c.id_ );
+                ++ selected_count;
+            }
+
+            t.add_candidates( r );
+        }
+
+        kb::do_not_optimize( t.is_converged() );
+    };
+
+    // Warm up.
+    kb::measure( 16, lookup );
+
+    auto const duration = kb::measure( lookups_count, lookup );
+
+    std::string const name = std::to_string( RESPONSES_COUNT ) + " responses lookup";
+    kb::report( name, duration / 1000., "us/lookup" );
+    kb::report( name + ", per response", duration / RESPONSES_COUNT, "ns/response" );
+    kb::do_not_optimize( selected_count );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    measure_lookup( 2000 );
+}
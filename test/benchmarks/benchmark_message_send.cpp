@@ -0,0 +1,312 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <kademlia/endpoint.hpp>
+#include <kademlia/session_configuration.hpp>
+
+#include "message_socket.hpp"
+#include "network.hpp"
+#include "routing_table.hpp"
+#include "tracker.hpp"
+#include "message.hpp"
+#include "peer.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+/// Count every allocation performed by the process.
+std::atomic< std::size_t > allocations_count{ 0 };
+
+} // anonymous namespace
+
+void *
+operator new
+    ( std::size_t size )
+{
+    allocations_count.fetch_add( 1, std::memory_order_relaxed );
+
+    if ( auto p = std::malloc( size ? size : 1 ) )
+        return p;
+
+    throw std::bad_alloc{};
+}
+
+void
+operator delete
+    ( void * p ) noexcept
+{ std::free( p ); }
+
+void
+operator delete
+    ( void * p
+    , std::size_t ) noexcept
+{ std::free( p ); }
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+/**
+ *  Socket completing sends immediately and never receiving
+ *  anything, so that only the library send path is measured.
+ */
+class null_socket
+{
+public:
+    ///
+    using protocol_type = boost::asio::ip::udp;
+
+    ///
+    using endpoint_type = protocol_type::endpoint;
+
+public:
+    null_socket
+        ( boost::asio::io_service &
+        , protocol_type const& )
+            : local_endpoint_()
+    { }
+
+    template< typename Option >
+    void
+    set_option
+        ( Option const& )
+    { }
+
+    boost::system::error_code
+    bind
+        ( endpoint_type const& e )
+    {
+        local_endpoint_ = e;
+        return boost::system::error_code{};
+    }
+
+    boost::system::error_code
+    close
+        ( boost::system::error_code & failure )
+    {
+        failure.clear();
+        return failure;
+    }
+
+    endpoint_type
+    local_endpoint
+        ( void )
+        const
+    { return local_endpoint_; }
+
+    template< typename Callback >
+    void
+    async_receive_from
+        ( boost::asio::mutable_buffer const&
+        , endpoint_type &
+        , Callback && )
+    { }
+
+    template< typename Callback >
+    void
+    async_send_to
+        ( boost::asio::const_buffer const& buffer
+        , endpoint_type const&
+        , Callback && callback )
+    {
+        kb::do_not_optimize( buffer );
+        callback( boost::system::error_code{}, buffer.size() );
+    }
+
+private:
+    ///
+    endpoint_type local_endpoint_;
+};
+
+using socket_type = kd::message_socket< null_socket >;
+using network_type = kd::network< socket_type >;
+using routing_table_type = kd::routing_table< network_type::endpoint_type >;
+using tracker_type = kd::tracker< std::default_random_engine
+                                , network_type
+                                , routing_table_type >;
+
+/**
+ *  Send messages_count FIND_PEER_RESPONSE of peers_count peers
+ *  through the tracker and report the rate and the allocations
+ *  performed per message once the steady state is reached.
+ */
+void
+measure_find_peer_response_send
+    ( std::size_t peers_count
+    , std::size_t messages_count )
+{
+    boost::asio::io_service io_service;
+    boost::asio::io_service::strand strand{ io_service };
+    std::default_random_engine random_engine;
+    kd::id const my_id{ random_engine };
+
+    network_type network{ io_service
+                        , socket_type::ipv4( io_service
+                                           , k::endpoint{ "127.0.0.1", 27980 } )
+                        , socket_type::ipv6( io_service
+                                           , k::endpoint{ "::1", 27980 } )
+                        , [] ( network_type::endpoint_type const&
+                             , kd::shared_buffer const&
+                             , kd::buffer::const_iterator
+                             , kd::buffer::const_iterator ) {} };
+
+    routing_table_type routing_table{ my_id };
+    tracker_type tracker{ strand, my_id, network, random_engine, routing_table };
+
+    kd::find_peer_response_body response;
+    for ( std::size_t i = 0; i != peers_count; ++ i )
+        response.peers_.push_back( kd::peer{ kd::id{ random_engine }
+                                           , { boost::asio::ip::address_v4( 0x0a000000 + i )
+                                             , 27980 } } );
+
+    kd::id const token{ random_engine };
+    kd::ip_endpoint const target{ boost::asio::ip::address_v4( 0x0a0000ff )
+                                , 27980 };
+
+    auto send = [ & ] ( std::size_t )
+    { tracker.send_response( token, response, target ); };
+
+    // Warm up the buffers.
+    kb::measure( 1024, send );
+
+    auto const allocations_before = allocations_count.load();
+    auto const duration = kb::measure( messages_count, send );
+    auto const allocations = allocations_count.load() - allocations_before;
+
+    auto const name = "FIND_PEER_RESPONSE, "
+                    + std::to_string( peers_count ) + " peers";
+    kb::report( name + ", rate", 1e9 / duration, "msg/s" );
+    kb::report( name + ", allocations"
+              , double( allocations ) / messages_count, "alloc/msg" );
+}
+
+/**
+ *  Send requests_count FIND_PEER_REQUEST through the tracker with
+ *  callbacks capturing what tasks capture, receive their responses
+ *  and report the rate and the allocations performed per request.
+ */
+void
+measure_find_peer_request_round_trip
+    ( std::size_t requests_count )
+{
+    boost::asio::io_service io_service;
+    boost::asio::io_service::strand strand{ io_service };
+    std::default_random_engine random_engine;
+    kd::id const my_id{ random_engine };
+
+    network_type network{ io_service
+                        , socket_type::ipv4( io_service
+                                           , k::endpoint{ "127.0.0.1", 27980 } )
+                        , socket_type::ipv6( io_service
+                                           , k::endpoint{ "::1", 27980 } )
+                        , [] ( network_type::endpoint_type const&
+                             , kd::shared_buffer const&
+                             , kd::buffer::const_iterator
+                             , kd::buffer::const_iterator ) {} };
+
+    routing_table_type routing_table{ my_id };
+    tracker_type tracker{ strand, my_id, network, random_engine, routing_table };
+
+    kd::find_peer_request_body const request{ kd::id{ random_engine } };
+    kd::peer const current_peer{ kd::id{ random_engine }
+                               , { boost::asio::ip::address_v4( 0x0a0000ff )
+                                 , 27980 } };
+    routing_table.push( current_peer.id_, current_peer.endpoint_ );
+    auto const task = std::make_shared< std::size_t >( 0 );
+    kd::buffer const body;
+
+    auto round_trip = [ & ] ( std::size_t )
+    {
+        // The tracker draws the request token from the random engine.
+        auto engine = random_engine;
+        kd::header const h{ kd::header::V1
+                          , kd::header::FIND_PEER_RESPONSE
+                          , current_peer.id_
+                          , kd::id{ engine } };
+
+        auto on_message_received = [ task, current_peer ]
+            ( kd::ip_endpoint const&
+            , kd::header const&
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+        { ++ *task; };
+
+        auto on_error = [ task, current_peer ]
+            ( std::error_code const& )
+        { -- *task; };
+
+        tracker.send_request( request
+                            , current_peer
+                            , k::session_configuration{}.peer_lookup_timeout()
+                            , std::move( on_message_received )
+                            , std::move( on_error ) );
+
+        tracker.handle_new_response( current_peer.endpoint_
+                                   , h, body.begin(), body.end() );
+    };
+
+    // Warm up the buffers.
+    kb::measure( 1024, round_trip );
+
+    auto const allocations_before = allocations_count.load();
+    auto const duration = kb::measure( requests_count, round_trip );
+    auto const allocations = allocations_count.load() - allocations_before;
+
+    std::string const name = "FIND_PEER_REQUEST round trip";
+    kb::report( name + ", rate", 1e9 / duration, "req/s" );
+    kb::report( name + ", allocations"
+              , double( allocations ) / requests_count, "alloc/req" );
+
+    // Drop the aborted timer waits.
+    io_service.poll();
+    kb::do_not_optimize( *task );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    measure_find_peer_response_send( 20, 1000000 );
+    measure_find_peer_request_round_trip( 1000000 );
+}
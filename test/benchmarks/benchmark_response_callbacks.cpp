@@ -0,0 +1,159 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "peer.hpp"
+#include "response_callbacks.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+using endpoint_type = kd::response_callbacks::endpoint_type;
+
+/**
+ *  The callbacks container used before the open addressing table.
+ */
+class legacy_response_callbacks final
+{
+public:
+    using callback = std::function< void
+            ( endpoint_type const& sender
+            , kd::header const& h
+            , kd::buffer::const_iterator i
+            , kd::buffer::const_iterator e ) >;
+
+    void
+    push_callback
+        ( kd::id const& message_id
+        , callback const& on_message_received )
+    { callbacks_.emplace( message_id, on_message_received ); }
+
+    bool
+    remove_callback
+        ( kd::id const& message_id )
+    { return callbacks_.erase( message_id ) > 0; }
+
+    void
+    dispatch_response
+        ( endpoint_type const& sender
+        , kd::header const& h
+        , kd::buffer::const_iterator i
+        , kd::buffer::const_iterator e )
+    {
+        auto callback = callbacks_.find( h.random_token_ );
+        if ( callback == callbacks_.end() )
+            return;
+
+        callback->second( sender, h, i, e );
+        callbacks_.erase( callback );
+    }
+
+private:
+    std::map< kd::id, callback > callbacks_;
+};
+
+/**
+ *  Push count callbacks capturing what tasks capture,
+ *  dispatch their responses in a random order
+ *  then push them again into the warm container
+ *  and remove them.
+ */
+template< typename Callbacks >
+void
+benchmark_callbacks
+    ( std::string const& name
+    , std::size_t count )
+{
+    std::default_random_engine random_engine{ 42 };
+
+    std::vector< kd::header > headers;
+    for ( std::size_t i = 0; i != count; ++ i )
+        headers.push_back( kd::header{ kd::header::V1
+                                     , kd::header::FIND_PEER_RESPONSE
+                                     , kd::id{}
+                                     , kd::id{ random_engine } } );
+
+    auto const task = std::make_shared< std::size_t >( 0 );
+    kd::peer const current_peer{ kd::id{ random_engine }
+                               , kd::ip_endpoint{ boost::asio::ip::address_v4::loopback()
+                                                , 27980 } };
+    auto on_message_received = [ task, current_peer ]
+            ( endpoint_type const&
+            , kd::header const&
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+    { ++ *task; };
+
+    endpoint_type const sender{};
+    kd::buffer const b;
+    auto const suffix = " (" + std::to_string( count ) + " outstanding)";
+
+    Callbacks callbacks;
+    auto const push = kb::measure( count, [ & ] ( std::size_t i )
+    { callbacks.push_callback( headers[ i ].random_token_, on_message_received ); } );
+
+    std::shuffle( headers.begin(), headers.end(), random_engine );
+    auto const dispatch = kb::measure( count, [ & ] ( std::size_t i )
+    { callbacks.dispatch_response( sender, headers[ i ], b.begin(), b.end() ); } );
+
+    auto const warm_push = kb::measure( count, [ & ] ( std::size_t i )
+    { callbacks.push_callback( headers[ i ].random_token_, on_message_received ); } );
+
+    std::shuffle( headers.begin(), headers.end(), random_engine );
+    auto const remove = kb::measure( count, [ & ] ( std::size_t i )
+    { callbacks.remove_callback( headers[ i ].random_token_ ); } );
+
+    kb::report( name + " push" + suffix, push );
+    kb::report( name + " dispatch" + suffix, dispatch );
+    kb::report( name + " warm push" + suffix, warm_push );
+    kb::report( name + " remove" + suffix, remove );
+
+    kb::do_not_optimize( *task );
+}
+
+} // namespace
+
+int
+main
+    ( void )
+{
+    for ( auto count : { 10000, 100000 } )
+    {
+        benchmark_callbacks< legacy_response_callbacks >( "std::map", count );
+        benchmark_callbacks< kd::response_callbacks >( "open addressing", count );
+    }
+}
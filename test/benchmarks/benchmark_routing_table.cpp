@@ -0,0 +1,199 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "id.hpp"
+#include "ip_endpoint.hpp"
+#include "message.hpp"
+#include "routing_table.hpp"
+#include "tree_routing_table.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+/// Peers per find peer response.
+std::size_t const RESPONSE_PEERS_COUNT = 20;
+/// Targets of the find peer requests, must be a power of 2.
+std::size_t const TARGETS_COUNT = 1 << 10;
+
+/**
+ *
+ */
+std::vector< kd::id >
+generate_ids
+    ( std::default_random_engine & random_engine
+    , std::size_t count )
+{
+    std::vector< kd::id > ids;
+    ids.reserve( count );
+    for ( std::size_t i = 0; i != count; ++ i )
+        ids.emplace_back( random_engine );
+
+    return ids;
+}
+
+/**
+ *  The response built from the routing table iterator.
+ */
+template< typename RoutingTableType >
+void
+fill_response_from_iterator
+    ( RoutingTableType & routing_table
+    , kd::id const& target
+    , kd::find_peer_response_body & response )
+{
+    auto remaining_peer = RESPONSE_PEERS_COUNT;
+    for ( auto i = routing_table.find( target ), e = routing_table.end()
+        ; i != e && remaining_peer > 0
+        ; ++i, -- remaining_peer )
+        response.peers_.push_back( { i->first, i->second } );
+}
+
+/**
+ *  The response built from the closest peers.
+ */
+template< typename RoutingTableType >
+void
+fill_response_from_closest
+    ( RoutingTableType & routing_table
+    , kd::id const& target
+    , std::vector< typename RoutingTableType::value_type > & closest_peers
+    , kd::find_peer_response_body & response )
+{
+    auto const e = routing_table.closest( target, closest_peers.size()
+                                        , closest_peers.begin() );
+
+    response.peers_.reserve( std::distance( closest_peers.begin(), e ) );
+    for ( auto i = closest_peers.begin(); i != e; ++ i )
+        response.peers_.push_back( { i->first, i->second } );
+}
+
+/**
+ *  @return The percentage of the exact closest peers in the response.
+ */
+double
+measure_accuracy
+    ( std::vector< kd::id > known_ids
+    , kd::id const& target
+    , kd::find_peer_response_body const& response )
+{
+    auto const count = std::min( RESPONSE_PEERS_COUNT, known_ids.size() );
+    std::partial_sort( known_ids.begin(), known_ids.begin() + count
+                     , known_ids.end()
+                     , [ &target ]( kd::id const& a, kd::id const& b )
+                       { return distance( a, target ) < distance( b, target ); } );
+
+    std::size_t found = 0;
+    for ( auto const& p : response.peers_ )
+        if ( std::find( known_ids.begin(), known_ids.begin() + count, p.id_ )
+                != known_ids.begin() + count )
+            ++ found;
+
+    return 100. * found / count;
+}
+
+template< typename RoutingTableType >
+void
+measure_find_peer_response
+    ( char const* name
+    , std::size_t peers_count )
+{
+    std::default_random_engine random_engine{ 42 };
+
+    RoutingTableType routing_table{ kd::id{ random_engine } };
+    std::vector< kd::id > known_ids;
+    for ( auto const& new_id : generate_ids( random_engine, peers_count ) )
+        if ( routing_table.push( new_id, kd::ip_endpoint{} ) )
+            known_ids.push_back( new_id );
+
+    auto const targets = generate_ids( random_engine, TARGETS_COUNT );
+    auto const mask = TARGETS_COUNT - 1;
+    std::vector< typename RoutingTableType::value_type > closest_peers
+            ( RESPONSE_PEERS_COUNT );
+
+    auto const iterator_duration = kb::measure( 100000, [ & ]( std::size_t i )
+    {
+        kd::find_peer_response_body response;
+        fill_response_from_iterator( routing_table, targets[ i & mask ]
+                                   , response );
+        kb::do_not_optimize( response.peers_.back() );
+    } );
+
+    auto const closest_duration = kb::measure( 100000, [ & ]( std::size_t i )
+    {
+        kd::find_peer_response_body response;
+        fill_response_from_closest( routing_table, targets[ i & mask ]
+                                  , closest_peers, response );
+        kb::do_not_optimize( response.peers_.back() );
+    } );
+
+    double iterator_accuracy = 0., closest_accuracy = 0.;
+    for ( auto const& target : targets )
+    {
+        kd::find_peer_response_body iterator_response, closest_response;
+        fill_response_from_iterator( routing_table, target, iterator_response );
+        fill_response_from_closest( routing_table, target
+                                  , closest_peers, closest_response );
+
+        iterator_accuracy += measure_accuracy( known_ids, target
+                                             , iterator_response );
+        closest_accuracy += measure_accuracy( known_ids, target
+                                            , closest_response );
+    }
+
+    std::string const prefix = std::string{ name } + " ("
+            + std::to_string( known_ids.size() ) + " peers), ";
+    kb::report( prefix + "find()", iterator_duration );
+    kb::report( prefix + "closest()", closest_duration );
+    kb::report( prefix + "find() exact", iterator_accuracy / TARGETS_COUNT, "%" );
+    kb::report( prefix + "closest() exact", closest_accuracy / TARGETS_COUNT, "%" );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    for ( std::size_t peers_count : { 100, 1000, 10000 } )
+    {
+        measure_find_peer_response< kd::routing_table< kd::ip_endpoint > >
+                ( "routing_table", peers_count );
+        measure_find_peer_response< kd::tree_routing_table< kd::ip_endpoint > >
+                ( "tree_routing_table", peers_count );
+    }
+}
+
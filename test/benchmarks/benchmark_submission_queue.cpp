@@ -0,0 +1,127 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+
+#include "submission_queue.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+/**
+ *  Run producers_count threads calling submit( task ) tasks_count times
+ *  while the io_service is run from a single consumer thread.
+ *  @return The submitted tasks count per second.
+ */
+template< typename Submit >
+double
+measure_submissions
+    ( boost::asio::io_service & io_service
+    , std::size_t producers_count
+    , std::size_t tasks_count
+    , Submit submit )
+{
+    using clock = std::chrono::steady_clock;
+
+    std::atomic< std::size_t > executed_count{ 0 };
+    auto task = [ &executed_count ] ( void ) { ++ executed_count; };
+
+    auto const start = clock::now();
+
+    std::thread consumer;
+    {
+        boost::asio::io_service::work work{ io_service };
+        consumer = std::thread{ [ &io_service ] { io_service.run(); } };
+
+        std::vector< std::thread > producers;
+        for ( std::size_t i = 0; i != producers_count; ++ i )
+            producers.emplace_back( [ & ] ( void )
+            {
+                for ( std::size_t j = 0; j != tasks_count; ++ j )
+                    submit( task );
+            } );
+
+        for ( auto & p : producers )
+            p.join();
+    }
+
+    consumer.join();
+    io_service.reset();
+
+    using seconds = std::chrono::duration< double >;
+    auto const elapsed = seconds{ clock::now() - start }.count();
+
+    return executed_count / elapsed;
+}
+
+} // anonymous namespace
+
+int
+main
+    ( void )
+{
+    std::size_t const tasks_count = 250000;
+
+    for ( std::size_t producers_count : { 1, 2, 4, 8 } )
+    {
+        auto const suffix = ", " + std::to_string( producers_count )
+                          + " producer(s)";
+
+        boost::asio::io_service io_service;
+
+        auto post = [ &io_service ] ( std::function< void ( void ) > const& task )
+        { io_service.post( task ); };
+
+        kb::report( "io_service::post" + suffix
+                  , measure_submissions( io_service, producers_count
+                                       , tasks_count, post )
+                  , "op/s" );
+
+        kd::submission_queue queue;
+        auto push = [ &io_service, &queue ] ( std::function< void ( void ) > const& task )
+        {
+            if ( queue.push( task ) )
+                io_service.post( [ &queue ] { queue.consume_all(); } );
+        };
+
+        kb::report( "submission_queue" + suffix
+                  , measure_submissions( io_service, producers_count
+                                       , tasks_count, push )
+                  , "op/s" );
+    }
+}
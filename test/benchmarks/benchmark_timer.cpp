@@ -0,0 +1,155 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "timing_wheel.hpp"
+
+#include "benchmark.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmark;
+
+using tick_type = kd::timing_wheel::tick_type;
+
+/**
+ *  The timeouts container used by detail::timer before the timing wheel.
+ */
+class legacy_timeouts final
+{
+public:
+    void
+    insert
+        ( tick_type expiration
+        , std::function< void ( void ) > callback )
+    { timeouts_.emplace( expiration, std::move( callback ) ); }
+
+    bool
+    empty
+        ( void )
+        const
+    { return timeouts_.empty(); }
+
+    /// Execute and remove the sooner timeouts.
+    void
+    fire
+        ( void )
+    {
+        auto begin = timeouts_.begin();
+        auto end = timeouts_.upper_bound( begin->first );
+        for ( auto i = begin; i != end; ++ i )
+            i->second();
+        timeouts_.erase( begin, end );
+    }
+
+private:
+    std::multimap< tick_type, std::function< void ( void ) > > timeouts_;
+};
+
+/**
+ *  @return Expirations spread like response timeouts, in ticks.
+ */
+std::vector< tick_type >
+generate_expirations
+    ( std::size_t count )
+{
+    std::default_random_engine random_engine{ 42 };
+    std::uniform_int_distribution< tick_type > expiration{ 1, 5000 };
+
+    std::vector< tick_type > expirations( count );
+    for ( auto & e : expirations )
+        e = expiration( random_engine );
+
+    return expirations;
+}
+
+/**
+ *  Insert all the expirations then expire them.
+ */
+void
+benchmark_insert_and_expire
+    ( std::size_t count )
+{
+    auto const expirations = generate_expirations( count );
+    auto const suffix = " (" + std::to_string( count ) + " timeouts)";
+    std::size_t expired_count = 0;
+    auto on_expiration = [ &expired_count ] ( void ) { ++ expired_count; };
+
+    {
+        legacy_timeouts timeouts;
+        auto const insert = kb::measure( count, [ & ] ( std::size_t i )
+        { timeouts.insert( expirations[ i ], on_expiration ); } );
+
+        auto const expire = kb::measure( 1, [ & ] ( std::size_t )
+        { while ( ! timeouts.empty() ) timeouts.fire(); } ) / count;
+
+        kb::report( "multimap insert" + suffix, insert );
+        kb::report( "multimap expire" + suffix, expire );
+    }
+
+    {
+        kd::timing_wheel timeouts;
+        auto const insert = kb::measure( count, [ & ] ( std::size_t i )
+        { timeouts.insert( expirations[ i ], on_expiration ); } );
+
+        auto const expire = kb::measure( 1, [ & ] ( std::size_t )
+        { while ( ! timeouts.empty() ) timeouts.advance( timeouts.next_tick() ); } ) / count;
+
+        kb::report( "timing wheel insert" + suffix, insert );
+        kb::report( "timing wheel expire" + suffix, expire );
+
+        // The nodes are now recycled.
+        std::vector< kd::timing_wheel::handle > handles( count );
+        auto const warm_insert = kb::measure( count, [ & ] ( std::size_t i )
+        { handles[ i ] = timeouts.insert( timeouts.now() + expirations[ i ], on_expiration ); } );
+
+        auto const cancel = kb::measure( count, [ & ] ( std::size_t i )
+        { timeouts.cancel( handles[ i ] ); } );
+
+        kb::report( "timing wheel warm insert" + suffix, warm_insert );
+        kb::report( "timing wheel cancel" + suffix, cancel );
+    }
+
+    kb::do_not_optimize( expired_count );
+}
+
+} // namespace
+
+int
+main
+    ( void )
+{
+    for ( auto count : { 1000, 10000, 100000 } )
+        benchmark_insert_and_expire( count );
+}
@@ -33,6 +33,7 @@
 #include <functional>
 #include <cstdlib>
 #include <deque>
+#include <mutex>
 #include <queue>
 #include <vector>
 #include <cstdint>
@@ -102,7 +103,10 @@ public:
             , local_endpoint_( o.local_endpoint_ )
             , pending_reads_( std::move( o.pending_reads_ ) )
             , pending_writes_( std::move( o.pending_writes_ ) )
-    { add_route_to_socket( local_endpoint(), this ); }
+    {
+        std::lock_guard< std::recursive_mutex > const lock{ get_mutex() };
+        add_route_to_socket( local_endpoint(), this );
+    }
 
     /**
      *
@@ -147,6 +151,8 @@ public:
     bind
         ( endpoint_type const& e )
     {
+        std::lock_guard< std::recursive_mutex > const lock{ get_mutex() };
+
         // Only fixed port is handled right now.
         if ( e.port() != FIXED_PORT )
             return make_error_code( boost::system::errc::invalid_argument );
@@ -168,6 +174,8 @@ public:
     close
         ( boost::system::error_code & failure )
     {
+        std::lock_guard< std::recursive_mutex > const lock{ get_mutex() };
+
         // This socket no longer reads messages.
         if ( get_socket( local_endpoint() ) == this )
         {
@@ -193,6 +201,8 @@ public:
         , endpoint_type & from
         , Callback && callback )
     {
+        std::lock_guard< std::recursive_mutex > const lock{ get_mutex() };
+
         // Check if there is packets waiting.
         if ( pending_writes_.empty() )
         {
@@ -226,11 +236,17 @@ public:
         , endpoint_type const& to
         , Callback && callback )
     {
+        std::unique_lock< std::recursive_mutex > lock{ get_mutex() };
+
         // Ensure the destination socket is listening.
         auto target = get_socket( to );
         if ( ! target )
+        {
+            lock.unlock();
             callback( make_error_code( boost::system::errc::network_unreachable )
                     , 0ULL );
+            lock.lock();
+        }
         // Check if it's not waiting for any packet.
         else if ( target->pending_reads_.empty() )
         {
@@ -259,7 +275,7 @@ public:
     static packets &
     get_logged_packets
         ( void )
-    { 
+    {
         static packets logged_packets_;
         return logged_packets_;
     }
@@ -310,6 +326,17 @@ public:
         return ipv6_;
     }
 
+    /**
+     *  @brief Mutex protecting the sockets of all the io_service threads.
+     */
+    static std::recursive_mutex &
+    get_mutex
+        ( void )
+    {
+        static std::recursive_mutex mutex_;
+        return mutex_;
+    }
+
 private:
     ///
     using callback_type = std::function
@@ -538,14 +565,27 @@ private:
     {
         auto perform_write = [ this, target, buffer, callback ] ( void )
         {
+            std::unique_lock< std::recursive_mutex > lock{ get_mutex() };
+
+            // Another thread may have consumed the read task
+            // in the meantime, hence wait for the next one.
+            if ( target->pending_reads_.empty() )
+            {
+                target->pending_writes_.push_back( { buffer, local_endpoint_
+                                                   , callback } );
+                return;
+            }
+
             // Retrieve the read task of the packet.
-            assert( ! target->pending_reads_.empty() );
-            pending_read & p = target->pending_reads_.front();
+            pending_read p = std::move( target->pending_reads_.front() );
+            target->pending_reads_.pop_front();
 
             // Fill the read task buffer and endpoint.
             auto const copied_bytes_count = copy_buffer( buffer, p.buffer_ );
             p.source_ = local_endpoint_;
 
+            lock.unlock();
+
             // Inform the writer that data has been writeen.
             callback( boost::system::error_code()
                     , copied_bytes_count );
@@ -553,8 +593,6 @@ private:
             // Inform the reader that data has been read.
             p.callback_( boost::system::error_code()
                        , copied_bytes_count );
-
-            target->pending_reads_.pop_front();
         };
 
         io_service_.post( perform_write );
@@ -572,14 +610,21 @@ private:
     {
         auto perform_read = [ this, buffer, &from, callback ] ( void )
         {
+            std::unique_lock< std::recursive_mutex > lock{ get_mutex() };
+
             // Retrieve the write task of the packet.
             assert( ! pending_writes_.empty() );
-            pending_write & w = pending_writes_.front();
+            pending_write w = std::move( pending_writes_.front() );
+
+            // The current task has been consumed.
+            pending_writes_.pop_front();
 
             // Fill the provided buffer and endpoint.
             from = w.source_;
             auto const copied_bytes_count = copy_buffer( w.buffer_, buffer );
 
+            lock.unlock();
+
             // Now inform the writeer that data has been sent.
             w.callback_( boost::system::error_code()
                        , copied_bytes_count );
@@ -587,9 +632,6 @@ private:
             // Inform the reader that data has been readd.
             callback( boost::system::error_code()
                     , copied_bytes_count );
-
-            // The current task has been consumed.
-            pending_writes_.pop_front();
         };
 
         io_service_.post( perform_read );
@@ -28,44 +28,52 @@
 #include <boost/asio/io_service.hpp>
 
 #include <kademlia/endpoint.hpp>
+#include <kademlia/session_configuration.hpp>
 
 #include "log.hpp"
 #include "buffer.hpp"
 #include "engine.hpp"
+#include "routing_table.hpp"
+#include "tree_routing_table.hpp"
 
 #include "fake_socket.hpp"
 
 namespace kademlia {
 namespace test {
 
-class test_engine final
+template< typename RoutingTableType >
+class basic_test_engine final
 {
 public:
-    test_engine
+    basic_test_engine
         ( boost::asio::io_service & service
         , endpoint const & ipv4
         , endpoint const & ipv6
-        , detail::id const& new_id )
+        , detail::id const& new_id
+        , session_configuration const& configuration = session_configuration{} )
             : work_( service )
             , engine_( service
-                     , ipv4, ipv6, new_id )
+                     , ipv4, ipv6, new_id
+                     , configuration )
             , listen_ipv4_( fake_socket::get_last_allocated_ipv4()
                           , 27980 )
             , listen_ipv6_( fake_socket::get_last_allocated_ipv6()
                           , 27980 )
     { }
 
-    test_engine
+    basic_test_engine
         ( boost::asio::io_service & service
         , endpoint const & initial_peer
         , endpoint const & ipv4
         , endpoint const & ipv6
-        , detail::id const& new_id )
+        , detail::id const& new_id
+        , session_configuration const& configuration = session_configuration{} )
             : work_( service )
             , engine_( service
                      , initial_peer
                      , ipv4, ipv6
-                     , new_id )
+                     , new_id
+                     , configuration )
             , listen_ipv4_( fake_socket::get_last_allocated_ipv4()
                           , 27980 )
             , listen_ipv6_( fake_socket::get_last_allocated_ipv6()
@@ -79,8 +87,8 @@ public:
         , std::string const& data
         , Callable & callable )
     {
-        impl::key_type const k{ key.begin(), key.end() };
-        impl::data_type const d{ data.begin(), data.end() };
+        typename impl::key_type const k{ key.begin(), key.end() };
+        typename impl::data_type const d{ data.begin(), data.end() };
         engine_.async_save( k, d, callable );
     }
 
@@ -90,9 +98,9 @@ public:
         ( std::string const& key
         , Callable & callable )
     {
-        impl::key_type const k{ key.begin(), key.end() };
+        typename impl::key_type const k{ key.begin(), key.end() };
         auto c = [ callable ]( std::error_code const& failure
-                             , impl::data_type const& data )
+                             , typename impl::data_type const& data )
         {
             callable( failure, std::string{ data.begin(), data.end() } );
         };
@@ -100,6 +108,12 @@ public:
         engine_.async_load( k, c );
     }
 
+    detail::value_store_statistics
+    stored_values_statistics
+        ( void )
+        const
+    { return engine_.stored_values_statistics(); }
+
     endpoint
     ipv4
         ( void )
@@ -119,7 +133,7 @@ public:
     }
 
 private:
-    using impl = detail::engine< fake_socket >;
+    using impl = detail::engine< fake_socket, RoutingTableType >;
 
 private:
     boost::asio::io_service::work work_;
@@ -128,6 +142,12 @@ private:
     fake_socket::endpoint_type listen_ipv6_;
 };
 
+using test_engine = basic_test_engine
+        < detail::routing_table< detail::ip_endpoint > >;
+
+using tree_test_engine = basic_test_engine
+        < detail::tree_routing_table< detail::ip_endpoint > >;
+
 class packet final
 {
 public:
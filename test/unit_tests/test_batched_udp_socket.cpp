@@ -0,0 +1,201 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef __linux__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+
+#include <kademlia/endpoint.hpp>
+
+#include "batched_udp_socket.hpp"
+#include "buffer_pool.hpp"
+#include "message_socket.hpp"
+
+#include "common.hpp"
+#include "network_utils.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = kademlia::detail;
+
+using message_socket_type = kd::message_socket< kd::batched_udp_socket >;
+
+struct fixture
+{
+    fixture
+        ( void )
+            : io_service_{}
+            , receiver_{ message_socket_type::ipv4( io_service_
+                       , k::endpoint{ "127.0.0.1"
+                                    , k::test::get_temporary_listening_port() } ) }
+            , sender_{ message_socket_type::ipv4( io_service_
+                     , k::endpoint{ "127.0.0.1"
+                                  , k::test::get_temporary_listening_port
+                                        ( receiver_.local_endpoint().port_ ) } ) }
+            , received_messages_{}
+            , armed_receptions_count_{ 0 }
+            , sent_messages_count_{ 0 }
+    { }
+
+    void
+    receive
+        ( std::size_t messages_count
+        , std::size_t reception_index = 0 )
+    {
+        auto on_message_received = [ this, messages_count, reception_index ]
+            ( std::error_code const& failure
+            , kd::ip_endpoint const& sender
+            , kd::shared_buffer const&
+            , kd::buffer::const_iterator i
+            , kd::buffer::const_iterator e )
+        {
+            BOOST_REQUIRE( ! failure );
+            BOOST_REQUIRE_EQUAL( sender_.local_endpoint(), sender );
+
+            received_messages_.emplace_back( i, e );
+            receive( messages_count, reception_index );
+        };
+
+        // Don't wait for more messages than expected.
+        if ( armed_receptions_count_ == messages_count )
+            return;
+
+        ++ armed_receptions_count_;
+        receiver_.async_receive( reception_index, on_message_received );
+    }
+
+    void
+    send
+        ( kd::buffer const& message )
+    {
+        auto b = kd::shared_buffer::allocate( message.size() );
+        std::copy( message.begin(), message.end(), b->begin() );
+
+        auto on_message_sent = [ this ]
+            ( std::error_code const& failure )
+        {
+            BOOST_REQUIRE( ! failure );
+            ++ sent_messages_count_;
+        };
+
+        sender_.async_send( b, receiver_.local_endpoint(), on_message_sent );
+    }
+
+    boost::asio::io_service io_service_;
+    message_socket_type receiver_;
+    message_socket_type sender_;
+    std::vector< kd::buffer > received_messages_;
+    std::size_t armed_receptions_count_;
+    std::size_t sent_messages_count_;
+};
+
+BOOST_AUTO_TEST_SUITE( batched_udp_socket )
+
+BOOST_FIXTURE_TEST_SUITE( test_usage, fixture )
+
+BOOST_AUTO_TEST_CASE( burst_of_messages_is_received_in_order )
+{
+    std::size_t const messages_count = kd::batched_udp_socket::BATCH_SIZE * 4 + 3;
+
+    receive( messages_count );
+    for ( std::size_t i = 0; i != messages_count; ++ i )
+        send( kd::buffer( 16, std::uint8_t( i ) ) );
+
+    io_service_.run();
+
+    BOOST_REQUIRE_EQUAL( messages_count, sent_messages_count_ );
+    BOOST_REQUIRE_EQUAL( messages_count, received_messages_.size() );
+    for ( std::size_t i = 0; i != messages_count; ++ i )
+        BOOST_REQUIRE( kd::buffer( 16, std::uint8_t( i ) ) == received_messages_[ i ] );
+}
+
+BOOST_AUTO_TEST_CASE( burst_of_messages_is_received_by_armed_receptions )
+{
+    std::size_t const messages_count = kd::batched_udp_socket::BATCH_SIZE * 4 + 3;
+
+    for ( std::size_t i = 0; i != message_socket_type::RECEPTIONS_COUNT; ++ i )
+        receive( messages_count, i );
+    for ( std::size_t i = 0; i != messages_count; ++ i )
+        send( kd::buffer( 16, std::uint8_t( i ) ) );
+
+    io_service_.run();
+
+    BOOST_REQUIRE_EQUAL( messages_count, received_messages_.size() );
+    for ( std::size_t i = 0; i != messages_count; ++ i )
+        BOOST_REQUIRE( kd::buffer( 16, std::uint8_t( i ) ) == received_messages_[ i ] );
+}
+
+BOOST_AUTO_TEST_CASE( messages_of_any_size_are_received )
+{
+    std::vector< kd::buffer > const messages
+            { kd::buffer( 1, 'a' )
+            , kd::buffer( 60000, 'b' )
+            , kd::buffer( 2, 'c' )
+            , kd::buffer( 30000, 'd' )
+            , kd::buffer( 3, 'e' ) };
+
+    receive( messages.size() );
+    for ( auto const& m : messages )
+        send( m );
+
+    io_service_.run();
+
+    BOOST_REQUIRE( messages == received_messages_ );
+}
+
+BOOST_AUTO_TEST_CASE( pending_receive_is_aborted_on_close )
+{
+    kd::batched_udp_socket socket{ io_service_, boost::asio::ip::udp::v4() };
+    socket.bind( { boost::asio::ip::address_v4::loopback()
+                 , k::test::get_temporary_listening_port() } );
+
+    kd::buffer b( 16 );
+    kd::batched_udp_socket::endpoint_type sender;
+    boost::system::error_code failure;
+    socket.async_receive_from( boost::asio::buffer( b ), sender
+                             , [ &failure ]
+                               ( boost::system::error_code const& f
+                               , std::size_t )
+                               { failure = f; } );
+
+    boost::system::error_code ignored;
+    socket.close( ignored );
+    io_service_.run();
+
+    BOOST_REQUIRE( boost::asio::error::operation_aborted == failure );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "buffer_pool.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+namespace {
+
+BOOST_AUTO_TEST_SUITE( buffer_pool )
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_AUTO_TEST_CASE( shared_buffer_copies_share_the_same_buffer )
+{
+    kd::shared_buffer empty;
+    BOOST_REQUIRE( ! empty );
+    BOOST_REQUIRE_EQUAL( 0, empty.use_count() );
+
+    auto b1 = kd::shared_buffer::allocate( 16 );
+    BOOST_REQUIRE( b1 );
+    BOOST_REQUIRE_EQUAL( 16, b1->size() );
+    BOOST_REQUIRE_EQUAL( 1, b1.use_count() );
+
+    {
+        auto b2 = b1;
+        BOOST_REQUIRE_EQUAL( 2, b1.use_count() );
+        BOOST_REQUIRE_EQUAL( b1->data(), b2->data() );
+
+        auto b3 = std::move( b2 );
+        BOOST_REQUIRE( ! b2 );
+        BOOST_REQUIRE_EQUAL( 2, b3.use_count() );
+    }
+
+    BOOST_REQUIRE_EQUAL( 1, b1.use_count() );
+}
+
+BOOST_AUTO_TEST_CASE( released_buffers_are_recycled )
+{
+    auto pool = kd::buffer_pool::create( 64 );
+    BOOST_REQUIRE_EQUAL( 0, pool->cached_buffers_count() );
+
+    auto b1 = pool->acquire();
+    BOOST_REQUIRE_EQUAL( 64, b1->size() );
+    auto const data = b1->data();
+
+    b1 = kd::shared_buffer{};
+    BOOST_REQUIRE_EQUAL( 1, pool->cached_buffers_count() );
+
+    auto b2 = pool->acquire();
+    BOOST_REQUIRE_EQUAL( 0, pool->cached_buffers_count() );
+    BOOST_REQUIRE_EQUAL( data, b2->data() );
+}
+
+BOOST_AUTO_TEST_CASE( recycled_buffers_keep_their_capacity )
+{
+    auto pool = kd::buffer_pool::create( 0 );
+
+    auto b1 = pool->acquire();
+    BOOST_REQUIRE( b1->empty() );
+    b1->resize( 128 );
+    auto const data = b1->data();
+    b1 = kd::shared_buffer{};
+
+    auto b2 = pool->acquire();
+    BOOST_REQUIRE( b2->empty() );
+    BOOST_REQUIRE_GE( b2->capacity(), 128 );
+
+    b2->resize( 128 );
+    BOOST_REQUIRE_EQUAL( data, b2->data() );
+}
+
+BOOST_AUTO_TEST_CASE( cached_buffers_count_is_bounded )
+{
+    auto pool = kd::buffer_pool::create( 64, 2 );
+
+    {
+        std::vector< kd::shared_buffer > buffers;
+        for ( auto i = 0; i != 4; ++ i )
+            buffers.push_back( pool->acquire() );
+    }
+
+    BOOST_REQUIRE_EQUAL( 2, pool->cached_buffers_count() );
+}
+
+BOOST_AUTO_TEST_CASE( buffers_can_outlive_their_pool )
+{
+    auto pool = kd::buffer_pool::create( 64 );
+    auto b = pool->acquire();
+    pool.reset();
+
+    std::fill( b->begin(), b->end(), 0xff );
+    BOOST_REQUIRE_EQUAL( 1, b.use_count() );
+}
+
+BOOST_AUTO_TEST_CASE( buffers_can_be_released_concurrently )
+{
+    auto pool = kd::buffer_pool::create( 64 );
+
+    std::vector< std::thread > threads;
+    for ( auto i = 0; i != 4; ++ i )
+        threads.emplace_back( [ pool ] ( void )
+        {
+            for ( auto j = 0; j != 10000; ++ j )
+            {
+                auto b = pool->acquire();
+                auto copy = b;
+            }
+        } );
+
+    for ( auto & t : threads )
+        t.join();
+
+    BOOST_REQUIRE_LE( pool->cached_buffers_count(), 4 );
+}
+
+BOOST_AUTO_TEST_CASE( buffer_view_keeps_its_buffer_alive )
+{
+    auto pool = kd::buffer_pool::create( 64 );
+
+    kd::buffer_view view;
+    BOOST_REQUIRE( view.empty() );
+    BOOST_REQUIRE_EQUAL( 0, view.capacity() );
+
+    {
+        auto b = pool->acquire();
+        std::iota( b->begin(), b->end(), 0 );
+        view = kd::buffer_view{ b, b->begin() + 8, b->begin() + 40 };
+    }
+
+    BOOST_REQUIRE_EQUAL( 0, pool->cached_buffers_count() );
+    BOOST_REQUIRE_EQUAL( 32, view.size() );
+    BOOST_REQUIRE_EQUAL( 64, view.capacity() );
+    BOOST_REQUIRE_EQUAL( 8, *view.begin() );
+
+    view = kd::buffer_view{};
+    BOOST_REQUIRE_EQUAL( 1, pool->cached_buffers_count() );
+}
+
+BOOST_AUTO_TEST_CASE( buffer_view_compaction_copies_small_views )
+{
+    auto b = kd::shared_buffer::allocate( 64 );
+    std::iota( b->begin(), b->end(), 0 );
+
+    kd::buffer_view const large{ b, b->begin(), b->begin() + 32 };
+    auto const compacted_large = large.compact();
+    BOOST_REQUIRE( compacted_large.begin() == large.begin() );
+    BOOST_REQUIRE_EQUAL( 64, compacted_large.capacity() );
+
+    kd::buffer_view const small{ b, b->begin() + 4, b->begin() + 8 };
+    auto const compacted_small = small.compact();
+    BOOST_REQUIRE_EQUAL( 4, compacted_small.capacity() );
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( small.begin(), small.end()
+                                   , compacted_small.begin()
+                                   , compacted_small.end() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
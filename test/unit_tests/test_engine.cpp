@@ -23,10 +23,14 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <chrono>
 #include <memory>
+#include <set>
 
 #include <boost/asio/io_service.hpp>
 
+#include "constants.hpp"
+#include "message.hpp"
 #include "test_engine.hpp"
 
 #include "common.hpp"
@@ -37,8 +41,8 @@ namespace k = kademlia;
 namespace d = k::detail;
 namespace t = k::test;
 
-template<typename ... InitialPeer >
-std::unique_ptr< t::test_engine >
+template< typename EngineType = t::test_engine, typename ... InitialPeer >
+std::unique_ptr< EngineType >
 create_test_engine( boost::asio::io_service & io_service
                   , d::id const& id
                   , InitialPeer &&... initial_peer )
@@ -46,15 +50,43 @@ create_test_engine( boost::asio::io_service & io_service
     k::endpoint ipv4_endpoint{ "127.0.0.1", 27980 };
     k::endpoint ipv6_endpoint{ "::1", 27980 };
 
-    using engine_ptr = std::unique_ptr< t::test_engine >;
+    using engine_ptr = std::unique_ptr< EngineType >;
 
-    engine_ptr t{ new t::test_engine{ io_service
-                                    , std::forward< InitialPeer >( initial_peer )...
-                                    , ipv4_endpoint, ipv6_endpoint
-                                    , id } };
+    engine_ptr t{ new EngineType{ io_service
+                                , std::forward< InitialPeer >( initial_peer )...
+                                , ipv4_endpoint, ipv6_endpoint
+                                , id } };
     return t;
 }
 
+/**
+ *  Pop the logged packets, collecting the ids
+ *  looked up by the FIND_PEER requests.
+ */
+std::set< d::id >
+pop_looked_up_ids
+    ( void )
+{
+    std::set< d::id > ids;
+
+    for ( auto & packets = t::fake_socket::get_logged_packets()
+        ; ! packets.empty()
+        ; packets.pop() )
+    {
+        auto i = packets.front().data_.cbegin();
+        auto const e = packets.front().data_.cend();
+
+        d::header h;
+        d::find_peer_request_body body;
+        if ( ! deserialize( i, e, h )
+           && h.type_ == d::header::FIND_PEER_REQUEST
+           && ! deserialize( i, e, body ) )
+            ids.insert( body.peer_to_find_id_ );
+    }
+
+    return ids;
+}
+
 BOOST_AUTO_TEST_SUITE( engine )
 
 BOOST_AUTO_TEST_SUITE( test_usage )
@@ -114,6 +146,223 @@ BOOST_AUTO_TEST_CASE( two_engines_can_save_and_load )
     BOOST_REQUIRE_GT( io_service.poll(), 0 );
 }
 
+BOOST_AUTO_TEST_CASE( engines_store_values_within_their_budget )
+{
+    boost::asio::io_service io_service;
+
+    // The value store can hold 16 bytes.
+    k::session_configuration configuration;
+    configuration.max_stored_bytes_count( 16 );
+
+    d::id const id1{ "8000000000000000000000000000000000000000" };
+    t::test_engine e1{ io_service
+                     , k::endpoint{ "127.0.0.1", 27980 }
+                     , k::endpoint{ "::1", 27980 }
+                     , id1, configuration };
+
+    d::id const id2{ "4000000000000000000000000000000000000000" };
+    auto e2 = create_test_engine( io_service, id2, e1.ipv4() );
+
+    auto on_save = []( std::error_code const& failure )
+    { if ( failure ) throw std::system_error{ failure }; };
+    e2->async_save( "key", std::string( 100, 'a' ), on_save );
+
+    BOOST_REQUIRE_GT( io_service.poll(), 0 );
+
+    auto const s = e1.stored_values_statistics();
+    BOOST_REQUIRE_EQUAL( 0, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 0, s.evicted_values_count_ );
+    BOOST_REQUIRE_EQUAL( 1, s.rejected_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( republished_values_keep_their_expiration_time )
+{
+    boost::asio::io_service io_service;
+
+    // e1 saves values living 300 ms.
+    k::session_configuration publisher_configuration;
+    publisher_configuration.value_lifetime( std::chrono::milliseconds{ 300 } );
+
+    d::id const id1{ "8000000000000000000000000000000000000000" };
+    t::test_engine e1{ io_service
+                     , k::endpoint{ "127.0.0.1", 27980 }
+                     , k::endpoint{ "::1", 27980 }
+                     , id1, publisher_configuration };
+
+    // e2 republishes the values it stores every 20 ms.
+    k::session_configuration holder_configuration;
+    holder_configuration.value_republication_interval
+            ( std::chrono::milliseconds{ 20 } );
+
+    d::id const id2{ "4000000000000000000000000000000000000000" };
+    t::test_engine e2{ io_service, e1.ipv4()
+                     , k::endpoint{ "127.0.0.1", 27980 }
+                     , k::endpoint{ "::1", 27980 }
+                     , id2, holder_configuration };
+
+    auto on_save = []( std::error_code const& failure )
+    { if ( failure ) throw std::system_error{ failure }; };
+    e1.async_save( "key", "data", on_save );
+
+    BOOST_REQUIRE_GT( io_service.poll(), 0 );
+    BOOST_REQUIRE_EQUAL( 1, e2.stored_values_statistics().values_count_ );
+    t::clear_packets();
+
+    // e2 republished the value.
+    io_service.run_for( std::chrono::milliseconds{ 100 } );
+
+    std::size_t stores_count = 0;
+    while ( t::count_packets() > 0 )
+        if ( t::pop_packet().type() == d::header::STORE_REQUEST )
+            ++ stores_count;
+    BOOST_REQUIRE_GT( stores_count, 0 );
+
+    // Republications didn't extend the value lifetime.
+    io_service.run_for( std::chrono::milliseconds{ 300 } );
+
+    std::size_t failures_count = 0;
+    auto on_load = [ &failures_count ]( std::error_code const& failure
+                                      , std::string const& )
+    {
+        if ( failure != k::VALUE_NOT_FOUND )
+            throw std::runtime_error{ "Unexpected value" };
+        ++ failures_count;
+    };
+    e1.async_load( "key", on_load );
+    e2.async_load( "key", on_load );
+
+    BOOST_REQUIRE_GT( io_service.poll(), 0 );
+    BOOST_REQUIRE_EQUAL( 2, failures_count );
+}
+
+BOOST_AUTO_TEST_CASE( engines_can_load_through_disjoint_paths )
+{
+    boost::asio::io_service io_service;
+
+    d::id const id1{ "8000000000000000000000000000000000000000" };
+    auto e1 = create_test_engine( io_service, id1 );
+
+    d::id const id2{ "4000000000000000000000000000000000000000" };
+    auto e2 = create_test_engine( io_service, id2, e1->ipv4() );
+
+    d::id const id3{ "2000000000000000000000000000000000000000" };
+    auto e3 = create_test_engine( io_service, id3, e1->ipv4() );
+
+    k::session_configuration configuration;
+    configuration.disjoint_paths_count( 3 );
+
+    d::id const id4{ "1000000000000000000000000000000000000000" };
+    t::test_engine e4{ io_service, e1->ipv4()
+                     , k::endpoint{ "127.0.0.1", 27980 }
+                     , k::endpoint{ "::1", 27980 }
+                     , id4, configuration };
+
+    std::string const expected_data{ "data" };
+
+    auto on_save = [ &expected_data ]( std::error_code const& failure )
+    { if ( failure ) throw std::system_error{ failure }; };
+    e2->async_save( "key", expected_data, on_save );
+
+    BOOST_REQUIRE_GT( io_service.poll(), 0 );
+
+    std::size_t loads_count = 0;
+    auto on_load = [ &expected_data, &loads_count ]
+        ( std::error_code const& failure
+        , std::string const& actual_data )
+    {
+        if ( failure ) throw std::system_error{ failure };
+        if ( expected_data != actual_data )
+            throw std::runtime_error{ "Unexpected data" };
+        ++ loads_count;
+    };
+    e4.async_load( "key", on_load );
+
+    BOOST_REQUIRE_GT( io_service.poll(), 0 );
+    BOOST_REQUIRE_EQUAL( 1, loads_count );
+}
+
+BOOST_AUTO_TEST_CASE( idle_buckets_are_refreshed )
+{
+    boost::asio::io_service io_service;
+
+    d::id const id1{ "8000000000000000000000000000000000000000" };
+    auto e1 = create_test_engine( io_service, id1 );
+
+    d::id const id2{ "4000000000000000000000000000000000000000" };
+    auto e2 = create_test_engine( io_service, id2, e1->ipv4() );
+
+    d::id const id3{ "2000000000000000000000000000000000000000" };
+    auto e3 = create_test_engine( io_service, id3, e1->ipv4() );
+
+    // e4 knows a peer in each of its 3 farthest buckets,
+    // all idle after 200 ms.
+    k::session_configuration configuration;
+    configuration.bucket_refresh_interval( std::chrono::milliseconds{ 200 } );
+
+    d::id const id4{ "1000000000000000000000000000000000000000" };
+    t::test_engine e4{ io_service, e1->ipv4()
+                     , k::endpoint{ "127.0.0.1", 27980 }
+                     , k::endpoint{ "::1", 27980 }
+                     , id4, configuration };
+
+    io_service.poll();
+    t::clear_packets();
+
+    // The first round fires within 200 to 300 ms, the next
+    // one at least 200 ms later, each refreshing at most
+    // BUCKETS_REFRESH_ROUND_MAX_COUNT buckets.
+    io_service.run_for( std::chrono::milliseconds{ 350 } );
+    auto const first_round_ids = pop_looked_up_ids();
+    BOOST_REQUIRE_EQUAL( d::BUCKETS_REFRESH_ROUND_MAX_COUNT
+                       , first_round_ids.size() );
+
+    io_service.run_for( std::chrono::milliseconds{ 400 } );
+    auto const next_rounds_ids = pop_looked_up_ids();
+    BOOST_REQUIRE_GT( next_rounds_ids.size(), 0 );
+
+    // The bucket left idle by the first round has been refreshed.
+    std::set< std::size_t > refreshed_buckets;
+    for ( auto const& ids : { first_round_ids, next_rounds_ids } )
+        for ( auto const& i : ids )
+            refreshed_buckets.insert( d::common_prefix_length( i, id4 ) );
+    BOOST_REQUIRE( refreshed_buckets == ( std::set< std::size_t >{ 0, 1, 2 } ) );
+}
+
+BOOST_AUTO_TEST_CASE( tree_engines_can_save_and_load )
+{
+    boost::asio::io_service io_service;
+
+    d::id const id1{ "8000000000000000000000000000000000000000" };
+    auto e1 = create_test_engine< t::tree_test_engine >( io_service, id1 );
+
+    d::id const id2{ "4000000000000000000000000000000000000000" };
+    auto e2 = create_test_engine< t::tree_test_engine >( io_service, id2
+                                                       , e1->ipv4() );
+
+    std::string const expected_data{ "data" };
+
+    auto on_save = [ &expected_data ]( std::error_code const& failure )
+    { if ( failure ) throw std::system_error{ failure }; };
+    e1->async_save( "key", expected_data, on_save );
+
+    BOOST_REQUIRE_GT( io_service.poll(), 0 );
+
+    std::size_t loads_count = 0;
+    auto on_load = [ &expected_data, &loads_count ]
+        ( std::error_code const& failure
+        , std::string const& actual_data )
+    {
+        if ( failure ) throw std::system_error{ failure };
+        if ( expected_data != actual_data )
+            throw std::runtime_error{ "Unexpected data" };
+        ++ loads_count;
+    };
+    e2->async_load( "key", on_load );
+
+    BOOST_REQUIRE_GT( io_service.poll(), 0 );
+    BOOST_REQUIRE_EQUAL( 1, loads_count );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
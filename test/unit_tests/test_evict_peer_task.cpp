@@ -0,0 +1,176 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "common.hpp"
+#include "tracker_mock.hpp"
+
+#include <boost/asio/io_service.hpp>
+
+#include "id.hpp"
+#include "peer.hpp"
+#include "ip_endpoint.hpp"
+#include "constants.hpp"
+#include "routing_table.hpp"
+#include "evict_peer_task.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+using routing_table_type = kd::routing_table< kd::ip_endpoint >;
+
+struct fixture
+{
+    fixture
+        ( void )
+        : io_service_()
+        , tracker_( io_service_ )
+        , routing_table_( kd::id{}, 2 )
+        , p1_{ kd::id{ "10" }, kd::to_ip_endpoint( "192.168.1.1", 5555 ) }
+        , p2_{ kd::id{ "11" }, kd::to_ip_endpoint( "192.168.1.2", 5555 ) }
+        , p3_{ kd::id{ "12" }, kd::to_ip_endpoint( "192.168.1.3", 5555 ) }
+    {
+        // Fill the bucket of p1, p2 & p3 while
+        // another bucket is the largest one.
+        push( p1_ );
+        push( p2_ );
+        for ( auto const& i : { "20", "21", "22" } )
+            routing_table_.push( kd::id{ i }, p1_.endpoint_ );
+    }
+
+    void
+    push
+        ( kd::peer const& p )
+    { routing_table_.push( p.id_, p.endpoint_ ); }
+
+    bool
+    is_known
+        ( kd::peer const& p )
+    {
+        for ( auto i = routing_table_.find( p.id_ ), e = routing_table_.end()
+            ; i != e
+            ; ++ i )
+            if ( i->first == p.id_ )
+                return true;
+
+        return false;
+    }
+
+    boost::asio::io_service io_service_;
+    k::test::tracker_mock tracker_;
+    routing_table_type routing_table_;
+    kd::peer const p1_;
+    kd::peer const p2_;
+    kd::peer const p3_;
+};
+
+BOOST_AUTO_TEST_SUITE( evict_peer_task )
+
+BOOST_FIXTURE_TEST_SUITE( test_usage, fixture )
+
+BOOST_AUTO_TEST_CASE( replaces_the_oldest_peer_if_it_fails_to_answer )
+{
+    // p3 is kept as a replacement.
+    push( p3_ );
+    kd::start_evict_peer_task( p3_, tracker_, routing_table_ );
+    io_service_.poll();
+
+    // Task pinged p1, the least recently seen peer, until it gave up.
+    for ( std::size_t i = 0; i != kd::EVICTION_PINGS_COUNT; ++ i )
+        BOOST_REQUIRE( tracker_.has_sent_message( p1_.endpoint_
+                                                , kd::header::PING_REQUEST ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE( ! is_known( p1_ ) );
+    BOOST_REQUIRE( is_known( p2_ ) );
+    BOOST_REQUIRE( is_known( p3_ ) );
+    BOOST_REQUIRE_EQUAL( 5, routing_table_.peer_count() );
+}
+
+BOOST_AUTO_TEST_CASE( keeps_the_oldest_peer_if_it_answers )
+{
+    // Any response proves p1 is alive.
+    tracker_.add_message_to_receive( p1_.endpoint_
+                                   , p1_.id_
+                                   , kd::find_peer_response_body{} );
+
+    kd::start_evict_peer_task( p3_, tracker_, routing_table_ );
+    io_service_.poll();
+
+    BOOST_REQUIRE( tracker_.has_sent_message( p1_.endpoint_
+                                            , kd::header::PING_REQUEST ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE( is_known( p1_ ) );
+    BOOST_REQUIRE( ! is_known( p3_ ) );
+
+    // The bucket can be pinged again.
+    kd::start_evict_peer_task( p3_, tracker_, routing_table_ );
+    BOOST_REQUIRE( tracker_.has_sent_message( p1_.endpoint_
+                                            , kd::header::PING_REQUEST ) );
+}
+
+BOOST_AUTO_TEST_CASE( keeps_the_oldest_peer_if_it_answers_the_retry )
+{
+    // The first ping fails, the retry is answered.
+    kd::start_evict_peer_task( p3_, tracker_, routing_table_ );
+    tracker_.add_message_to_receive( p1_.endpoint_
+                                   , p1_.id_
+                                   , kd::find_peer_response_body{} );
+    io_service_.poll();
+
+    for ( std::size_t i = 0; i != 2; ++ i )
+        BOOST_REQUIRE( tracker_.has_sent_message( p1_.endpoint_
+                                                , kd::header::PING_REQUEST ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE( is_known( p1_ ) );
+    BOOST_REQUIRE( ! is_known( p3_ ) );
+}
+
+BOOST_AUTO_TEST_CASE( pings_the_oldest_peer_once )
+{
+    kd::start_evict_peer_task( p3_, tracker_, routing_table_ );
+    kd::start_evict_peer_task( p3_, tracker_, routing_table_ );
+
+    BOOST_REQUIRE( tracker_.has_sent_message( p1_.endpoint_
+                                            , kd::header::PING_REQUEST ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+}
+
+BOOST_AUTO_TEST_CASE( ignores_peers_of_buckets_with_room )
+{
+    kd::peer const p4{ kd::id{ "40" }, kd::to_ip_endpoint( "192.168.1.4", 5555 ) };
+    kd::start_evict_peer_task( p4, tracker_, routing_table_ );
+
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+
@@ -26,6 +26,7 @@
 #include "common.hpp"
 #include "task_fixture.hpp"
 
+#include <chrono>
 #include <vector>
 #include <utility>
 
@@ -302,6 +303,231 @@ BOOST_AUTO_TEST_CASE( can_return_value_when_discovered_peer_has_the_value )
                                    , data_.begin(), data_.end() );
 }
 
+BOOST_AUTO_TEST_CASE( sends_the_configured_concurrent_requests_count )
+{
+    kd::id const searched_key{ "a" };
+    routing_table_.expected_ids_.emplace_back( searched_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "a" } );
+    create_and_add_peer( "192.168.1.2", kd::id{ "b" } );
+    create_and_add_peer( "192.168.1.3", kd::id{ "c" } );
+
+    k::session_configuration configuration;
+    configuration.concurrent_requests_count( 1 );
+
+    kd::start_find_value_task< data_type >( searched_key
+                                          , tracker_
+                                          , routing_table_
+                                          , std::ref( *this )
+                                          , configuration );
+
+    // Task only asked the closest peer.
+    kd::find_value_request_body const fv{ searched_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+}
+
+BOOST_AUTO_TEST_CASE( hedges_slow_requests_and_accepts_their_late_response )
+{
+    kd::id const searched_key{ "a" };
+    routing_table_.expected_ids_.emplace_back( searched_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "a" } );
+    auto p2 = create_and_add_peer( "192.168.1.2", kd::id{ "b" } );
+
+    // p1 is slow but knows the value.
+    kd::find_value_response_body const fv1{ { 1, 2, 3, 4 } };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fv1
+                                   , std::chrono::milliseconds{ 50 } );
+    // p2 answers at once without the value.
+    kd::find_peer_response_body const fp2{};
+    tracker_.add_message_to_receive( p2.endpoint_, p2.id_, fp2 );
+
+    k::session_configuration configuration;
+    configuration.concurrent_requests_count( 1 );
+    configuration.hedged_requests_percentile( 0.95 );
+    tracker_.set_request_soft_timeout( std::chrono::milliseconds{ 5 } );
+
+    kd::start_find_value_task< data_type >( searched_key
+                                          , tracker_
+                                          , routing_table_
+                                          , std::ref( *this )
+                                          , configuration );
+    io_service_.poll();
+
+    // Task only asked the closest peer.
+    kd::find_value_request_body const fv{ searched_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    // Once p1 is late, p2 is asked too.
+    while ( ! tracker_.has_sent_message() )
+        io_service_.run_one();
+    BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, fv ) );
+    BOOST_REQUIRE_EQUAL( 0, callback_call_count_ );
+
+    // p2 didn't know the value, hence the task waits for p1.
+    while ( callback_call_count_ == 0 )
+        io_service_.run_one();
+
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( fv1.data_.begin(), fv1.data_.end()
+                                   , data_.begin(), data_.end() );
+}
+
+BOOST_AUTO_TEST_CASE( cancels_the_soft_deadline_of_answered_requests )
+{
+    kd::id const searched_key{ "a" };
+    routing_table_.expected_ids_.emplace_back( searched_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "a" } );
+
+    kd::find_value_response_body const fv1{ { 1, 2, 3, 4 } };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fv1 );
+
+    k::session_configuration configuration;
+    configuration.hedged_requests_percentile( 0.95 );
+    tracker_.set_request_soft_timeout( std::chrono::hours{ 1 } );
+
+    kd::start_find_value_task< data_type >( searched_key
+                                          , tracker_
+                                          , routing_table_
+                                          , std::ref( *this )
+                                          , configuration );
+    io_service_.poll();
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+
+    // p1 answered hence its soft deadline is gone.
+    BOOST_REQUIRE_EQUAL( 0, tracker_.pending_timeouts_count() );
+}
+
+BOOST_AUTO_TEST_CASE( does_not_hedge_requests_by_default )
+{
+    kd::id const searched_key{ "a" };
+    routing_table_.expected_ids_.emplace_back( searched_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "a" } );
+    create_and_add_peer( "192.168.1.2", kd::id{ "b" } );
+
+    kd::find_value_response_body const fv1{ { 1, 2, 3, 4 } };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fv1
+                                   , std::chrono::milliseconds{ 20 } );
+
+    k::session_configuration configuration;
+    configuration.concurrent_requests_count( 1 );
+    tracker_.set_request_soft_timeout( std::chrono::milliseconds{ 1 } );
+
+    kd::start_find_value_task< data_type >( searched_key
+                                          , tracker_
+                                          , routing_table_
+                                          , std::ref( *this )
+                                          , configuration );
+
+    while ( callback_call_count_ == 0 )
+        io_service_.run_one();
+
+    // Task only asked the closest peer.
+    kd::find_value_request_body const fv{ searched_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+    BOOST_REQUIRE( ! failure_ );
+}
+
+BOOST_AUTO_TEST_CASE( follows_disjoint_paths_without_sharing_peers )
+{
+    kd::id const searched_key{ "0" };
+    routing_table_.expected_ids_.emplace_back( searched_key );
+
+    // p1 & p3 are dealt to the first path, p2 & p4 to the second one.
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "1" } );
+    auto p2 = create_and_add_peer( "192.168.1.2", kd::id{ "2" } );
+    auto p3 = create_and_add_peer( "192.168.1.3", kd::id{ "3" } );
+    auto p4 = create_and_add_peer( "192.168.1.4", kd::id{ "4" } );
+
+    // p5 is unknown atm.
+    auto p5 = create_peer( "192.168.1.5", kd::id{ "5" } );
+
+    // p1 knows p2, already queried by the second path, and p5.
+    kd::find_peer_response_body const fp1{ { p2, p5 } };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fp1 );
+
+    // p2 doesn't know closer peer.
+    tracker_.add_message_to_receive( p2.endpoint_
+                                   , p2.id_
+                                   , kd::find_peer_response_body{} );
+
+    k::session_configuration configuration;
+    configuration.concurrent_requests_count( 1 );
+    configuration.disjoint_paths_count( 2 );
+
+    kd::start_find_value_task< data_type >( searched_key
+                                          , tracker_
+                                          , routing_table_
+                                          , std::ref( *this )
+                                          , configuration );
+    io_service_.poll();
+
+    // Task queried routing table to find closest known peers.
+    BOOST_REQUIRE_EQUAL( 1, routing_table_.find_call_count_ );
+
+    // Each peer has been asked once, by a single path.
+    kd::find_value_request_body const fv{ searched_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, fv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p3.endpoint_, fv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p4.endpoint_, fv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p5.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    // Task notified the error once both paths converged.
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( failure_ == k::VALUE_NOT_FOUND );
+}
+
+BOOST_AUTO_TEST_CASE( returns_the_value_found_by_any_disjoint_path )
+{
+    kd::id const searched_key{ "0" };
+    routing_table_.expected_ids_.emplace_back( searched_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "1" } );
+    auto p2 = create_and_add_peer( "192.168.1.2", kd::id{ "2" } );
+
+    // p1 is stalling the first path.
+    tracker_.add_message_to_receive( p1.endpoint_
+                                   , p1.id_
+                                   , kd::find_peer_response_body{}
+                                   , std::chrono::milliseconds{ 50 } );
+
+    // p2 knows the value.
+    kd::find_value_response_body const fv2{ { 1, 2, 3, 4 } };
+    tracker_.add_message_to_receive( p2.endpoint_, p2.id_, fv2 );
+
+    k::session_configuration configuration;
+    configuration.disjoint_paths_count( 2 );
+
+    kd::start_find_value_task< data_type >( searched_key
+                                          , tracker_
+                                          , routing_table_
+                                          , std::ref( *this )
+                                          , configuration );
+    io_service_.poll();
+
+    kd::find_value_request_body const fv{ searched_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    // Task didn't wait for p1 to notify the success.
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( fv2.data_.begin(), fv2.data_.end()
+                                   , data_.begin(), data_.end() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
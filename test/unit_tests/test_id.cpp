@@ -237,6 +237,56 @@ BOOST_AUTO_TEST_CASE( id_distance_can_be_evaluated )
         BOOST_REQUIRE_LT( kd::distance( id1, id2 )
                         , kd::distance( id1, id3 ) );
     }
+    {
+        kd::id const id1{ "f0000000000000000000000000000000000000f0" };
+        kd::id const id2{ "0f0000000000000000000000000000000000000f" };
+
+        BOOST_REQUIRE_EQUAL( kd::id{ "ff000000000000000000000000000000000000ff" }
+                           , kd::distance( id1, id2 ) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( id_can_be_sorted_across_words )
+{
+    BOOST_REQUIRE_LT( kd::id{ "ffffffffffffffff" }
+                    , kd::id{ "10000000000000000" } );
+    BOOST_REQUIRE_LT( kd::id{ "ffffffffffffffffffffffffffffffff" }
+                    , kd::id{ "100000000000000000000000000000000" } );
+    BOOST_REQUIRE( ! ( kd::id{ "1" } < kd::id{ "1" } ) );
+}
+
+BOOST_AUTO_TEST_CASE( id_common_prefix_length_can_be_evaluated )
+{
+    kd::id const zero;
+
+    BOOST_REQUIRE_EQUAL( kd::id::BIT_SIZE
+                       , kd::common_prefix_length( zero, zero ) );
+    BOOST_REQUIRE_EQUAL( 0
+                       , kd::common_prefix_length( zero
+                                                 , kd::id{ "8000000000000000000000000000000000000000" } ) );
+    BOOST_REQUIRE_EQUAL( 63
+                       , kd::common_prefix_length( zero
+                                                 , kd::id{ "0000000000000001000000000000000000000000" } ) );
+    BOOST_REQUIRE_EQUAL( 64
+                       , kd::common_prefix_length( zero
+                                                 , kd::id{ "0000000000000000800000000000000000000000" } ) );
+    BOOST_REQUIRE_EQUAL( kd::id::BIT_SIZE - 1
+                       , kd::common_prefix_length( zero, kd::id{ "1" } ) );
+
+    // Compare with the bit by bit definition.
+    std::default_random_engine random_engine;
+    for ( std::size_t i = 0; i != 64; ++ i )
+    {
+        kd::id const a{ random_engine };
+        kd::id b{ a };
+        b[ i * 2 ] = ! b[ i * 2 ];
+
+        std::size_t expected = 0;
+        while ( expected != kd::id::BIT_SIZE && a[ expected ] == b[ expected ] )
+            ++ expected;
+
+        BOOST_REQUIRE_EQUAL( expected, kd::common_prefix_length( a, b ) );
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
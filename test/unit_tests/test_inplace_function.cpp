@@ -0,0 +1,106 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "common.hpp"
+
+#include <memory>
+#include <string>
+
+#include "inplace_function.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+BOOST_AUTO_TEST_SUITE( inplace_function )
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_AUTO_TEST_CASE( is_empty_when_default_constructed )
+{
+    kd::inplace_function< void ( void ) > f;
+    BOOST_REQUIRE( ! f );
+}
+
+BOOST_AUTO_TEST_CASE( small_callables_are_stored_inplace )
+{
+    using function = kd::inplace_function< int ( int ), 32 >;
+
+    auto increment = [] ( int i ) { return i + 1; };
+    BOOST_REQUIRE( function::is_stored_inplace< decltype( increment ) >() );
+
+    function f{ increment };
+    BOOST_REQUIRE( f );
+    BOOST_REQUIRE_EQUAL( 2, f( 1 ) );
+}
+
+BOOST_AUTO_TEST_CASE( big_callables_are_stored_on_the_heap )
+{
+    using function = kd::inplace_function< std::size_t ( void ), 16 >;
+
+    std::string const s( 1000, 'a' );
+    auto size = [ s ] ( void ) { return s.size() + sizeof( s ); };
+    BOOST_REQUIRE( ! function::is_stored_inplace< decltype( size ) >() );
+
+    function f{ size };
+    BOOST_REQUIRE_EQUAL( 1000 + sizeof( s ), f() );
+}
+
+BOOST_AUTO_TEST_CASE( captures_are_moved_and_destroyed )
+{
+    auto counter = std::make_shared< int >( 0 );
+
+    {
+        kd::inplace_function< void ( void ) > f{ [ counter ] ( void ) { ++ *counter; } };
+        BOOST_REQUIRE_EQUAL( 2, counter.use_count() );
+
+        auto g = std::move( f );
+        BOOST_REQUIRE( ! f );
+        BOOST_REQUIRE_EQUAL( 2, counter.use_count() );
+
+        g();
+        BOOST_REQUIRE_EQUAL( 1, *counter );
+
+        g = nullptr;
+        BOOST_REQUIRE_EQUAL( 1, counter.use_count() );
+    }
+
+    BOOST_REQUIRE_EQUAL( 1, counter.use_count() );
+}
+
+BOOST_AUTO_TEST_CASE( move_only_callables_are_supported )
+{
+    auto value = std::unique_ptr< int >( new int{ 42 } );
+    kd::inplace_function< int ( void ) > f{ [ value = std::move( value ) ] ( void )
+                                          { return *value; } };
+    BOOST_REQUIRE_EQUAL( 42, f() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+
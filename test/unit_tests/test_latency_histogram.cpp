@@ -0,0 +1,100 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "common.hpp"
+
+#include <chrono>
+
+#include "latency_histogram.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+using us = std::chrono::microseconds;
+using ms = std::chrono::milliseconds;
+
+BOOST_AUTO_TEST_SUITE( latency_histogram )
+
+BOOST_AUTO_TEST_CASE( is_empty_when_constructed )
+{
+    kd::latency_histogram h;
+    BOOST_REQUIRE_EQUAL( 0, h.size() );
+    BOOST_REQUIRE( h.percentile( 0.5 ) == kd::latency_histogram::duration::zero() );
+}
+
+BOOST_AUTO_TEST_CASE( percentiles_bound_the_recorded_latencies )
+{
+    kd::latency_histogram h;
+    for ( auto i = 1; i <= 100; ++ i )
+        h.record( ms{ i } );
+
+    BOOST_REQUIRE_EQUAL( 100, h.size() );
+
+    // Percentiles are known within a bucket width (25%).
+    auto const p50 = h.percentile( 0.5 );
+    BOOST_REQUIRE( p50 >= ms{ 50 } && p50 <= ms{ 63 } );
+    auto const p99 = h.percentile( 0.99 );
+    BOOST_REQUIRE( p99 >= ms{ 99 } && p99 <= ms{ 124 } );
+    BOOST_REQUIRE( h.percentile( 0. ) <= ms{ 2 } );
+    BOOST_REQUIRE( h.percentile( 1. ) >= ms{ 100 } );
+}
+
+BOOST_AUTO_TEST_CASE( small_latencies_are_exact )
+{
+    kd::latency_histogram h;
+    h.record( us{ 0 } );
+    h.record( us{ 3 } );
+
+    BOOST_REQUIRE( h.percentile( 0. ) == us{ 1 } );
+    BOOST_REQUIRE( h.percentile( 1. ) == us{ 4 } );
+}
+
+BOOST_AUTO_TEST_CASE( huge_latencies_share_the_last_bucket )
+{
+    kd::latency_histogram h;
+    h.record( std::chrono::hours{ 1 } );
+
+    BOOST_REQUIRE( h.percentile( 1. ) >= std::chrono::seconds{ 60 } );
+}
+
+BOOST_AUTO_TEST_CASE( old_samples_fade_away )
+{
+    kd::latency_histogram h;
+    for ( std::size_t i = 0; i != kd::latency_histogram::DECAY_THRESHOLD; ++ i )
+        h.record( ms{ 500 } );
+
+    BOOST_REQUIRE( h.size() < kd::latency_histogram::DECAY_THRESHOLD );
+
+    for ( std::size_t i = 0; i != 4 * kd::latency_histogram::DECAY_THRESHOLD; ++ i )
+        h.record( ms{ 10 } );
+
+    BOOST_REQUIRE( h.percentile( 0.95 ) < ms{ 13 } );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
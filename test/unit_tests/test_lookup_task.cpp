@@ -42,8 +42,18 @@ struct test_task : kd::lookup_task {
     template< typename Iterator >
     test_task
         ( kd::id const& key
-        , Iterator i, Iterator e )
-        : lookup_task{ key, i, e }
+        , Iterator i, Iterator e
+        , std::size_t closest_count = 20 )
+        : lookup_task{ key, i, e, closest_count }
+    { }
+
+    template< typename Iterator >
+    test_task
+        ( kd::id const& key
+        , Iterator i, Iterator e
+        , std::size_t closest_count
+        , std::size_t max_candidates_count )
+        : lookup_task{ key, i, e, closest_count, max_candidates_count }
     { }
 };
 
@@ -119,6 +129,163 @@ BOOST_AUTO_TEST_CASE( can_select_candidates )
     BOOST_REQUIRE_EQUAL( kd::id{ "6" }, closest_candidates[ 1 ].id_ );
 }
 
+BOOST_AUTO_TEST_CASE( slow_candidates_are_not_in_flight_anymore )
+{
+    std::vector< routing_table_peer > candidates;
+    kd::ip_endpoint const default_address{};
+    candidates.emplace_back( kd::id{ "1" }, default_address );
+    candidates.emplace_back( kd::id{ "2" }, default_address );
+    candidates.emplace_back( kd::id{ "3" }, default_address );
+    kd::id const key{};
+    test_task c{ key, candidates.begin(), candidates.end() };
+
+    // Only contacted candidates can be slow.
+    BOOST_REQUIRE( ! c.flag_candidate_as_slow( kd::id{ "1" } ) );
+
+    auto closest_candidates = c.select_new_closest_candidates( 1 );
+    BOOST_REQUIRE_EQUAL( 1, closest_candidates.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "1" }, closest_candidates[ 0 ].id_ );
+    BOOST_REQUIRE( c.flag_candidate_as_slow( kd::id{ "1" } ) );
+    BOOST_REQUIRE( ! c.flag_candidate_as_slow( kd::id{ "1" } ) );
+
+    // Hence another candidate can be selected.
+    closest_candidates = c.select_new_closest_candidates( 1 );
+    BOOST_REQUIRE_EQUAL( 1, closest_candidates.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, closest_candidates[ 0 ].id_ );
+
+    // But the slow request is still pending.
+    c.flag_candidate_as_invalid( kd::id{ "2" } );
+    BOOST_REQUIRE( ! c.have_all_requests_completed() );
+
+    // Until it responds.
+    c.flag_candidate_as_valid( kd::id{ "1" } );
+    BOOST_REQUIRE( c.have_all_requests_completed() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "1" }
+                       , c.select_closest_valid_candidates( 1 )[ 0 ].id_ );
+}
+
+BOOST_AUTO_TEST_CASE( converges_once_the_closest_candidates_responded )
+{
+    std::vector< routing_table_peer > candidates;
+    kd::ip_endpoint const default_address{};
+    candidates.emplace_back( kd::id{ "1" }, default_address );
+    candidates.emplace_back( kd::id{ "2" }, default_address );
+    candidates.emplace_back( kd::id{ "3" }, default_address );
+    candidates.emplace_back( kd::id{ "4" }, default_address );
+    kd::id const key{};
+    test_task c{ key, candidates.begin(), candidates.end(), 2 };
+
+    BOOST_REQUIRE( ! c.is_converged() );
+
+    // Only the 2 closest candidates are selected.
+    auto closest_candidates = c.select_new_closest_candidates( 3 );
+    BOOST_REQUIRE_EQUAL( 2, closest_candidates.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "1" }, closest_candidates[ 0 ].id_ );
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, closest_candidates[ 1 ].id_ );
+
+    c.flag_candidate_as_valid( kd::id{ "1" } );
+    BOOST_REQUIRE( ! c.is_converged() );
+
+    // A failing candidate is replaced by the next closest one.
+    c.flag_candidate_as_invalid( kd::id{ "2" } );
+    BOOST_REQUIRE( ! c.is_converged() );
+    closest_candidates = c.select_new_closest_candidates( 3 );
+    BOOST_REQUIRE_EQUAL( 1, closest_candidates.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "3" }, closest_candidates[ 0 ].id_ );
+
+    c.flag_candidate_as_valid( kd::id{ "3" } );
+    BOOST_REQUIRE( c.is_converged() );
+    BOOST_REQUIRE_EQUAL( 0, c.select_new_closest_candidates( 3 ).size() );
+}
+
+BOOST_AUTO_TEST_CASE( keeps_only_the_closest_candidates )
+{
+    std::vector< routing_table_peer > candidates;
+    kd::id const key{};
+    test_task c{ key, candidates.begin(), candidates.end(), 1 };
+
+    // Twice closest_count candidates are kept, "4" is dropped.
+    std::vector< kd::peer > new_candidates;
+    new_candidates.emplace_back( create_peer( kd::id{ "4" } ) );
+    new_candidates.emplace_back( create_peer( kd::id{ "3" } ) );
+    new_candidates.emplace_back( create_peer( kd::id{ "2" } ) );
+    c.add_candidates( new_candidates );
+
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, c.select_new_closest_candidates( 1 )[ 0 ].id_ );
+    c.flag_candidate_as_invalid( kd::id{ "2" } );
+    BOOST_REQUIRE_EQUAL( kd::id{ "3" }, c.select_new_closest_candidates( 1 )[ 0 ].id_ );
+    c.flag_candidate_as_invalid( kd::id{ "3" } );
+
+    BOOST_REQUIRE_EQUAL( 0, c.select_new_closest_candidates( 1 ).size() );
+    BOOST_REQUIRE( c.have_all_requests_completed() );
+    BOOST_REQUIRE( c.is_converged() );
+}
+
+BOOST_AUTO_TEST_CASE( candidates_count_can_be_configured )
+{
+    std::vector< routing_table_peer > candidates;
+    kd::ip_endpoint const default_address{};
+    candidates.emplace_back( kd::id{ "5" }, default_address );
+    candidates.emplace_back( kd::id{ "1" }, default_address );
+    candidates.emplace_back( kd::id{ "4" }, default_address );
+    candidates.emplace_back( kd::id{ "2" }, default_address );
+    candidates.emplace_back( kd::id{ "3" }, default_address );
+    candidates.emplace_back( kd::id{ "1" }, default_address );
+    kd::id const key{};
+    test_task c{ key, candidates.begin(), candidates.end(), 1, 3 };
+
+    // Only "1", "2" & "3" are kept, once.
+    for ( auto const& expected : { kd::id{ "1" }, kd::id{ "2" }, kd::id{ "3" } } )
+    {
+        auto const selected = c.select_new_closest_candidates( 1 );
+        BOOST_REQUIRE_EQUAL( 1, selected.size() );
+        BOOST_REQUIRE_EQUAL( expected, selected[ 0 ].id_ );
+        c.flag_candidate_as_invalid( expected );
+    }
+
+    BOOST_REQUIRE_EQUAL( 0, c.select_new_closest_candidates( 1 ).size() );
+}
+
+BOOST_AUTO_TEST_CASE( keeps_at_least_the_closest_count_candidates )
+{
+    std::vector< routing_table_peer > candidates;
+    kd::ip_endpoint const default_address{};
+    candidates.emplace_back( kd::id{ "3" }, default_address );
+    candidates.emplace_back( kd::id{ "1" }, default_address );
+    candidates.emplace_back( kd::id{ "2" }, default_address );
+    kd::id const key{};
+    test_task c{ key, candidates.begin(), candidates.end(), 2, 1 };
+
+    // Only "1" & "2" are kept.
+    BOOST_REQUIRE_EQUAL( 2, c.select_new_closest_candidates( 3 ).size() );
+    BOOST_REQUIRE_EQUAL( 0, c.select_new_closest_candidates( 3 ).size() );
+}
+
+BOOST_AUTO_TEST_CASE( dropped_candidates_requests_are_forgotten )
+{
+    std::vector< routing_table_peer > candidates;
+    kd::ip_endpoint const default_address{};
+    candidates.emplace_back( kd::id{ "3" }, default_address );
+    kd::id const key{};
+    test_task c{ key, candidates.begin(), candidates.end(), 1 };
+
+    BOOST_REQUIRE_EQUAL( 1, c.select_new_closest_candidates( 1 ).size() );
+    BOOST_REQUIRE( ! c.have_all_requests_completed() );
+
+    // Closer candidates push "3" out while it's contacted.
+    std::vector< kd::peer > new_candidates;
+    new_candidates.emplace_back( create_peer( kd::id{ "2" } ) );
+    new_candidates.emplace_back( create_peer( kd::id{ "1" } ) );
+    c.add_candidates( new_candidates );
+    BOOST_REQUIRE( c.have_all_requests_completed() );
+
+    // Its late response is ignored.
+    c.flag_candidate_as_valid( kd::id{ "3" } );
+    BOOST_REQUIRE( c.have_all_requests_completed() );
+    BOOST_REQUIRE( ! c.is_converged() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "1" }, c.select_new_closest_candidates( 1 )[ 0 ].id_ );
+}
+
 BOOST_AUTO_TEST_CASE( can_add_candidates )
 {
     std::vector< routing_table_peer > candidates;
@@ -27,6 +27,8 @@
 
 #include "common.hpp"
 
+#include <cstdint>
+#include <iterator>
 #include <random>
 #include <kademlia/error.hpp>
 
@@ -307,7 +309,8 @@ BOOST_AUTO_TEST_CASE( can_serialize_store_value_request_body )
 
     kd::store_value_request_body body_out
             { kd::id{ random_engine }
-            , std::vector< std::uint8_t >( 4096 ) };
+            , std::vector< std::uint8_t >( 4096 )
+            , std::chrono::hours{ 24 } };
 
     std::generate( body_out.data_value_.begin()
                  , body_out.data_value_.end()
@@ -330,6 +333,8 @@ BOOST_AUTO_TEST_CASE( can_serialize_store_value_request_body )
                                    , body_out.data_value_.end()
                                    , body_in.data_value_.begin()
                                    , body_in.data_value_.end() );
+
+    BOOST_REQUIRE( body_out.data_lifetime_ == body_in.data_lifetime_ );
 }
 
 BOOST_AUTO_TEST_CASE( can_detect_corrupted_store_value_request_body )
@@ -338,7 +343,8 @@ BOOST_AUTO_TEST_CASE( can_detect_corrupted_store_value_request_body )
 
     kd::store_value_request_body body_out
             { kd::id{ random_engine }
-            , std::vector< std::uint8_t >( 4096 ) };
+            , std::vector< std::uint8_t >( 4096 )
+            , std::chrono::hours{ 24 } };
 
     std::generate( body_out.data_value_.begin()
                  , body_out.data_value_.end()
@@ -347,12 +353,104 @@ BOOST_AUTO_TEST_CASE( can_detect_corrupted_store_value_request_body )
     kd::buffer buffer;
     kd::serialize( body_out, buffer );
 
+    // The lifetime is optional, hence only its truncation
+    // and the truncation of the fields before are detected.
+    auto const value_end = std::prev( buffer.cend(), sizeof( std::uint64_t ) );
+
     kd::store_value_request_body body_in;
     auto b = buffer.cbegin(), e = buffer.cend();
     while ( b != e )
     {
         auto i = b;
-        BOOST_REQUIRE( kd::deserialize( i, --e, body_in ) );
+        -- e;
+        if ( e != value_end )
+            BOOST_REQUIRE( kd::deserialize( i, e, body_in ) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( can_deserialize_store_value_request_without_lifetime )
+{
+    std::default_random_engine random_engine;
+
+    kd::store_value_request_body body_out
+            { kd::id{ random_engine }
+            , std::vector< std::uint8_t >( 4096 )
+            , std::chrono::hours{ 24 } };
+
+    std::generate( body_out.data_value_.begin()
+                 , body_out.data_value_.end()
+                 , std::rand );
+
+    // Peers predating the lifetime end the request with the value.
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+    buffer.resize( buffer.size() - sizeof( std::uint64_t ) );
+
+    kd::store_value_request_body body_in;
+    auto i = buffer.cbegin(), e = buffer.cend();
+    BOOST_REQUIRE( ! kd::deserialize( i, e, body_in ) );
+    BOOST_REQUIRE( i == e );
+
+    BOOST_REQUIRE( body_out.data_key_hash_ == body_in.data_key_hash_ );
+    BOOST_REQUIRE( body_out.data_value_ == body_in.data_value_ );
+    BOOST_REQUIRE( body_in.data_lifetime_ == std::chrono::milliseconds::max() );
+
+    auto message = kd::shared_buffer::allocate( buffer.size() );
+    std::copy( buffer.begin(), buffer.end(), message->begin() );
+
+    kd::store_value_request_view view_in;
+    kd::buffer::const_iterator j = message->begin(), f = message->end();
+    BOOST_REQUIRE( ! kd::deserialize( message, j, f, view_in ) );
+    BOOST_REQUIRE( j == f );
+    BOOST_REQUIRE( view_in.data_lifetime_ == std::chrono::milliseconds::max() );
+}
+
+BOOST_AUTO_TEST_CASE( can_deserialize_store_value_request_as_view )
+{
+    std::default_random_engine random_engine;
+
+    kd::store_value_request_body body_out
+            { kd::id{ random_engine }
+            , std::vector< std::uint8_t >( 4096 )
+            , std::chrono::hours{ 24 } };
+
+    std::generate( body_out.data_value_.begin()
+                 , body_out.data_value_.end()
+                 , std::rand );
+
+    kd::buffer serialized;
+    kd::serialize( body_out, serialized );
+
+    auto message = kd::shared_buffer::allocate( serialized.size() );
+    std::copy( serialized.begin(), serialized.end(), message->begin() );
+
+    kd::store_value_request_view body_in;
+    kd::buffer::const_iterator i = message->begin(), e = message->end();
+    BOOST_REQUIRE( ! kd::deserialize( message, i, e, body_in ) );
+    BOOST_REQUIRE( i == e );
+
+    BOOST_REQUIRE( body_out.data_key_hash_ == body_in.data_key_hash_ );
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( body_out.data_value_.begin()
+                                   , body_out.data_value_.end()
+                                   , body_in.data_value_.begin()
+                                   , body_in.data_value_.end() );
+    BOOST_REQUIRE( body_out.data_lifetime_ == body_in.data_lifetime_ );
+
+    // The value refers to the message rather than to a copy.
+    BOOST_REQUIRE( body_in.data_value_.end()
+                 == std::prev( message->cend(), sizeof( std::uint64_t ) ) );
+    BOOST_REQUIRE_EQUAL( 2, message.use_count() );
+
+    // Truncated message are detected, but for
+    // the one ending with the value.
+    auto b = message->cbegin();
+    auto const value_end = std::prev( e, sizeof( std::uint64_t ) );
+    while ( b != e )
+    {
+        auto j = b;
+        -- e;
+        if ( e != value_end )
+            BOOST_REQUIRE( kd::deserialize( message, j, e, body_in ) );
     }
 }
 
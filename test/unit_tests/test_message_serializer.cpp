@@ -62,7 +62,7 @@ BOOST_AUTO_TEST_CASE( can_serialize_a_message_with_a_body )
     kd::find_peer_request_body const expected{ searched_id };
     auto const b = s.serialize( expected, token );
 
-    auto i = std::begin( b ), e = std::end( b );
+    kd::buffer::const_iterator i = b->begin(), e = b->end();
     kd::header h;
     BOOST_REQUIRE( ! kd::deserialize( i, e, h ) );
     BOOST_REQUIRE_EQUAL( kd::header::V1, h.version_ );
@@ -85,7 +85,7 @@ BOOST_AUTO_TEST_CASE( can_serialize_a_message_without_body )
 
     auto const b = s.serialize( kd::header::PING_REQUEST, token );
 
-    auto i = std::begin( b ), e = std::end( b );
+    kd::buffer::const_iterator i = b->begin(), e = b->end();
     kd::header h;
     BOOST_REQUIRE( ! kd::deserialize( i, e, h ) );
     BOOST_REQUIRE_EQUAL( kd::header::V1, h.version_ );
@@ -96,6 +96,32 @@ BOOST_AUTO_TEST_CASE( can_serialize_a_message_without_body )
     BOOST_REQUIRE( i == e );
 }
 
+BOOST_AUTO_TEST_CASE( reuses_the_buffers_of_sent_messages )
+{
+    kd::message_serializer s{ id_ };
+    kd::id const token{ "ABCD" };
+
+    auto b1 = s.serialize( kd::header::PING_REQUEST, token );
+    auto const data = b1->data();
+    auto const size = b1->size();
+
+    // b1 hasn't been released yet.
+    auto b2 = s.serialize( kd::header::PING_REQUEST, token );
+    BOOST_REQUIRE_NE( data, b2->data() );
+
+    b1 = kd::shared_buffer{};
+    auto b3 = s.serialize( kd::header::PING_RESPONSE, token );
+    BOOST_REQUIRE_EQUAL( data, b3->data() );
+    BOOST_REQUIRE_EQUAL( size, b3->size() );
+    BOOST_REQUIRE_GE( b3->capacity()
+                    , kd::message_serializer::INITIAL_BUFFER_CAPACITY );
+
+    kd::header h;
+    kd::buffer::const_iterator i = b3->begin(), e = b3->end();
+    BOOST_REQUIRE( ! kd::deserialize( i, e, h ) );
+    BOOST_REQUIRE_EQUAL( kd::header::PING_RESPONSE, h.type_ );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -52,6 +52,7 @@ struct fixture
     void
     on_message_received
         ( network_type::endpoint_type const&
+        , kd::shared_buffer const&
         , kd::buffer::const_iterator
         , kd::buffer::const_iterator )
     { };
@@ -73,7 +74,7 @@ BOOST_AUTO_TEST_CASE( schedule_receive_on_construction )
                   , socket_type::ipv6( io_service_, ipv6_ )
                   , std::bind( &fixture::on_message_received
                              , this
-                             , _1, _2, _3 ) };
+                             , _1, _2, _3, _4 ) };
     (void)m;
 }
 
@@ -25,6 +25,8 @@
 
 #include "common.hpp"
 
+#include <random>
+#include <string>
 #include <vector>
 
 #include <kademlia/error.hpp>
@@ -145,6 +147,46 @@ BOOST_FIXTURE_TEST_CASE( multiple_callbacks_can_be_added, fixture )
     BOOST_REQUIRE_EQUAL( h2.random_token_, messages_received_.back() );
 }
 
+BOOST_FIXTURE_TEST_CASE( callbacks_remain_reachable_after_removals, fixture )
+{
+    std::default_random_engine random_engine{ 42 };
+    std::vector< kd::id > ids;
+    for ( auto i = 0; i != 1000; ++ i )
+        ids.emplace_back( random_engine );
+    // These ones share their first bytes, hence their hash.
+    for ( auto i = 0; i != 100; ++ i )
+        ids.emplace_back( std::to_string( i + 1 ) );
+
+    auto on_message_received = [ this ]
+            ( kd::response_callbacks::endpoint_type const&
+            , kd::header const& h
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+    { messages_received_.push_back( h.random_token_ ); };
+
+    for ( auto const& i : ids )
+        callbacks_.push_callback( i, on_message_received );
+    BOOST_REQUIRE_EQUAL( ids.size(), callbacks_.size() );
+
+    // Remove one callback out of two.
+    for ( std::size_t i = 0; i < ids.size(); i += 2 )
+        BOOST_REQUIRE( callbacks_.remove_callback( ids[ i ] ) );
+    BOOST_REQUIRE_EQUAL( ids.size() / 2, callbacks_.size() );
+
+    kd::response_callbacks::endpoint_type const s{};
+    kd::buffer const b;
+    for ( std::size_t i = 0; i < ids.size(); ++ i )
+    {
+        kd::header const h{ kd::header::V1, kd::header::PING_RESPONSE
+                          , kd::id{}, ids[ i ] };
+        auto const result = callbacks_.dispatch_response( s, h, b.begin(), b.end() );
+        BOOST_REQUIRE_EQUAL( i % 2 == 0, k::UNASSOCIATED_MESSAGE_ID == result );
+    }
+
+    BOOST_REQUIRE_EQUAL( ids.size() / 2, messages_received_.size() );
+    BOOST_REQUIRE_EQUAL( 0, callbacks_.size() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
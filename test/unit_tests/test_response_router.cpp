@@ -25,6 +25,9 @@
 
 #include "common.hpp"
 
+#include <string>
+#include <vector>
+
 #include <boost/asio/io_service.hpp>
 
 #include "response_router.hpp"
@@ -140,6 +143,74 @@ BOOST_FIXTURE_TEST_CASE( known_messages_are_not_forwarded_when_late, fixture )
     BOOST_REQUIRE_EQUAL( 1ULL, error_count_ );
 }
 
+BOOST_FIXTURE_TEST_CASE( timeouts_are_cancelled_when_responses_arrive, fixture )
+{
+    // Create the callbacks.
+    auto on_message_received = [ this ]
+            ( kd::response_callbacks::endpoint_type const&
+            , kd::header const&
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+    { ++ messages_received_count_; };
+
+    auto on_error = [ this ]
+        ( std::error_code const& )
+    { ++ error_count_; };
+
+    std::vector< kd::header > headers;
+    for ( auto i = 0; i != 100; ++ i )
+    {
+        headers.push_back( kd::header{ kd::header::V1
+                                     , kd::header::PING_REQUEST
+                                     , kd::id{}
+                                     , kd::id{ std::to_string( i + 1 ) } } );
+
+        router_.register_temporary_callback( headers.back().random_token_
+                                           , std::chrono::hours{ 1 }
+                                           , on_message_received
+                                           , on_error );
+    }
+
+    BOOST_REQUIRE_EQUAL( 100ULL, router_.pending_timeouts_count() );
+
+    kd::response_callbacks::endpoint_type const s{};
+    kd::buffer const b;
+
+    // Receive all the expected messages.
+    for ( auto const& h : headers )
+        router_.handle_new_response( s, h, b.begin(), b.end() );
+
+    io_service_.poll();
+    BOOST_REQUIRE_EQUAL( 100ULL, messages_received_count_ );
+    BOOST_REQUIRE_EQUAL( 0ULL, error_count_ );
+    BOOST_REQUIRE_EQUAL( 0ULL, router_.pending_timeouts_count() );
+}
+
+BOOST_FIXTURE_TEST_CASE( timeouts_are_cancelled_when_callbacks_are_removed, fixture )
+{
+    auto on_message_received = [ this ]
+            ( kd::response_callbacks::endpoint_type const&
+            , kd::header const&
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+    { ++ messages_received_count_; };
+
+    auto on_error = [ this ]
+        ( std::error_code const& )
+    { ++ error_count_; };
+
+    kd::id const response_id{ "1" };
+    router_.register_temporary_callback( response_id
+                                       , std::chrono::hours{ 1 }
+                                       , on_message_received
+                                       , on_error );
+    BOOST_REQUIRE_EQUAL( 1ULL, router_.pending_timeouts_count() );
+
+    BOOST_REQUIRE( router_.remove_temporary_callback( response_id ) );
+    BOOST_REQUIRE_EQUAL( 0ULL, router_.pending_timeouts_count() );
+    BOOST_REQUIRE( ! router_.remove_temporary_callback( response_id ) );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
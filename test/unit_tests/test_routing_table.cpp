@@ -26,7 +26,17 @@
 #include "common.hpp"
 #include "peer_factory.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include <boost/mpl/list.hpp>
+
+#include "constants.hpp"
 #include "routing_table.hpp"
+#include "tree_routing_table.hpp"
 #include "ip_endpoint.hpp"
 
 namespace {
@@ -36,16 +46,39 @@ namespace kd = k::detail;
 
 using test_routing_table = kd::routing_table< kd::ip_endpoint >;
 
+/// Both implementations must behave the same.
+using routing_table_types = boost::mpl::list
+        < test_routing_table
+        , kd::tree_routing_table< kd::ip_endpoint > >;
+
+/**
+ *  Fill the "1x" bucket while the "2x" one is the largest.
+ */
+void
+fill_k_buckets
+    ( test_routing_table & rt )
+{
+    auto const test_peer( create_endpoint() );
+
+    BOOST_REQUIRE( rt.push( kd::id{ "10" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "11" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "20" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "21" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "22" }, test_peer ) );
+}
+
 BOOST_AUTO_TEST_SUITE( routing_table )
 
 BOOST_AUTO_TEST_SUITE( test_construction )
 
-BOOST_AUTO_TEST_CASE( is_empty_on_construction )
+BOOST_AUTO_TEST_CASE_TEMPLATE( is_empty_on_construction
+                             , RoutingTableType
+                             , routing_table_types )
 {
     std::default_random_engine random_engine;
 
     // Create an empty routing_table.
-    test_routing_table rt{ kd::id( random_engine ) };
+    RoutingTableType rt{ kd::id( random_engine ) };
     // Doesn't contain any peer.
     BOOST_REQUIRE_EQUAL( rt.peer_count(), 0 );
 }
@@ -89,11 +122,13 @@ BOOST_AUTO_TEST_CASE( largest_k_bucket_can_receive_unlimited_peers )
     BOOST_REQUIRE(! rt.push( kd::id{ "12" }, test_peer ) );
 }
 
-BOOST_AUTO_TEST_CASE( discards_already_pushed_ids )
+BOOST_AUTO_TEST_CASE_TEMPLATE( discards_already_pushed_ids
+                             , RoutingTableType
+                             , routing_table_types )
 {
     std::default_random_engine random_engine;
 
-    test_routing_table rt{ kd::id{ random_engine } };
+    RoutingTableType rt{ kd::id{ random_engine } };
     auto const test_peer( create_endpoint() );
     kd::id test_id;
 
@@ -104,6 +139,18 @@ BOOST_AUTO_TEST_CASE( discards_already_pushed_ids )
     BOOST_REQUIRE_EQUAL( rt.peer_count(), 1 );
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE( discards_own_id
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    kd::id const my_id{ "1" };
+    RoutingTableType rt{ my_id };
+
+    BOOST_REQUIRE_EQUAL( rt.push( my_id, create_endpoint() ), false );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 0 );
+    BOOST_REQUIRE( rt.find( kd::id{} ) == rt.end() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /**
@@ -111,9 +158,11 @@ BOOST_AUTO_TEST_SUITE_END()
  */
 BOOST_AUTO_TEST_SUITE( test_find )
 
-BOOST_AUTO_TEST_CASE( can_find_a_peer )
+BOOST_AUTO_TEST_CASE_TEMPLATE( can_find_a_peer
+                             , RoutingTableType
+                             , routing_table_types )
 {
-    test_routing_table rt{ kd::id{} };
+    RoutingTableType rt{ kd::id{} };
     auto test_peer( create_endpoint() );
     kd::id test_id{ "a" };
     BOOST_REQUIRE( rt.push( test_id, test_peer ) );
@@ -124,9 +173,11 @@ BOOST_AUTO_TEST_CASE( can_find_a_peer )
     BOOST_REQUIRE_EQUAL( test_peer, i->second );
 }
 
-BOOST_AUTO_TEST_CASE( can_find_a_closer_peer )
+BOOST_AUTO_TEST_CASE_TEMPLATE( can_find_a_closer_peer
+                             , RoutingTableType
+                             , routing_table_types )
 {
-    test_routing_table rt{ kd::id{} };
+    RoutingTableType rt{ kd::id{} };
 
     auto test_peer1( create_endpoint() );
     kd::id test_id1{ "1" };
@@ -146,9 +197,11 @@ BOOST_AUTO_TEST_CASE( can_find_a_closer_peer )
     BOOST_REQUIRE_EQUAL( test_peer2, i->second );
 }
 
-BOOST_AUTO_TEST_CASE( iterator_start_from_the_closest_k_bucket )
+BOOST_AUTO_TEST_CASE_TEMPLATE( iterator_start_from_the_closest_k_bucket
+                             , RoutingTableType
+                             , routing_table_types )
 {
-    test_routing_table rt( kd::id{}, 1 );
+    RoutingTableType rt( kd::id{}, 1 );
     auto test_peer1( create_endpoint( "192.168.0.1" ) );
     kd::id id1{ "1" };
     BOOST_REQUIRE( rt.push( id1, test_peer1 ) );
@@ -183,9 +236,11 @@ BOOST_AUTO_TEST_CASE( iterator_start_from_the_closest_k_bucket )
     BOOST_REQUIRE( i == rt.end() );
 }
 
-BOOST_AUTO_TEST_CASE( iterator_skip_empty_k_bucket )
+BOOST_AUTO_TEST_CASE_TEMPLATE( iterator_skip_empty_k_bucket
+                             , RoutingTableType
+                             , routing_table_types )
 {
-    test_routing_table rt{ kd::id{}, 1 };
+    RoutingTableType rt{ kd::id{}, 1 };
     // Fill far k_bucket.
     auto test_peer1( create_endpoint( "192.168.0.1" ) );
     kd::id id1{ "1" };
@@ -215,16 +270,93 @@ BOOST_AUTO_TEST_CASE( iterator_skip_empty_k_bucket )
 
 BOOST_AUTO_TEST_SUITE_END()
 
+/**
+ *  Test test_routing_table::closest()
+ */
+BOOST_AUTO_TEST_SUITE( test_closest )
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( empty_routing_table_has_no_closest_peer
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    RoutingTableType rt{ kd::id{} };
+    std::vector< typename RoutingTableType::value_type > closest( 20 );
+
+    auto const e = rt.closest( kd::id{ "1" }, closest.size(), closest.begin() );
+    BOOST_REQUIRE( e == closest.begin() );
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( closest_peers_are_sorted_by_distance
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    std::default_random_engine random_engine;
+    RoutingTableType rt{ kd::id{ random_engine }, 4 };
+
+    std::vector< kd::id > known_ids;
+    for ( auto i = 0; i != 500; ++ i )
+    {
+        kd::id const new_id{ random_engine };
+        if ( rt.push( new_id, create_endpoint() ) )
+            known_ids.push_back( new_id );
+    }
+    BOOST_REQUIRE_EQUAL( known_ids.size(), rt.peer_count() );
+
+    std::vector< typename RoutingTableType::value_type > closest( 20 );
+    for ( auto i = 0; i != 50; ++ i )
+    {
+        kd::id const target{ random_engine };
+        std::partial_sort( known_ids.begin()
+                         , known_ids.begin() + closest.size()
+                         , known_ids.end()
+                         , [ &target ]( kd::id const& a, kd::id const& b )
+                           { return distance( a, target )
+                                  < distance( b, target ); } );
+
+        for ( std::size_t count : { 1, 5, 20 } )
+        {
+            auto const e = rt.closest( target, count, closest.begin() );
+            BOOST_REQUIRE_EQUAL( std::distance( closest.begin(), e ), count );
+
+            for ( std::size_t j = 0; j != count; ++ j )
+                BOOST_REQUIRE( closest[ j ].first == known_ids[ j ] );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( closest_peers_are_bounded_by_peer_count
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    RoutingTableType rt{ kd::id{} };
+    auto const test_peer( create_endpoint( "192.168.0.1" ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "1" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "2" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "4" }, test_peer ) );
+
+    std::vector< typename RoutingTableType::value_type > closest( 20 );
+    auto const e = rt.closest( kd::id{ "6" }, closest.size(), closest.begin() );
+    BOOST_REQUIRE_EQUAL( std::distance( closest.begin(), e ), 3 );
+    BOOST_REQUIRE( closest[ 0 ].first == kd::id{ "4" } );
+    BOOST_REQUIRE( closest[ 1 ].first == kd::id{ "2" } );
+    BOOST_REQUIRE( closest[ 2 ].first == kd::id{ "1" } );
+    BOOST_REQUIRE_EQUAL( closest[ 0 ].second, test_peer );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 /**
  *  Test test_routing_table::remove()
  */
 BOOST_AUTO_TEST_SUITE( test_remove )
 
-BOOST_AUTO_TEST_CASE( can_remove_a_peer )
+BOOST_AUTO_TEST_CASE_TEMPLATE( can_remove_a_peer
+                             , RoutingTableType
+                             , routing_table_types )
 {
-    test_routing_table rt{ kd::id{} };
+    RoutingTableType rt{ kd::id{} };
     auto test_peer( create_endpoint() );
-    kd::id test_id{};
+    kd::id test_id{ "1" };
     BOOST_REQUIRE( rt.push( test_id, test_peer ) );
 
     // Try to find the generated peer.
@@ -237,6 +369,353 @@ BOOST_AUTO_TEST_CASE( can_remove_a_peer )
 
 BOOST_AUTO_TEST_SUITE_END()
 
+/**
+ *  Test test_routing_table::find_eviction_candidate() & evict()
+ */
+BOOST_AUTO_TEST_SUITE( test_eviction )
+
+BOOST_AUTO_TEST_CASE( pings_the_least_recently_seen_peer_of_full_buckets )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    test_routing_table::value_type oldest;
+
+    // The bucket has room or is the largest one.
+    BOOST_REQUIRE( ! rt.find_eviction_candidate( kd::id{ "30" }, oldest ) );
+    BOOST_REQUIRE( ! rt.find_eviction_candidate( kd::id{ "23" }, oldest ) );
+    // The peer is already known.
+    BOOST_REQUIRE( ! rt.find_eviction_candidate( kd::id{ "11" }, oldest ) );
+
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+    BOOST_REQUIRE_EQUAL( oldest.first, kd::id{ "10" } );
+
+    // Only one ping at a time per bucket.
+    BOOST_REQUIRE( ! rt.find_eviction_candidate( kd::id{ "13" }, oldest ) );
+
+    rt.cancel_eviction( kd::id{ "10" } );
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "13" }, oldest ) );
+}
+
+BOOST_AUTO_TEST_CASE( seen_peers_become_the_most_recently_seen )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    // "10" has been seen again.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "10" }, create_endpoint() ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+
+    test_routing_table::value_type oldest;
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+    BOOST_REQUIRE_EQUAL( oldest.first, kd::id{ "11" } );
+}
+
+BOOST_AUTO_TEST_CASE( replaces_stale_peers )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    // "12" is kept as a replacement.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "12" }, create_endpoint() ) );
+
+    test_routing_table::value_type oldest;
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+    BOOST_REQUIRE( rt.evict( oldest.first ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+
+    // "12" replaced "10", "11" being now the oldest peer.
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "10" }, oldest ) );
+    BOOST_REQUIRE_EQUAL( oldest.first, kd::id{ "11" } );
+    BOOST_REQUIRE( ! rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+}
+
+BOOST_AUTO_TEST_CASE( keeps_stale_peers_seen_meanwhile )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    test_routing_table::value_type oldest;
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+
+    // "10" sent a message before the ping timeout.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "10" }, create_endpoint() ) );
+    BOOST_REQUIRE( ! rt.evict( oldest.first ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+    BOOST_REQUIRE_EQUAL( oldest.first, kd::id{ "11" } );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/**
+ *  Test the test_routing_table replacement cache.
+ */
+BOOST_AUTO_TEST_SUITE( test_replacement_cache )
+
+BOOST_AUTO_TEST_CASE( removed_peers_are_replaced )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    BOOST_REQUIRE( ! rt.push( kd::id{ "12" }, create_endpoint() ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+
+    BOOST_REQUIRE( rt.remove( kd::id{ "11" } ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+
+    // "12" is known hence the only peer to ping is "10".
+    test_routing_table::value_type oldest;
+    BOOST_REQUIRE( ! rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "11" }, oldest ) );
+    BOOST_REQUIRE_EQUAL( oldest.first, kd::id{ "10" } );
+
+    // Without replacement, the bucket shrinks.
+    BOOST_REQUIRE( rt.remove( kd::id{ "10" } ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 4 );
+}
+
+BOOST_AUTO_TEST_CASE( most_recently_seen_replacements_are_promoted_first )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    BOOST_REQUIRE( ! rt.push( kd::id{ "12" }, create_endpoint() ) );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "13" }, create_endpoint() ) );
+    // "12" has been seen again.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "12" }, create_endpoint() ) );
+
+    BOOST_REQUIRE( rt.remove( kd::id{ "10" } ) );
+    BOOST_REQUIRE( rt.remove( kd::id{ "11" } ) );
+
+    // "12" then "13" have been promoted.
+    test_routing_table::value_type oldest;
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "10" }, oldest ) );
+    BOOST_REQUIRE_EQUAL( oldest.first, kd::id{ "12" } );
+    BOOST_REQUIRE( rt.evict( oldest.first ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 4 );
+}
+
+BOOST_AUTO_TEST_CASE( replacement_cache_is_bounded )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    // Only the 2 most recently seen are kept.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "12" }, create_endpoint() ) );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "13" }, create_endpoint() ) );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "14" }, create_endpoint() ) );
+
+    BOOST_REQUIRE( rt.remove( kd::id{ "10" } ) );
+    BOOST_REQUIRE( rt.remove( kd::id{ "11" } ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+
+    BOOST_REQUIRE( rt.remove( kd::id{ "14" } ) );
+    BOOST_REQUIRE( rt.remove( kd::id{ "13" } ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 3 );
+    BOOST_REQUIRE( ! rt.remove( kd::id{ "12" } ) );
+}
+
+BOOST_AUTO_TEST_CASE( unresponsive_peers_are_replaced )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    BOOST_REQUIRE( ! rt.push( kd::id{ "12" }, create_endpoint() ) );
+
+    for ( std::size_t i = 0; i != kd::MAX_CONSECUTIVE_TIMEOUTS_COUNT; ++ i )
+        BOOST_REQUIRE( rt.record_request_timeout( kd::id{ "11" }
+                                               , test_routing_table::clock::now() ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+
+    // "12" took the place of "11".
+    test_routing_table::value_type oldest;
+    BOOST_REQUIRE( ! rt.find_eviction_candidate( kd::id{ "12" }, oldest ) );
+    BOOST_REQUIRE( rt.find_eviction_candidate( kd::id{ "11" }, oldest ) );
+    BOOST_REQUIRE_EQUAL( oldest.first, kd::id{ "10" } );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/**
+ *  Test test_routing_table::find_idle_k_buckets()
+ */
+BOOST_AUTO_TEST_SUITE( test_refresh )
+
+BOOST_AUTO_TEST_CASE( empty_routing_table_has_no_bucket_to_refresh )
+{
+    test_routing_table rt{ kd::id{} };
+    auto const later = test_routing_table::clock::now() + std::chrono::hours{ 1 };
+
+    std::vector< std::size_t > idle;
+    rt.find_idle_k_buckets( later, 10, std::back_inserter( idle ) );
+    BOOST_REQUIRE( idle.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( buckets_without_lookup_are_idle )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    fill_k_buckets( rt );
+
+    auto const now = test_routing_table::clock::now();
+    auto const later = now + std::chrono::hours{ 1 };
+    std::vector< std::size_t > idle;
+
+    // Buckets are active on construction.
+    rt.find_idle_k_buckets( now - std::chrono::seconds{ 1 }, 1000
+                          , std::back_inserter( idle ) );
+    BOOST_REQUIRE( idle.empty() );
+
+    // Up to the deepest non empty bucket, i.e. "1x" one.
+    auto const deepest = kd::common_prefix_length( kd::id{ "10" }, kd::id{} );
+    rt.find_idle_k_buckets( later, 1000, std::back_inserter( idle ) );
+    BOOST_REQUIRE_EQUAL( idle.size(), deepest + 1 );
+
+    // The buckets looked up recently are refreshed last if at all.
+    rt.record_lookup( kd::id{ "13" }, later );
+    rt.record_lookup( kd::id{ "24" }, later - std::chrono::minutes{ 1 } );
+
+    idle.clear();
+    rt.find_idle_k_buckets( later, 1000, std::back_inserter( idle ) );
+    BOOST_REQUIRE_EQUAL( idle.size(), deepest );
+    BOOST_REQUIRE_EQUAL( idle.back()
+                       , kd::common_prefix_length( kd::id{ "20" }, kd::id{} ) );
+
+    // At most max_count buckets are returned.
+    idle.clear();
+    rt.find_idle_k_buckets( later, 2, std::back_inserter( idle ) );
+    BOOST_REQUIRE_EQUAL( idle.size(), 2 );
+}
+
+BOOST_AUTO_TEST_CASE( random_ids_are_covered_by_their_bucket )
+{
+    std::default_random_engine random_engine;
+    kd::id const my_id{ random_engine };
+    test_routing_table rt{ my_id };
+
+    for ( std::size_t i = 0; i != kd::id::BIT_SIZE; ++ i )
+    {
+        auto const refresh_id = rt.random_id_in_k_bucket( i, random_engine );
+        BOOST_REQUIRE_EQUAL( kd::common_prefix_length( refresh_id, my_id ), i );
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/**
+ *  Test test_routing_table::request_timeout()
+ */
+BOOST_AUTO_TEST_SUITE( test_request_timeout )
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( unknown_peers_use_the_default_timeout
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    RoutingTableType rt{ kd::id{} };
+    auto const default_timeout = std::chrono::milliseconds{ 200 };
+    kd::id const test_id{ "1" };
+
+    BOOST_REQUIRE( ! rt.record_round_trip_time( test_id
+                                              , std::chrono::milliseconds{ 1 } ) );
+    BOOST_REQUIRE( rt.request_timeout( test_id, default_timeout )
+                 == default_timeout );
+
+    // Known peers without sample also use it.
+    BOOST_REQUIRE( rt.push( test_id, create_endpoint() ) );
+    BOOST_REQUIRE( rt.request_timeout( test_id, default_timeout )
+                 == default_timeout );
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( peers_timeouts_follow_their_round_trip_time
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    RoutingTableType rt{ kd::id{} };
+    auto const default_timeout = std::chrono::milliseconds{ 200 };
+    kd::id const fast_id{ "1" }, slow_id{ "2" };
+
+    BOOST_REQUIRE( rt.push( fast_id, create_endpoint() ) );
+    BOOST_REQUIRE( rt.push( slow_id, create_endpoint() ) );
+
+    for ( auto i = 0; i != 16; ++ i )
+    {
+        BOOST_REQUIRE( rt.record_round_trip_time( fast_id
+                                                , std::chrono::milliseconds{ 20 } ) );
+        BOOST_REQUIRE( rt.record_round_trip_time( slow_id
+                                                , std::chrono::milliseconds{ 400 } ) );
+    }
+
+    auto const fast_timeout = rt.request_timeout( fast_id, default_timeout );
+    auto const slow_timeout = rt.request_timeout( slow_id, default_timeout );
+    BOOST_REQUIRE( fast_timeout >= std::chrono::milliseconds{ 20 } );
+    BOOST_REQUIRE( fast_timeout < default_timeout );
+    BOOST_REQUIRE( slow_timeout > std::chrono::milliseconds{ 400 } );
+
+    // Soft timeouts follow them too.
+    BOOST_REQUIRE( rt.request_soft_timeout( fast_id )
+                 < rt.request_soft_timeout( slow_id ) );
+    BOOST_REQUIRE( rt.request_soft_timeout( kd::id{ "3" } )
+                 == std::chrono::milliseconds::zero() );
+
+    // Estimates are dropped with their peer.
+    BOOST_REQUIRE( rt.remove( slow_id ) );
+    BOOST_REQUIRE( rt.push( slow_id, create_endpoint() ) );
+    BOOST_REQUIRE( rt.request_timeout( slow_id, default_timeout )
+                 == default_timeout );
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( timeouts_back_off_the_peer_timeout
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    RoutingTableType rt{ kd::id{} };
+    auto const default_timeout = std::chrono::milliseconds{ 200 };
+    kd::id const test_id{ "1" }, other_id{ "2" };
+    auto time_out = [ &rt ]( kd::id const& peer_id )
+    { return rt.record_request_timeout( peer_id
+                                      , RoutingTableType::clock::now() ); };
+
+    BOOST_REQUIRE( ! time_out( test_id ) );
+
+    BOOST_REQUIRE( rt.push( test_id, create_endpoint() ) );
+    BOOST_REQUIRE( rt.push( other_id, create_endpoint() ) );
+    BOOST_REQUIRE( time_out( test_id ) );
+
+    BOOST_REQUIRE( rt.request_timeout( test_id, default_timeout )
+                 == 2 * default_timeout );
+    BOOST_REQUIRE( rt.request_timeout( other_id, default_timeout )
+                 == default_timeout );
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( unresponsive_peers_are_removed
+                             , RoutingTableType
+                             , routing_table_types )
+{
+    RoutingTableType rt{ kd::id{} };
+    kd::id const test_id{ "1" };
+    auto time_out = [ &rt ]( kd::id const& peer_id )
+    { return rt.record_request_timeout( peer_id
+                                      , RoutingTableType::clock::now() ); };
+
+    BOOST_REQUIRE( rt.push( test_id, create_endpoint() ) );
+
+    // An answer resets the count of timeouts.
+    for ( std::size_t i = 1; i != kd::MAX_CONSECUTIVE_TIMEOUTS_COUNT; ++ i )
+        BOOST_REQUIRE( time_out( test_id ) );
+    BOOST_REQUIRE( rt.record_round_trip_time( test_id
+                                            , std::chrono::milliseconds{ 20 } ) );
+    for ( std::size_t i = 1; i != kd::MAX_CONSECUTIVE_TIMEOUTS_COUNT; ++ i )
+        BOOST_REQUIRE( time_out( test_id ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 1 );
+
+    BOOST_REQUIRE( time_out( test_id ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 0 );
+    BOOST_REQUIRE( ! time_out( test_id ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 /**
  *  Test operator<<()
  */
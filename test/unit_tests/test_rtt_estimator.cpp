@@ -0,0 +1,154 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "common.hpp"
+
+#include <chrono>
+
+#include "constants.hpp"
+#include "rtt_estimator.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+using ms = std::chrono::milliseconds;
+
+BOOST_AUTO_TEST_SUITE( rtt_estimator )
+
+BOOST_AUTO_TEST_CASE( uses_the_default_timeout_without_sample )
+{
+    kd::rtt_estimator e;
+    BOOST_REQUIRE( ! e.has_sample() );
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == ms{ 200 } );
+}
+
+BOOST_AUTO_TEST_CASE( is_initialized_by_the_first_sample )
+{
+    kd::rtt_estimator e;
+    e.record( ms{ 100 } );
+
+    BOOST_REQUIRE( e.has_sample() );
+    BOOST_REQUIRE( e.smoothed_rtt() == ms{ 100 } );
+    BOOST_REQUIRE( e.rtt_variation() == ms{ 50 } );
+    // SRTT + 4 * RTTVAR
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == ms{ 300 } );
+}
+
+BOOST_AUTO_TEST_CASE( smoothes_the_following_samples )
+{
+    kd::rtt_estimator e;
+    e.record( ms{ 100 } );
+    e.record( ms{ 180 } );
+
+    // SRTT = 7/8 * 100 + 1/8 * 180
+    BOOST_REQUIRE( e.smoothed_rtt() == ms{ 110 } );
+    // RTTVAR = 3/4 * 50 + 1/4 * |100 - 180|
+    BOOST_REQUIRE( e.rtt_variation() == std::chrono::microseconds{ 57500 } );
+}
+
+BOOST_AUTO_TEST_CASE( converges_toward_a_stable_rtt )
+{
+    kd::rtt_estimator e;
+    e.record( ms{ 400 } );
+    for ( auto i = 0; i != 64; ++ i )
+        e.record( ms{ 40 } );
+
+    BOOST_REQUIRE( e.smoothed_rtt() < ms{ 41 } );
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) < ms{ 45 } );
+}
+
+BOOST_AUTO_TEST_CASE( timeout_is_bounded )
+{
+    kd::rtt_estimator fast;
+    fast.record( std::chrono::microseconds{ 100 } );
+    BOOST_REQUIRE( fast.timeout( ms{ 200 } ) == kd::MIN_REQUEST_TIMEOUT );
+
+    kd::rtt_estimator slow;
+    slow.record( std::chrono::seconds{ 60 } );
+    BOOST_REQUIRE( slow.timeout( ms{ 200 } ) == kd::MAX_REQUEST_TIMEOUT );
+}
+
+BOOST_AUTO_TEST_CASE( soft_timeout_follows_the_estimates )
+{
+    kd::rtt_estimator e;
+    BOOST_REQUIRE( e.soft_timeout() == ms::zero() );
+
+    e.record( ms{ 100 } );
+    // SRTT + 2 * RTTVAR
+    BOOST_REQUIRE( e.soft_timeout() == ms{ 200 } );
+}
+
+BOOST_AUTO_TEST_CASE( timeouts_back_off_the_timeout )
+{
+    // Each request is sent once the previous one timed out.
+    kd::rtt_estimator::time_point now{};
+    kd::rtt_estimator e;
+    auto time_out = [ &e, &now ]( void )
+    {
+        e.record_timeout( now, now + ms{ 200 } );
+        now += ms{ 200 };
+    };
+
+    // Without sample, the default timeout is doubled.
+    time_out();
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == ms{ 400 } );
+    time_out();
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == ms{ 800 } );
+    BOOST_REQUIRE_EQUAL( 2, e.consecutive_timeouts_count() );
+
+    // Up to the upper bound.
+    for ( auto i = 0; i != 64; ++ i )
+        time_out();
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == kd::MAX_REQUEST_TIMEOUT );
+
+    // Until the next sample.
+    e.record( ms{ 100 } );
+    BOOST_REQUIRE_EQUAL( 0, e.consecutive_timeouts_count() );
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == ms{ 300 } );
+
+    time_out();
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == ms{ 600 } );
+}
+
+BOOST_AUTO_TEST_CASE( requests_in_flight_together_back_off_once )
+{
+    kd::rtt_estimator::time_point const sent_at{};
+    kd::rtt_estimator e;
+
+    for ( auto i = 0; i != 16; ++ i )
+        e.record_timeout( sent_at, sent_at + ms{ 200 } + ms{ i } );
+    BOOST_REQUIRE_EQUAL( 1, e.consecutive_timeouts_count() );
+    BOOST_REQUIRE( e.timeout( ms{ 200 } ) == ms{ 400 } );
+
+    // A request sent after the timeout backs off again.
+    e.record_timeout( sent_at + ms{ 300 }, sent_at + ms{ 700 } );
+    BOOST_REQUIRE_EQUAL( 2, e.consecutive_timeouts_count() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
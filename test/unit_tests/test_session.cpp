@@ -107,6 +107,21 @@ BOOST_AUTO_TEST_CASE( session_run_can_be_aborted )
     BOOST_REQUIRE( result.get() == k::RUN_ABORTED );
 }
 
+BOOST_AUTO_TEST_CASE( session_poll_executes_a_bounded_number_of_handlers )
+{
+    k::first_session s{};
+
+    // Nothing has been received yet.
+    BOOST_REQUIRE_EQUAL( 0, s.poll( 8 ) );
+
+    s.abort();
+    s.abort();
+
+    BOOST_REQUIRE_EQUAL( 1, s.poll( 1 ) );
+    BOOST_REQUIRE_EQUAL( 1, s.poll( 8 ) );
+    BOOST_REQUIRE_EQUAL( 0, s.poll( 8 ) );
+}
+
 BOOST_AUTO_TEST_CASE( session_can_save_and_load )
 {
     auto const fs_port = k::test::get_temporary_listening_port();
@@ -156,6 +171,59 @@ BOOST_AUTO_TEST_CASE( session_can_save_and_load )
     BOOST_REQUIRE( fs_result.get() == k::RUN_ABORTED );
 }
 
+BOOST_AUTO_TEST_CASE( session_can_save_and_load_from_several_threads )
+{
+    std::size_t const threads_count = 4;
+
+    auto const fs_port = k::test::get_temporary_listening_port();
+    k::endpoint const first_session_endpoint{ "127.0.0.1", fs_port };
+    k::first_session fs{ first_session_endpoint
+                       , k::endpoint{ "::1", fs_port } };
+
+    auto fs_result = std::async( std::launch::async
+                               , &k::first_session::run_concurrently, &fs
+                               , threads_count );
+
+    auto const s_port = k::test::get_temporary_listening_port( fs_port );
+    k::session s{ first_session_endpoint
+                , k::endpoint{ "127.0.0.1", s_port }
+                , k::endpoint{ "::1", s_port } };
+
+    auto s_result = std::async( std::launch::async
+                              , &k::session::run_concurrently, &s
+                              , threads_count );
+
+    std::string const key{ "key" };
+    std::string const expected_value{ "value" };
+
+    std::string actual_value;
+    auto on_load = [ &s, &actual_value ]
+            ( std::error_code const& failure
+            , k::session::data_type const& data )
+    {
+        if ( ! failure )
+            actual_value.assign( data.begin(), data.end() );
+        s.abort();
+    };
+
+    auto on_save = [ &s, &key, &on_load ]
+            ( std::error_code const& failure )
+    {
+        if ( failure )
+            s.abort();
+        else
+            s.async_load( key, on_load );
+    };
+
+    s.async_save( key, expected_value, on_save );
+
+    BOOST_REQUIRE( s_result.get() == k::RUN_ABORTED );
+    BOOST_REQUIRE_EQUAL( actual_value, expected_value );
+
+    fs.abort();
+    BOOST_REQUIRE( fs_result.get() == k::RUN_ABORTED );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,116 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "common.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+#include <kademlia/session_configuration.hpp>
+
+namespace {
+
+namespace k = kademlia;
+
+using ms = std::chrono::milliseconds;
+
+BOOST_AUTO_TEST_SUITE( session_configuration )
+
+BOOST_AUTO_TEST_CASE( accepts_positive_values )
+{
+    k::session_configuration c;
+    c.bucket_size( 1 );
+    c.concurrent_requests_count( 1 );
+    c.redundant_saves_count( 1 );
+    c.initial_contact_timeout( ms{ 1 } );
+    c.peer_lookup_timeout( ms{ 1 } );
+    c.disjoint_paths_count( 1 );
+    c.lookup_candidates_count( 1 );
+    c.bucket_refresh_interval( ms{ 1 } );
+    c.value_lifetime( ms{ 1 } );
+    c.value_republication_interval( ms{ 1 } );
+
+    BOOST_REQUIRE_EQUAL( 1, c.bucket_size() );
+    BOOST_REQUIRE_EQUAL( 1, c.concurrent_requests_count() );
+    BOOST_REQUIRE_EQUAL( 1, c.redundant_saves_count() );
+    BOOST_REQUIRE( ms{ 1 } == c.initial_contact_timeout() );
+    BOOST_REQUIRE( ms{ 1 } == c.peer_lookup_timeout() );
+    BOOST_REQUIRE_EQUAL( 1, c.disjoint_paths_count() );
+    BOOST_REQUIRE_EQUAL( 1, c.lookup_candidates_count() );
+    BOOST_REQUIRE( ms{ 1 } == c.bucket_refresh_interval() );
+    BOOST_REQUIRE( ms{ 1 } == c.value_lifetime() );
+    BOOST_REQUIRE( ms{ 1 } == c.value_republication_interval() );
+}
+
+BOOST_AUTO_TEST_CASE( rejects_null_counts )
+{
+    k::session_configuration c;
+    BOOST_REQUIRE_THROW( c.bucket_size( 0 ), std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.concurrent_requests_count( 0 )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.redundant_saves_count( 0 )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.disjoint_paths_count( 0 )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.lookup_candidates_count( 0 )
+                       , std::invalid_argument );
+
+    // The configuration is left unchanged.
+    BOOST_REQUIRE_EQUAL( 20, c.bucket_size() );
+    BOOST_REQUIRE_EQUAL( 3, c.concurrent_requests_count() );
+}
+
+BOOST_AUTO_TEST_CASE( rejects_non_positive_durations )
+{
+    k::session_configuration c;
+    BOOST_REQUIRE_THROW( c.initial_contact_timeout( ms{ 0 } )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.peer_lookup_timeout( ms{ -1 } )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.bucket_refresh_interval( ms{ 0 } )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.value_lifetime( ms{ 0 } )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.value_republication_interval( ms{ -1 } )
+                       , std::invalid_argument );
+
+    BOOST_REQUIRE( ms{ 200 } == c.peer_lookup_timeout() );
+}
+
+BOOST_AUTO_TEST_CASE( rejects_percentiles_out_of_range )
+{
+    k::session_configuration c;
+    c.hedged_requests_percentile( 0. );
+    c.hedged_requests_percentile( 1. );
+
+    BOOST_REQUIRE_THROW( c.hedged_requests_percentile( -0.1 )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_THROW( c.hedged_requests_percentile( 1.5 )
+                       , std::invalid_argument );
+    BOOST_REQUIRE_EQUAL( 1., c.hedged_requests_percentile() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
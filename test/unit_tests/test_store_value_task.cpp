@@ -29,6 +29,7 @@
 #include "corrupted_message.hpp"
 #include "task_fixture.hpp"
 
+#include <chrono>
 #include <vector>
 #include <utility>
 
@@ -50,6 +51,7 @@ struct fixture : k::test::task_fixture
     fixture
         ( void )
         : task_fixture()
+        , lifetime_( std::chrono::hours{ 1 } )
     { }
 
     void
@@ -59,6 +61,8 @@ struct fixture : k::test::task_fixture
         ++ callback_call_count_;
         failure_ = f;
     }
+
+    std::chrono::milliseconds lifetime_;
 };
 
 BOOST_AUTO_TEST_SUITE( store_value_task )
@@ -75,6 +79,7 @@ BOOST_AUTO_TEST_CASE( can_notify_error_when_routing_table_is_empty )
 
     kd::start_store_value_task< data_type >( chosen_key
                                            , data
+                                           , lifetime_
                                            , tracker_
                                            , routing_table_
                                            , std::ref( *this ) );
@@ -102,6 +107,7 @@ BOOST_AUTO_TEST_CASE( can_notify_error_when_unique_peer_fails_to_respond )
 
     kd::start_store_value_task< data_type >( chosen_key
                                            , data
+                                           , lifetime_
                                            , tracker_
                                            , routing_table_
                                            , std::ref( *this ) );
@@ -133,6 +139,7 @@ BOOST_AUTO_TEST_CASE( can_notify_error_when_all_peers_fail_to_respond )
 
     kd::start_store_value_task< data_type >( chosen_key
                                            , data
+                                           , lifetime_
                                            , tracker_
                                            , routing_table_
                                            , std::ref( *this ) );
@@ -165,6 +172,7 @@ BOOST_AUTO_TEST_CASE( can_store_value_when_already_known_peer_is_the_target )
     tracker_.add_message_to_receive( p1.endpoint_, p1.id_, b1 );
     kd::start_store_value_task< data_type >( chosen_key
                                            , data
+                                           , lifetime_
                                            , tracker_
                                            , routing_table_
                                            , std::ref( *this ) );
@@ -179,7 +187,7 @@ BOOST_AUTO_TEST_CASE( can_store_value_when_already_known_peer_is_the_target )
 
     // Task decided that p1 was the closest
     // hence it asked to store data on it.
-    kd::store_value_request_body const sv{ chosen_key, data };
+    kd::store_value_request_body const sv{ chosen_key, data, lifetime_ };
     BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, sv ) );
 
     // Task didn't send any more message.
@@ -214,6 +222,7 @@ BOOST_AUTO_TEST_CASE( can_store_value_when_discovered_peer_is_the_target )
 
     kd::start_store_value_task< data_type >( chosen_key
                                            , data
+                                           , lifetime_
                                            , tracker_
                                            , routing_table_
                                            , std::ref( *this ) );
@@ -231,7 +240,7 @@ BOOST_AUTO_TEST_CASE( can_store_value_when_discovered_peer_is_the_target )
 
     // Task decided that p2 was the closest
     // hence it asked to store data on it.
-    kd::store_value_request_body const sv{ chosen_key, data };
+    kd::store_value_request_body const sv{ chosen_key, data, lifetime_ };
     BOOST_REQUIRE( tracker_.has_sent_message( e2, sv ) );
 
     // Task is also required to store data 
@@ -246,6 +255,80 @@ BOOST_AUTO_TEST_CASE( can_store_value_when_discovered_peer_is_the_target )
     BOOST_REQUIRE( ! failure_ );
 }
 
+BOOST_AUTO_TEST_CASE( stops_the_lookup_once_the_closest_peers_responded )
+{
+    kd::id const chosen_key{ "a" };
+    kd::buffer const data{ 1, 2, 3, 4 };
+    routing_table_.expected_ids_.emplace_back( chosen_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "b" } );
+    create_and_add_peer( "192.168.1.2", kd::id{ "c" } );
+    create_and_add_peer( "192.168.1.3", kd::id{ "d" } );
+
+    // p1 doesn't know any closer peer.
+    kd::find_peer_response_body const b1{};
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, b1 );
+
+    k::session_configuration configuration;
+    configuration.bucket_size( 1 );
+    configuration.redundant_saves_count( 1 );
+
+    kd::start_store_value_task< data_type >( chosen_key
+                                           , data
+                                           , lifetime_
+                                           , tracker_
+                                           , routing_table_
+                                           , std::ref( *this )
+                                           , configuration );
+    io_service_.poll();
+
+    // Task only asked p1, the closest peer.
+    kd::find_peer_request_body const fv{ chosen_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+
+    // Once it responded, the lookup converged
+    // hence the task asked it to store data.
+    kd::store_value_request_body const sv{ chosen_key, data, lifetime_ };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, sv ) );
+
+    // Task didn't send any more message.
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+}
+
+BOOST_AUTO_TEST_CASE( keeps_the_configured_count_of_candidates )
+{
+    kd::id const chosen_key{ "a" };
+    kd::buffer const data{ 1, 2, 3, 4 };
+    routing_table_.expected_ids_.emplace_back( chosen_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "b" } );
+    create_and_add_peer( "192.168.1.2", kd::id{ "c" } );
+
+    k::session_configuration configuration;
+    configuration.bucket_size( 1 );
+    configuration.lookup_candidates_count( 1 );
+
+    kd::start_store_value_task< data_type >( chosen_key
+                                           , data
+                                           , lifetime_
+                                           , tracker_
+                                           , routing_table_
+                                           , std::ref( *this )
+                                           , configuration );
+    io_service_.poll();
+
+    // Task only kept p1, the closest peer.
+    kd::find_peer_request_body const fv{ chosen_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( failure_ == k::MISSING_PEERS );
+}
+
 BOOST_AUTO_TEST_CASE( can_skip_wrong_response )
 {
     kd::id const chosen_key{ "a" };
@@ -260,6 +343,7 @@ BOOST_AUTO_TEST_CASE( can_skip_wrong_response )
 
     kd::start_store_value_task( chosen_key
                               , data
+                              , lifetime_
                               , tracker_
                               , routing_table_
                               , std::ref( *this ) );
@@ -285,6 +369,7 @@ BOOST_AUTO_TEST_CASE( can_skip_corrupted_response )
 
     kd::start_store_value_task( chosen_key
                               , data
+                              , lifetime_
                               , tracker_
                               , routing_table_
                               , std::ref( *this ) );
@@ -0,0 +1,162 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "submission_queue.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+namespace {
+
+BOOST_AUTO_TEST_SUITE( submission_queue )
+
+BOOST_AUTO_TEST_SUITE( test_construction )
+
+BOOST_AUTO_TEST_CASE( can_be_default_constructed )
+{
+    kd::submission_queue{};
+}
+
+BOOST_AUTO_TEST_CASE( releases_pending_tasks_on_destruction )
+{
+    auto resource = std::make_shared< int >();
+
+    {
+        kd::submission_queue queue;
+        queue.push( [ resource ] ( void ) { } );
+        BOOST_REQUIRE_EQUAL( 2, resource.use_count() );
+    }
+
+    BOOST_REQUIRE_EQUAL( 1, resource.use_count() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_AUTO_TEST_CASE( push_reports_when_consumer_must_be_scheduled )
+{
+    kd::submission_queue queue;
+
+    BOOST_REQUIRE( queue.push( [] ( void ) { } ) );
+    BOOST_REQUIRE( ! queue.push( [] ( void ) { } ) );
+
+    BOOST_REQUIRE_EQUAL( 2, queue.consume_all() );
+
+    BOOST_REQUIRE( queue.push( [] ( void ) { } ) );
+}
+
+BOOST_AUTO_TEST_CASE( consume_all_executes_tasks_in_submission_order )
+{
+    kd::submission_queue queue;
+    std::vector< int > executed;
+
+    for ( int i = 0; i != 8; ++ i )
+        queue.push( [ &executed, i ] ( void ) { executed.push_back( i ); } );
+
+    BOOST_REQUIRE_EQUAL( 8, queue.consume_all() );
+    BOOST_REQUIRE_EQUAL( 0, queue.consume_all() );
+
+    std::vector< int > const expected{ 0, 1, 2, 3, 4, 5, 6, 7 };
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( executed.begin(), executed.end()
+                                   , expected.begin(), expected.end() );
+}
+
+BOOST_AUTO_TEST_CASE( consume_all_keeps_remaining_tasks_on_exception )
+{
+    kd::submission_queue queue;
+    std::vector< int > executed;
+
+    queue.push( [ &executed ] ( void ) { executed.push_back( 0 ); } );
+    queue.push( [] ( void ) { throw std::runtime_error{ "failure" }; } );
+    queue.push( [ &executed ] ( void ) { executed.push_back( 2 ); } );
+    queue.push( [ &executed ] ( void ) { executed.push_back( 3 ); } );
+
+    BOOST_REQUIRE_THROW( queue.consume_all(), std::runtime_error );
+    BOOST_REQUIRE_EQUAL( 1, executed.size() );
+
+    // Tasks pushed since run after the restored ones.
+    BOOST_REQUIRE( ! queue.push( [ &executed ] ( void )
+                                 { executed.push_back( 4 ); } ) );
+
+    BOOST_REQUIRE_EQUAL( 3, queue.consume_all() );
+
+    std::vector< int > const expected{ 0, 2, 3, 4 };
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( executed.begin(), executed.end()
+                                   , expected.begin(), expected.end() );
+}
+
+BOOST_AUTO_TEST_CASE( can_be_fed_by_concurrent_producers )
+{
+    std::size_t const producers_count = 4;
+    std::size_t const tasks_per_producer = 10000;
+
+    kd::submission_queue queue;
+    // Only accessed by the consumer.
+    std::vector< std::size_t > last_executed( producers_count, 0 );
+    bool in_order = true;
+
+    std::atomic< std::size_t > wakeups_count{ 0 };
+    std::vector< std::thread > producers;
+    for ( std::size_t p = 0; p != producers_count; ++ p )
+        producers.emplace_back( [ &, p ] ( void )
+        {
+            for ( std::size_t i = 1; i <= tasks_per_producer; ++ i )
+            {
+                auto task = [ &, p, i ] ( void )
+                {
+                    in_order = in_order && last_executed[ p ] + 1 == i;
+                    last_executed[ p ] = i;
+                };
+
+                if ( queue.push( task ) )
+                    ++ wakeups_count;
+            }
+        } );
+
+    std::size_t executed_count = 0;
+    while ( executed_count != producers_count * tasks_per_producer )
+        executed_count += queue.consume_all();
+
+    for ( auto & p : producers )
+        p.join();
+
+    BOOST_REQUIRE( in_order );
+    BOOST_REQUIRE_EQUAL( 0, queue.consume_all() );
+    BOOST_REQUIRE_LE( wakeups_count, executed_count );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
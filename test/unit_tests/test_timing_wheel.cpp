@@ -0,0 +1,188 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "common.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "timing_wheel.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+using tick_type = kd::timing_wheel::tick_type;
+
+BOOST_AUTO_TEST_SUITE( timing_wheel )
+
+BOOST_AUTO_TEST_SUITE( test_construction )
+
+BOOST_AUTO_TEST_CASE( is_empty_when_constructed )
+{
+    kd::timing_wheel wheel{ 42 };
+    BOOST_REQUIRE( wheel.empty() );
+    BOOST_REQUIRE_EQUAL( 42, wheel.now() );
+    BOOST_REQUIRE_EQUAL( 0, wheel.advance( 1000 ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+struct fixture
+{
+    fixture()
+        : wheel_{}
+        , expired_ticks_{}
+    { }
+
+    void
+    insert
+        ( tick_type expiration )
+    {
+        wheel_.insert( expiration, [ this, expiration ] ( void )
+        {
+            BOOST_REQUIRE_LE( expiration, wheel_.now() );
+            expired_ticks_.push_back( expiration );
+        } );
+    }
+
+    kd::timing_wheel wheel_;
+    std::vector< tick_type > expired_ticks_;
+};
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_FIXTURE_TEST_CASE( timeouts_expire_in_order, fixture )
+{
+    insert( 3 );
+    insert( 1 );
+    insert( 2 );
+    BOOST_REQUIRE_EQUAL( 3, wheel_.size() );
+    BOOST_REQUIRE_EQUAL( 1, wheel_.next_tick() );
+
+    BOOST_REQUIRE_EQUAL( 1, wheel_.advance( 1 ) );
+    BOOST_REQUIRE_EQUAL( 2, wheel_.advance( 3 ) );
+    BOOST_REQUIRE( wheel_.empty() );
+
+    std::vector< tick_type > const expected{ 1, 2, 3 };
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( expected.begin(), expected.end()
+                                   , expired_ticks_.begin(), expired_ticks_.end() );
+}
+
+BOOST_FIXTURE_TEST_CASE( elapsed_expirations_expire_on_next_tick, fixture )
+{
+    wheel_.advance( 10 );
+    insert( 5 );
+    BOOST_REQUIRE_EQUAL( 11, wheel_.next_tick() );
+    BOOST_REQUIRE_EQUAL( 1, wheel_.advance( 11 ) );
+}
+
+BOOST_FIXTURE_TEST_CASE( timeouts_are_cancellable, fixture )
+{
+    auto h = wheel_.insert( 100, [] ( void ) { BOOST_FAIL( "cancelled" ); } );
+    insert( 200 );
+
+    BOOST_REQUIRE( wheel_.cancel( h ) );
+    BOOST_REQUIRE( ! wheel_.cancel( h ) );
+    BOOST_REQUIRE_EQUAL( 1, wheel_.size() );
+
+    BOOST_REQUIRE_EQUAL( 1, wheel_.advance( 1000 ) );
+    BOOST_REQUIRE( ! wheel_.cancel( kd::timing_wheel::handle{} ) );
+}
+
+BOOST_FIXTURE_TEST_CASE( stale_handles_are_ignored, fixture )
+{
+    auto h = wheel_.insert( 1, [] ( void ) {} );
+    BOOST_REQUIRE_EQUAL( 1, wheel_.advance( 1 ) );
+
+    // The node of the expired timeout is recycled.
+    insert( 2 );
+    BOOST_REQUIRE( ! wheel_.cancel( h ) );
+    BOOST_REQUIRE_EQUAL( 1, wheel_.advance( 2 ) );
+}
+
+BOOST_FIXTURE_TEST_CASE( callbacks_can_insert_timeouts, fixture )
+{
+    wheel_.insert( 1, [ this ] ( void ) { insert( 2 ); insert( 1 ); } );
+
+    BOOST_REQUIRE_EQUAL( 1, wheel_.advance( 1 ) );
+    BOOST_REQUIRE_EQUAL( 2, wheel_.size() );
+    BOOST_REQUIRE_EQUAL( 2, wheel_.advance( 2 ) );
+}
+
+BOOST_FIXTURE_TEST_CASE( far_timeouts_cascade_to_lower_levels, fixture )
+{
+    tick_type const far = tick_type{ 1 } << 40;
+    insert( far + 3 );
+    insert( 70000 );
+    insert( 4097 );
+
+    tick_type now = 0;
+    while ( ! wheel_.empty() )
+    {
+        auto const next = wheel_.next_tick();
+        BOOST_REQUIRE_GT( next, now );
+        wheel_.advance( now = next );
+    }
+
+    std::vector< tick_type > const expected{ 4097, 70000, far + 3 };
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( expected.begin(), expected.end()
+                                   , expired_ticks_.begin(), expired_ticks_.end() );
+}
+
+BOOST_FIXTURE_TEST_CASE( next_tick_never_skips_an_expiration, fixture )
+{
+    std::default_random_engine random_engine{ 42 };
+    std::uniform_int_distribution< tick_type > expiration{ 1, 1 << 20 };
+
+    std::vector< tick_type > expirations;
+    for ( auto i = 0; i != 10000; ++ i )
+    {
+        expirations.push_back( expiration( random_engine ) );
+        insert( expirations.back() );
+    }
+
+    while ( ! wheel_.empty() )
+    {
+        auto const next = wheel_.next_tick();
+        auto const expired_count = expired_ticks_.size();
+        wheel_.advance( next );
+        // Callbacks are executed on their expiration tick.
+        for ( auto i = expired_count; i != expired_ticks_.size(); ++ i )
+            BOOST_REQUIRE_EQUAL( next, expired_ticks_[ i ] );
+    }
+
+    std::sort( expirations.begin(), expirations.end() );
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( expirations.begin(), expirations.end()
+                                   , expired_ticks_.begin(), expired_ticks_.end() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+
@@ -0,0 +1,238 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "common.hpp"
+#include "peer_factory.hpp"
+
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "tree_routing_table.hpp"
+#include "ip_endpoint.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+using test_routing_table = kd::tree_routing_table< kd::ip_endpoint >;
+
+/**
+ *  @return The count of k_bucket of the tree.
+ */
+std::size_t
+count_k_buckets
+    ( test_routing_table const& rt )
+{
+    auto const later = test_routing_table::clock::now() + std::chrono::hours{ 1 };
+
+    std::vector< std::size_t > k_buckets;
+    rt.find_idle_k_buckets( later, kd::id::BIT_SIZE
+                          , std::back_inserter( k_buckets ) );
+
+    return k_buckets.size();
+}
+
+BOOST_AUTO_TEST_SUITE( tree_routing_table )
+
+/**
+ *  Test test_routing_table::push()
+ */
+BOOST_AUTO_TEST_SUITE( test_push )
+
+BOOST_AUTO_TEST_CASE( starts_with_a_single_k_bucket )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    BOOST_REQUIRE_EQUAL( count_k_buckets( rt ), 1 );
+
+    BOOST_REQUIRE( rt.push( kd::id{ "8000000000000000000000000000000000000000" }
+                          , create_endpoint() ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "c000000000000000000000000000000000000000" }
+                          , create_endpoint() ) );
+    BOOST_REQUIRE_EQUAL( count_k_buckets( rt ), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( splits_the_k_bucket_covering_our_id )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    auto const test_peer( create_endpoint() );
+
+    BOOST_REQUIRE( rt.push( kd::id{ "8000000000000000000000000000000000000000" }
+                          , test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "4000000000000000000000000000000000000000" }
+                          , test_peer ) );
+
+    // The root is split, "4x" moving to the new leaf.
+    BOOST_REQUIRE( rt.push( kd::id{ "c000000000000000000000000000000000000000" }
+                          , test_peer ) );
+    BOOST_REQUIRE_EQUAL( count_k_buckets( rt ), 2 );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 3 );
+
+    // Our side is split again.
+    BOOST_REQUIRE( rt.push( kd::id{ "2000000000000000000000000000000000000000" }
+                          , test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "1000000000000000000000000000000000000000" }
+                          , test_peer ) );
+    BOOST_REQUIRE_EQUAL( count_k_buckets( rt ), 3 );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 5 );
+}
+
+BOOST_AUTO_TEST_CASE( far_full_k_buckets_are_not_split )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    auto const test_peer( create_endpoint() );
+
+    BOOST_REQUIRE( rt.push( kd::id{ "8000000000000000000000000000000000000000" }
+                          , test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "4000000000000000000000000000000000000000" }
+                          , test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "c000000000000000000000000000000000000000" }
+                          , test_peer ) );
+
+    BOOST_REQUIRE( ! rt.push( kd::id{ "a000000000000000000000000000000000000000" }
+                            , test_peer ) );
+    BOOST_REQUIRE_EQUAL( count_k_buckets( rt ), 2 );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 3 );
+
+    // It has been kept as a replacement.
+    BOOST_REQUIRE( rt.remove( kd::id{ "c000000000000000000000000000000000000000" } ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 3 );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "e000000000000000000000000000000000000000" }
+                            , test_peer ) );
+}
+
+BOOST_AUTO_TEST_CASE( split_peers_keep_their_round_trip_time )
+{
+    test_routing_table rt{ kd::id{}, 1 };
+    auto const default_timeout = std::chrono::milliseconds{ 200 };
+    kd::id const test_id{ "1" };
+
+    BOOST_REQUIRE( rt.push( test_id, create_endpoint() ) );
+    for ( auto i = 0; i != 16; ++ i )
+        BOOST_REQUIRE( rt.record_round_trip_time( test_id
+                                                , std::chrono::milliseconds{ 20 } ) );
+
+    // Split down to the deepest k_bucket.
+    BOOST_REQUIRE( rt.push( kd::id{ "2" }, create_endpoint() ) );
+    BOOST_REQUIRE_EQUAL( count_k_buckets( rt ), kd::id::BIT_SIZE );
+
+    BOOST_REQUIRE( rt.request_timeout( test_id, default_timeout )
+                 < default_timeout );
+    BOOST_REQUIRE( rt.request_timeout( kd::id{ "2" }, default_timeout )
+                 == default_timeout );
+
+    // The deepest k_bucket can't be split.
+    BOOST_REQUIRE( ! rt.push( kd::id{}, create_endpoint() ) );
+}
+
+BOOST_AUTO_TEST_CASE( sparse_tables_use_few_k_buckets )
+{
+    std::default_random_engine random_engine;
+    test_routing_table rt{ kd::id{ random_engine } };
+
+    for ( auto i = 0; i != 1000; ++ i )
+        rt.push( kd::id{ random_engine }, create_endpoint() );
+
+    // Around log2( 1000 / 20 ) splits are expected.
+    BOOST_REQUIRE_LT( count_k_buckets( rt ), 16 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/**
+ *  Test test_routing_table::find_eviction_candidate()
+ */
+BOOST_AUTO_TEST_SUITE( test_eviction )
+
+BOOST_AUTO_TEST_CASE( pings_only_the_peers_of_far_full_k_buckets )
+{
+    test_routing_table rt{ kd::id{}, 2 };
+    auto const test_peer( create_endpoint() );
+    kd::id const oldest_id{ "8000000000000000000000000000000000000000" };
+
+    BOOST_REQUIRE( rt.push( oldest_id, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "4000000000000000000000000000000000000000" }
+                          , test_peer ) );
+
+    // The root would be split instead.
+    test_routing_table::value_type oldest;
+    BOOST_REQUIRE( ! rt.find_eviction_candidate
+            ( kd::id{ "2000000000000000000000000000000000000000" }, oldest ) );
+
+    BOOST_REQUIRE( rt.push( kd::id{ "c000000000000000000000000000000000000000" }
+                          , test_peer ) );
+
+    kd::id const new_id{ "a000000000000000000000000000000000000000" };
+    BOOST_REQUIRE( ! rt.push( new_id, test_peer ) );
+    BOOST_REQUIRE( rt.find_eviction_candidate( new_id, oldest ) );
+    BOOST_REQUIRE( oldest.first == oldest_id );
+
+    // The replacement takes the place of the stale peer.
+    BOOST_REQUIRE( rt.evict( oldest_id ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 3 );
+
+    kd::id const other_id{ "9000000000000000000000000000000000000000" };
+    BOOST_REQUIRE( ! rt.push( other_id, test_peer ) );
+    BOOST_REQUIRE( rt.find_eviction_candidate( other_id, oldest ) );
+    BOOST_REQUIRE( oldest.first
+                 == kd::id{ "c000000000000000000000000000000000000000" } );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/**
+ *  Test test_routing_table::random_id_in_k_bucket()
+ */
+BOOST_AUTO_TEST_SUITE( test_refresh )
+
+BOOST_AUTO_TEST_CASE( random_ids_are_covered_by_their_bucket )
+{
+    std::default_random_engine random_engine;
+    kd::id const my_id{ random_engine };
+    test_routing_table rt{ my_id, 2 };
+
+    for ( auto i = 0; i != 100; ++ i )
+        rt.push( kd::id{ random_engine }, create_endpoint() );
+
+    auto const depth = count_k_buckets( rt ) - 1;
+    for ( std::size_t i = 0; i != depth; ++ i )
+    {
+        auto const random_id = rt.random_id_in_k_bucket( i, random_engine );
+        BOOST_REQUIRE_EQUAL( kd::common_prefix_length( random_id, my_id ), i );
+    }
+
+    // The leaf covers our id.
+    auto const random_id = rt.random_id_in_k_bucket( depth, random_engine );
+    BOOST_REQUIRE_GE( kd::common_prefix_length( random_id, my_id ), depth );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+
@@ -0,0 +1,283 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "buffer_pool.hpp"
+#include "id.hpp"
+#include "value_store.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+using data_type = std::vector< std::uint8_t >;
+using store_type = kd::sharded_value_store< kd::id, data_type >;
+using clock = store_type::clock;
+
+/**
+ *  Keys sharing their prefix, hence their shard.
+ */
+kd::id
+make_key
+    ( std::size_t index )
+{
+    return kd::id{ std::string( 39, '8' ) + "0123456789abcdef"[ index ] };
+}
+
+struct fixture
+{
+    fixture
+        ( void )
+            : now_{ clock::now() }
+            , later_{ now_ + std::chrono::hours{ 1 } }
+              // The store can hold 100 bytes.
+            , store_{ 100 }
+    { }
+
+    clock::time_point now_;
+    clock::time_point later_;
+    store_type store_;
+};
+
+BOOST_AUTO_TEST_SUITE( value_store )
+
+BOOST_FIXTURE_TEST_SUITE( test_usage, fixture )
+
+BOOST_AUTO_TEST_CASE( stored_values_can_be_found )
+{
+    BOOST_REQUIRE( store_.insert_or_assign( make_key( 1 )
+                                          , data_type( 10, 'a' )
+                                          , later_, later_ ) );
+
+    data_type value;
+    BOOST_REQUIRE( store_.find( make_key( 1 ), value, now_ ) );
+    BOOST_REQUIRE( data_type( 10, 'a' ) == value );
+
+    BOOST_REQUIRE( ! store_.find( make_key( 2 ), value, now_ ) );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 1, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 10, s.held_bytes_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( stored_values_can_be_replaced )
+{
+    store_.insert_or_assign( make_key( 1 ), data_type( 10, 'a' ), later_, later_ );
+    store_.insert_or_assign( make_key( 1 ), data_type( 20, 'b' ), later_, later_ );
+
+    data_type value;
+    BOOST_REQUIRE( store_.find( make_key( 1 ), value, now_ ) );
+    BOOST_REQUIRE( data_type( 20, 'b' ) == value );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 1, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 20, s.held_bytes_count_ );
+    BOOST_REQUIRE_EQUAL( 0, s.evicted_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( expired_values_are_not_found )
+{
+    store_.insert_or_assign( make_key( 1 ), data_type( 10, 'a' ), now_, later_ );
+
+    data_type value;
+    BOOST_REQUIRE( ! store_.find( make_key( 1 ), value, now_ ) );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 0, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 0, s.held_bytes_count_ );
+    BOOST_REQUIRE_EQUAL( 1, s.expired_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( expired_values_can_be_removed )
+{
+    store_.insert_or_assign( make_key( 1 ), data_type( 10, 'a' ), now_, later_ );
+    store_.insert_or_assign( make_key( 2 ), data_type( 10, 'b' ), later_, later_ );
+    store_.insert_or_assign( kd::id{ "1234" }, data_type( 10, 'c' ), now_, later_ );
+
+    BOOST_REQUIRE_EQUAL( 2, store_.remove_expired( now_ ) );
+    BOOST_REQUIRE_EQUAL( 0, store_.remove_expired( now_ ) );
+
+    data_type value;
+    BOOST_REQUIRE( store_.find( make_key( 2 ), value, now_ ) );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 1, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 10, s.held_bytes_count_ );
+    BOOST_REQUIRE_EQUAL( 2, s.expired_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( least_recently_used_values_are_evicted )
+{
+    for ( std::size_t i = 0; i != 4; ++ i )
+        store_.insert_or_assign( make_key( i ), data_type( 25, 'a' ), later_, later_ );
+
+    // Mark the first value as the most recently used.
+    data_type value;
+    BOOST_REQUIRE( store_.find( make_key( 0 ), value, now_ ) );
+
+    // The budget is exceeded, hence the second value is evicted.
+    store_.insert_or_assign( make_key( 4 ), data_type( 25, 'a' ), later_, later_ );
+
+    BOOST_REQUIRE( store_.find( make_key( 0 ), value, now_ ) );
+    BOOST_REQUIRE( ! store_.find( make_key( 1 ), value, now_ ) );
+    BOOST_REQUIRE( store_.find( make_key( 2 ), value, now_ ) );
+    BOOST_REQUIRE( store_.find( make_key( 4 ), value, now_ ) );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 4, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 100, s.held_bytes_count_ );
+    BOOST_REQUIRE_EQUAL( 1, s.evicted_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( large_values_evict_several_values )
+{
+    for ( std::size_t i = 0; i != 4; ++ i )
+        store_.insert_or_assign( make_key( i ), data_type( 25, 'a' ), later_, later_ );
+
+    store_.insert_or_assign( make_key( 4 ), data_type( 60, 'a' ), later_, later_ );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 2, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 85, s.held_bytes_count_ );
+    BOOST_REQUIRE_EQUAL( 3, s.evicted_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( values_exceeding_the_budget_are_not_stored )
+{
+    store_.insert_or_assign( make_key( 0 ), data_type( 25, 'a' ), later_, later_ );
+
+    BOOST_REQUIRE( ! store_.insert_or_assign( make_key( 1 )
+                                            , data_type( 101, 'a' )
+                                            , later_, later_ ) );
+
+    data_type value;
+    BOOST_REQUIRE( store_.find( make_key( 0 ), value, now_ ) );
+    BOOST_REQUIRE( ! store_.find( make_key( 1 ), value, now_ ) );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 1, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 0, s.evicted_values_count_ );
+    BOOST_REQUIRE_EQUAL( 1, s.rejected_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( values_exceeding_the_budget_keep_the_previous_value )
+{
+    store_.insert_or_assign( make_key( 0 ), data_type( 25, 'a' ), later_, later_ );
+
+    BOOST_REQUIRE( ! store_.insert_or_assign( make_key( 0 )
+                                            , data_type( 101, 'b' )
+                                            , later_, later_ ) );
+
+    data_type value;
+    BOOST_REQUIRE( store_.find( make_key( 0 ), value, now_ ) );
+    BOOST_REQUIRE( data_type( 25, 'a' ) == value );
+    BOOST_REQUIRE_EQUAL( 25, store_.statistics().held_bytes_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( shards_share_the_budget )
+{
+    // A single shard can use the whole budget.
+    BOOST_REQUIRE( store_.insert_or_assign( make_key( 0 )
+                                          , data_type( 90, 'a' )
+                                          , later_, later_ ) );
+
+    // Values of other shards are evicted once it is exceeded.
+    BOOST_REQUIRE( store_.insert_or_assign( kd::id{ "1234" }
+                                          , data_type( 20, 'b' )
+                                          , later_, later_ ) );
+
+    data_type value;
+    BOOST_REQUIRE( ! store_.find( make_key( 0 ), value, now_ ) );
+    BOOST_REQUIRE( store_.find( kd::id{ "1234" }, value, now_ ) );
+
+    auto const s = store_.statistics();
+    BOOST_REQUIRE_EQUAL( 1, s.values_count_ );
+    BOOST_REQUIRE_EQUAL( 20, s.held_bytes_count_ );
+    BOOST_REQUIRE_EQUAL( 1, s.evicted_values_count_ );
+}
+
+BOOST_AUTO_TEST_CASE( values_to_republish_can_be_collected )
+{
+    auto const much_later = later_ + std::chrono::hours{ 1 };
+
+    store_.insert_or_assign( make_key( 0 ), data_type( 1, 'a' ), later_, now_ );
+    store_.insert_or_assign( make_key( 1 ), data_type( 1, 'b' ), later_, later_ );
+    store_.insert_or_assign( make_key( 2 ), data_type( 1, 'c' ), now_, now_ );
+    store_.insert_or_assign( kd::id{ "1234" }, data_type( 1, 'd' ), later_, now_ );
+
+    std::vector< std::tuple< kd::id, data_type, store_type::time_point > > values;
+    BOOST_REQUIRE_EQUAL( 1, store_.collect_values_to_republish
+            ( now_, much_later, 1, std::back_inserter( values ) ) );
+    BOOST_REQUIRE_EQUAL( 1, store_.collect_values_to_republish
+            ( now_, much_later, 8, std::back_inserter( values ) ) );
+
+    // Collected values are postponed and expired values are ignored.
+    BOOST_REQUIRE_EQUAL( 0, store_.collect_values_to_republish
+            ( now_, much_later, 8, std::back_inserter( values ) ) );
+
+    BOOST_REQUIRE_EQUAL( 2, values.size() );
+    std::sort( values.begin(), values.end() );
+    BOOST_REQUIRE( kd::id{ "1234" } == std::get< 0 >( values[ 0 ] ) );
+    BOOST_REQUIRE( data_type( 1, 'd' ) == std::get< 1 >( values[ 0 ] ) );
+    BOOST_REQUIRE( make_key( 0 ) == std::get< 0 >( values[ 1 ] ) );
+    BOOST_REQUIRE( data_type( 1, 'a' ) == std::get< 1 >( values[ 1 ] ) );
+
+    // Values keep their expiration time.
+    BOOST_REQUIRE( later_ == std::get< 2 >( values[ 0 ] ) );
+    BOOST_REQUIRE( later_ == std::get< 2 >( values[ 1 ] ) );
+
+    // Values stored again are postponed too.
+    store_.insert_or_assign( make_key( 1 ), data_type( 1, 'b' ), much_later, much_later );
+    BOOST_REQUIRE_EQUAL( 0, store_.collect_values_to_republish
+            ( later_, much_later, 8, std::back_inserter( values ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( views_are_accounted_for_their_whole_buffer )
+{
+    kd::sharded_value_store< kd::id, kd::buffer_view > store{ 100 };
+
+    auto b = kd::shared_buffer::allocate( 80 );
+    store.insert_or_assign( make_key( 0 )
+                          , kd::buffer_view{ b, b->begin(), b->begin() + 30 }
+                          , later_, later_ );
+
+    BOOST_REQUIRE_EQUAL( 80, store.statistics().held_bytes_count_ );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
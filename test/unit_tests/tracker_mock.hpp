@@ -27,6 +27,7 @@
 #define KADEMLIA_TEST_HELPERS_TRACKER_MOCK_HPP
 
 #include <queue>
+#include <utility>
 
 #include <boost/asio/io_service.hpp>
 
@@ -34,6 +35,8 @@
 
 #include "message.hpp"
 #include "message_serializer.hpp"
+#include "peer.hpp"
+#include "timer.hpp"
 
 namespace kademlia {
 namespace test {
@@ -55,6 +58,8 @@ public:
             , message_serializer_( id_ )
             , responses_to_receive_()
             , sent_messages_()
+            , request_soft_timeout_()
+            , timer_( io_service )
     { }
 
     /**
@@ -65,11 +70,14 @@ public:
     add_message_to_receive
         ( endpoint_type const& endpoint
         , detail::id const& source_id
-        , MessageType const& message )
+        , MessageType const& message
+        , detail::timer::duration const& delay = detail::timer::duration::zero() )
     {
         message_to_receive m{ endpoint
                             , detail::message_traits< MessageType >::TYPE_ID
-                            , source_id };
+                            , source_id
+                            , {}
+                            , delay };
         serialize( message, m.body );
 
         responses_to_receive_.push( std::move( m ) );
@@ -93,7 +101,7 @@ public:
         auto const m  = message_serializer_.serialize( message
                                                      , detail::id{} );
 
-        return c.endpoint == endpoint && c.message == m;
+        return c.endpoint == endpoint && *c.message == *m;
     }
 
     /**
@@ -141,10 +149,32 @@ public:
                                    , r.body.end() );
             };
 
-            io_service_.post( forwarder );
+            if ( r.delay == detail::timer::duration::zero() )
+                io_service_.post( forwarder );
+            else
+                timer_.expires_from_now( r.delay, forwarder );
         }
     }
 
+    /**
+     *
+     */
+    template< typename RequestType
+            , typename TimeoutType
+            , typename OnMessageReceiveCallback
+            , typename OnErrorCallback >
+    void
+    send_request
+        ( RequestType const& request
+        , detail::peer const& p
+        , TimeoutType const& timeout
+        , OnMessageReceiveCallback const& on_message_received
+        , OnErrorCallback const& on_error )
+    {
+        send_request( request, p.endpoint_, timeout
+                    , on_message_received, on_error );
+    }
+
     /**
      *
      */
@@ -168,11 +198,56 @@ public:
         , EndpointType const& e )
     { save_sent_message( r, e ); }
 
+    /**
+     *
+     */
+    void
+    set_request_soft_timeout
+        ( detail::timer::duration const& timeout )
+    { request_soft_timeout_ = timeout; }
+
+    /**
+     *
+     */
+    detail::timer::duration
+    request_soft_timeout
+        ( detail::id const&
+        , double )
+        const
+    { return request_soft_timeout_; }
+
+    /**
+     *
+     */
+    template< typename Callback >
+    detail::timer::handle
+    expires_from_now
+        ( detail::timer::duration const& timeout
+        , Callback && callback )
+    { return timer_.expires_from_now( timeout, std::forward< Callback >( callback ) ); }
+
+    /**
+     *
+     */
+    bool
+    cancel
+        ( detail::timer::handle const& timeout )
+    { return timer_.cancel( timeout ); }
+
+    /**
+     *
+     */
+    std::size_t
+    pending_timeouts_count
+        ( void )
+        const
+    { return timer_.pending_timeouts_count(); }
+
 private:
     struct sent_message final
     {
         endpoint_type endpoint;
-        detail::buffer message;
+        detail::shared_buffer message;
     };
 
     struct message_to_receive final
@@ -181,6 +256,7 @@ private:
         detail::header::type message_type;
         detail::id source_id;
         detail::buffer body;
+        detail::timer::duration delay;
     };
 
 private:
@@ -211,6 +287,10 @@ private:
     std::queue< message_to_receive > responses_to_receive_;
     ///
     std::queue< sent_message > sent_messages_;
+    ///
+    detail::timer::duration request_soft_timeout_;
+    ///
+    detail::timer timer_;
 };
 
 } // namespace test